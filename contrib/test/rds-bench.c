@@ -0,0 +1,374 @@
+/*
+ * rds-bench: microbenchmark for the libv4l2rds group decoder
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A synthetic RDS block stream with a group type mix typical for
+ * broadcast stations (mostly 0A and 2A groups) is generated in memory, or
+ * recorded RDS streams are memory-mapped, and decoded through
+ * v4l2_rds_add() and v4l2_rds_add_blocks(). The decoding speed is reported
+ * in blocks and groups per second, optionally with the decoding cost of
+ * each group type, along with the number of heap allocations.
+ *
+ * To execute:
+ *             ./rds-bench [-g <groups>] [-r <runs>] [-p] [<file>...]
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/videodev2.h>
+#include "../../lib/include/libv4l2rds.h"
+
+/* number of blocks handed to v4l2_rds_add_blocks() per call */
+#define BATCH_BLOCKS 64
+
+static const char *ps_names[] = { "RADIO 1 ", "NEWS    ", "TRAFFIC " };
+/* padded with spaces to a multiple of 4 chars */
+static const char *radio_texts[] = {
+	"Now playing: Some Artist - Some Title\r  ",
+	"The news at the top of the hour, followed by the weather\r   ",
+};
+
+static unsigned put_group(struct v4l2_rds_data *data, uint16_t a, uint16_t b,
+		uint16_t c, uint16_t d)
+{
+	uint16_t blocks[4] = { a, b, c, d };
+
+	for (int i = 0; i < 4; i++) {
+		data[i].lsb = blocks[i] & 0xff;
+		data[i].msb = blocks[i] >> 8;
+		/* type B groups carry a C' block */
+		if (i == 2 && (b & 0x0800))
+			data[i].block = V4L2_RDS_BLOCK_C_ALT | (V4L2_RDS_BLOCK_C_ALT << 3);
+		else
+			data[i].block = i | (i << 3);
+	}
+	return 4;
+}
+
+/* generates the blocks of group_cnt groups, returns the number of blocks */
+static unsigned generate_stream(struct v4l2_rds_data *data, unsigned group_cnt)
+{
+	const uint16_t pi = 0xd313;
+	/* PTY 10, TP set */
+	const uint16_t b_common = (1 << 10) | (10 << 5);
+	unsigned n = 0;
+
+	for (unsigned g = 0; g < group_cnt; g++) {
+		/* change PS and RT every few seconds of air time */
+		const char *ps = ps_names[(g / 400) % 3];
+		const char *rt = radio_texts[(g / 1000) % 2];
+		/* segments are only sent up to the terminating CR */
+		unsigned rt_segments = (strlen(rt) + 3) / 4;
+		unsigned seg;
+
+		switch (g % 20) {
+		case 0: case 2: case 4: case 6: case 8: case 10: case 12: case 14:
+			/* 0A: PS, AF */
+			seg = (g / 2) % 4;
+			n += put_group(data + n, pi, (0x0 << 12) | b_common | seg,
+				((224 + 4) << 8) | (10 + seg),
+				(ps[2 * seg] << 8) | ps[2 * seg + 1]);
+			break;
+		case 1: case 3: case 5: case 7: case 9: case 11:
+			/* 2A: radio text */
+			seg = (g / 2) % rt_segments;
+			n += put_group(data + n, pi, (0x2 << 12) | b_common | seg,
+				(rt[4 * seg] << 8) | rt[4 * seg + 1],
+				(rt[4 * seg + 2] << 8) | rt[4 * seg + 3]);
+			break;
+		case 13:
+			/* 0B */
+			seg = (g / 2) % 4;
+			n += put_group(data + n, pi, (0x0 << 12) | 0x0800 | b_common | seg,
+				pi, (ps[2 * seg] << 8) | ps[2 * seg + 1]);
+			break;
+		case 15:
+			/* 2B */
+			seg = (g / 2) % (2 * rt_segments > 16 ? 16 : 2 * rt_segments);
+			n += put_group(data + n, pi, (0x2 << 12) | 0x0800 | b_common | seg,
+				pi, (rt[2 * seg] << 8) | rt[2 * seg + 1]);
+			break;
+		case 16:
+			/* 1A: ECC */
+			n += put_group(data + n, pi, (0x1 << 12) | b_common, 0x00e0, 0);
+			break;
+		case 17:
+			/* 3A: RT+ announcement */
+			n += put_group(data + n, pi, (0x3 << 12) | b_common | (0xb << 1),
+				0, 0x4bd7);
+			break;
+		case 18:
+			/* 4A: clock time, sent once a minute */
+			if ((g / 20) % 35 == 0)
+				n += put_group(data + n, pi, (0x4 << 12) | b_common | 0x1,
+					0xc000, 0x0000);
+			else
+				n += put_group(data + n, pi, (0xa << 12) | b_common,
+					('P' << 8) | 'O', ('P' << 8) | ' ');
+			break;
+		default:
+			/* 8A: TMC */
+			n += put_group(data + n, pi, (0x8 << 12) | b_common | 0x08,
+				0x1234, 0x5678);
+			break;
+		}
+	}
+	return n;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#ifdef __GLIBC__
+/* count the heap allocations done while decoding, by interposing the
+ * allocator entry points used by libv4l2rds */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static unsigned long alloc_cnt;
+
+void *malloc(size_t size)
+{
+	alloc_cnt++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	alloc_cnt++;
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	alloc_cnt++;
+	return __libc_realloc(ptr, size);
+}
+#else
+static unsigned long alloc_cnt;
+#endif
+
+static double bench_single(const struct v4l2_rds_data *data, size_t n,
+		struct v4l2_rds_statistics *stats)
+{
+	struct v4l2_rds *handle = v4l2_rds_create(false);
+	double start = now();
+
+	for (size_t i = 0; i < n; i++) {
+		struct v4l2_rds_data block = data[i];
+
+		v4l2_rds_add(handle, &block);
+	}
+	start = now() - start;
+	*stats = handle->rds_statistics;
+	v4l2_rds_destroy(handle);
+	return start;
+}
+
+static double bench_batch(const struct v4l2_rds_data *data, size_t n,
+		struct v4l2_rds_statistics *stats)
+{
+	struct v4l2_rds *handle = v4l2_rds_create(false);
+	uint32_t updated[BATCH_BLOCKS];
+	double start = now();
+
+	for (size_t i = 0; i < n; i += BATCH_BLOCKS)
+		v4l2_rds_add_blocks(handle, data + i,
+			n - i < BATCH_BLOCKS ? n - i : BATCH_BLOCKS, updated);
+	start = now() - start;
+	*stats = handle->rds_statistics;
+	v4l2_rds_destroy(handle);
+	return start;
+}
+
+/* measures the decoding time of every group and sums it up by group type.
+ * The timer overhead is calibrated first and subtracted */
+static void profile_group_types(const struct v4l2_rds_data *data, size_t n,
+		double cost[16], unsigned long cnt[16])
+{
+	struct v4l2_rds *handle = v4l2_rds_create(false);
+	double overhead = now();
+	double t = 0;
+
+	for (int i = 0; i < 100000; i++)
+		now();
+	overhead = (now() - overhead) / 100000;
+
+	for (size_t i = 0; i < n; i++) {
+		struct v4l2_rds_data block = data[i];
+		unsigned group_cnt = handle->rds_statistics.group_cnt;
+
+		/* only the last block of a group triggers its decoding, the
+		 * time spent for the other blocks is added to the next group */
+		t -= now();
+		v4l2_rds_add(handle, &block);
+		t += now() - overhead;
+		if (handle->rds_statistics.group_cnt == group_cnt)
+			continue;
+
+		uint8_t group_id = v4l2_rds_get_group(handle)->group_id;
+
+		cost[group_id] += t;
+		cnt[group_id]++;
+		t = 0;
+	}
+	v4l2_rds_destroy(handle);
+}
+
+static void print_results(const char *name, size_t n, unsigned runs, int profile,
+		const struct v4l2_rds_data *data)
+{
+	struct v4l2_rds_statistics stats;
+	double best_single = 0, best_batch = 0;
+	unsigned long allocs = alloc_cnt;
+
+	memset(&stats, 0, sizeof(stats));
+	/* report the best of all runs, to filter out scheduling noise */
+	for (unsigned r = 0; r < runs; r++) {
+		double t_single = bench_single(data, n, &stats);
+		double t_batch = bench_batch(data, n, &stats);
+
+		if (!r || t_single < best_single)
+			best_single = t_single;
+		if (!r || t_batch < best_batch)
+			best_batch = t_batch;
+	}
+	allocs = alloc_cnt - allocs;
+
+	printf("%s:\n", name);
+	printf("blocks / groups:      %zu / %u (%u group errors)\n",
+		n, stats.group_cnt, stats.group_error_cnt);
+	printf("v4l2_rds_add:         %.0f blocks/s, %.0f groups/s (%.1f ns/group)\n",
+		n / best_single, stats.group_cnt / best_single,
+		stats.group_cnt ? best_single * 1e9 / stats.group_cnt : 0);
+	printf("v4l2_rds_add_blocks:  %.0f blocks/s, %.0f groups/s (%.1f ns/group)\n",
+		n / best_batch, stats.group_cnt / best_batch,
+		stats.group_cnt ? best_batch * 1e9 / stats.group_cnt : 0);
+	printf("allocations:          %.1f per run\n", (double)allocs / runs);
+
+	if (profile) {
+		double cost[16] = { 0 };
+		unsigned long cnt[16] = { 0 };
+
+		profile_group_types(data, n, cost, cnt);
+		printf("group  count        ns/group\n");
+		for (int i = 0; i < 16; i++)
+			if (cnt[i])
+				printf("%02d     %-12lu %.1f\n", i, cnt[i],
+					cost[i] * 1e9 / cnt[i]);
+	}
+}
+
+/* replays a recorded RDS stream (as read from a RDS capable device, the
+ * format used by rds-ctl --file) */
+static int replay_file(const char *name, unsigned runs, int profile)
+{
+	const struct v4l2_rds_data *data;
+	struct stat st;
+	int fd;
+
+	if ((fd = open(name, O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "%s: %s\n", name, strerror(errno));
+		if (fd >= 0)
+			close(fd);
+		return -1;
+	}
+	if (st.st_size < (off_t)sizeof(*data)) {
+		fprintf(stderr, "%s: no RDS blocks\n", name);
+		close(fd);
+		return -1;
+	}
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		fprintf(stderr, "%s: %s\n", name, strerror(errno));
+		return -1;
+	}
+	madvise((void *)data, st.st_size, MADV_SEQUENTIAL);
+
+	print_results(name, st.st_size / sizeof(*data), runs, profile, data);
+	munmap((void *)data, st.st_size);
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-g <groups>] [-r <runs>] [-p] [<file>...]\n"
+	       "  -g <groups>  number of groups of the synthetic stream (default 1000000)\n"
+	       "  -r <runs>    number of runs, the best run is reported (default 5)\n"
+	       "  -p           report the decoding cost per group type\n"
+	       "  <file>       replay recorded RDS streams instead of a synthetic one\n",
+	       prog);
+}
+
+int main(int argc, char **argv)
+{
+	struct v4l2_rds_data *data;
+	unsigned group_cnt = 1000000;
+	unsigned runs = 5;
+	int profile = 0;
+	int ret = 0;
+	size_t n;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "g:r:ph")) != -1) {
+		switch (opt) {
+		case 'g':
+			group_cnt = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			runs = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			profile = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : -1;
+		}
+	}
+	if (!group_cnt || !runs) {
+		fprintf(stderr, "groups and runs must be > 0\n");
+		return -1;
+	}
+
+	if (optind < argc) {
+		for (int i = optind; i < argc; i++)
+			if (replay_file(argv[i], runs, profile))
+				ret = -1;
+		return ret;
+	}
+
+	data = malloc(group_cnt * 4 * sizeof(*data));
+	if (!data) {
+		perror("malloc");
+		return -1;
+	}
+	n = generate_stream(data, group_cnt);
+	print_results("synthetic stream", n, runs, profile, data);
+	free(data);
+	return 0;
+}
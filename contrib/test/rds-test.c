@@ -0,0 +1,444 @@
+/*
+ * rds-test: regression tests for the libv4l2rds group assembly
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Synthetic RDS block streams with missing blocks are fed to the decoder
+ * in strict and tolerant mode, checking the decoded fields and that
+ * v4l2_rds_add_blocks() stays within the documented size of its updated
+ * array. The snapshots, corrupt capture files and the takeover of shared
+ * memory segments are checked as well. Exits with a non-zero status if a
+ * check fails.
+ *
+ * To execute:
+ *             ./rds-test
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <linux/videodev2.h>
+#include "../../lib/include/libv4l2rds.h"
+
+#define PI	0x1234
+#define GUARD	0xdeadbeef
+
+static int failures;
+
+#define CHECK(cond) do {						\
+	if (!(cond)) {							\
+		fprintf(stderr, "%s:%d: check failed: %s\n",		\
+			__FILE__, __LINE__, #cond);			\
+		failures++;						\
+	}								\
+} while (0)
+
+static void put_block(struct v4l2_rds_data *data, uint16_t value, int block)
+{
+	data->lsb = value & 0xff;
+	data->msb = value >> 8;
+	data->block = block | (block << 3);
+}
+
+/* group with the blocks selected by mask (bit 0 = A ... bit 3 = D) */
+static unsigned put_group(struct v4l2_rds_data *data, uint16_t a, uint16_t b,
+		uint16_t c, uint16_t d, unsigned mask)
+{
+	uint16_t blocks[4] = { a, b, c, d };
+	unsigned n = 0;
+
+	for (int i = 0; i < 4; i++)
+		if (mask & (1 << i))
+			put_block(&data[n++], blocks[i], i);
+	return n;
+}
+
+/* 0A group carrying PS segment seg, without AFs */
+static unsigned put_group0a(struct v4l2_rds_data *data, const char *ps,
+		int seg, unsigned mask)
+{
+	return put_group(data, PI, 0x0000 | seg, 0xe0cd,
+			(uint8_t)ps[seg * 2] << 8 | (uint8_t)ps[seg * 2 + 1], mask);
+}
+
+/* frequency of a VHF AF code in Hz */
+static uint32_t af_freq(uint8_t af)
+{
+	return 87500000 + af * 100000;
+}
+
+/* decodes n blocks with an updated array of exactly n entries, followed by
+ * a guard entry which must stay untouched */
+static unsigned add_blocks(struct v4l2_rds *handle,
+		const struct v4l2_rds_data *data, unsigned n, uint32_t *fields)
+{
+	uint32_t *updated = malloc((n + 1) * sizeof(*updated));
+	unsigned groups;
+
+	updated[n] = GUARD;
+	groups = v4l2_rds_add_blocks(handle, data, n, updated);
+	CHECK(groups <= n);
+	CHECK(updated[n] == GUARD);
+	*fields = 0;
+	for (unsigned i = 0; i < groups && i < n; i++)
+		*fields |= updated[i];
+	free(updated);
+	return groups;
+}
+
+/* a stream of A and B blocks only, every B block completes a group in
+ * tolerant mode */
+static void test_ab_stream(void)
+{
+	struct v4l2_rds *handle = v4l2_rds_create(false);
+	struct v4l2_rds_data data[16];
+	uint32_t fields;
+	unsigned groups;
+
+	for (int i = 0; i < 16; i += 2) {
+		put_block(&data[i], PI, V4L2_RDS_BLOCK_A);
+		put_block(&data[i + 1], 0x0000, V4L2_RDS_BLOCK_B);
+	}
+
+	groups = add_blocks(handle, data, 16, &fields);
+	CHECK(groups == 0);
+
+	v4l2_rds_reset(handle, true);
+	v4l2_rds_set_tolerant(handle, true);
+	groups = add_blocks(handle, data, 16, &fields);
+	CHECK(groups == 7);
+	CHECK(fields & V4L2_RDS_PI);
+	CHECK(handle->pi == PI);
+	v4l2_rds_destroy(handle);
+}
+
+/* 0A groups with a missing block C, and some with a missing block D */
+static void test_missing_cd(void)
+{
+	static const char ps[] = "TEST FM ";
+	struct v4l2_rds *handle = v4l2_rds_create(false);
+	struct v4l2_rds_data data[64];
+	uint32_t fields;
+	unsigned groups, n = 0;
+
+	/* one complete group */
+	n += put_group0a(data + n, ps, 0, 0xf);
+	for (int rep = 0; rep < 2; rep++) {
+		for (int seg = 0; seg < 4; seg++)
+			n += put_group0a(data + n, ps, seg, 0xb);
+		/* block D lost, the group is finished by the next block A */
+		n += put_group0a(data + n, ps, 0, 0x7);
+	}
+	n += put_group0a(data + n, ps, 0, 0x1);
+
+	/* in strict mode only the complete group survives */
+	groups = add_blocks(handle, data, n, &fields);
+	CHECK(groups == 1);
+	CHECK(!(handle->valid_fields & V4L2_RDS_PS));
+
+	v4l2_rds_reset(handle, true);
+	v4l2_rds_set_tolerant(handle, true);
+	groups = add_blocks(handle, data, n, &fields);
+	CHECK(groups == 11);
+	CHECK(fields & V4L2_RDS_PS);
+	CHECK(handle->valid_fields & V4L2_RDS_PS);
+	CHECK(!memcmp(handle->ps, ps, 8));
+	CHECK(handle->rds_statistics.group_cnt == 11);
+	v4l2_rds_destroy(handle);
+}
+
+/* AF Method B lists, which must not survive a change of the station */
+static void test_af_method_b(void)
+{
+	struct v4l2_rds_cache *cache = v4l2_rds_cache_create(4);
+	struct v4l2_rds *handle = v4l2_rds_create(false);
+	const struct v4l2_rds_af_list *list;
+	struct v4l2_rds_data data[64];
+	unsigned cnt, n = 0;
+	uint32_t fields;
+
+	v4l2_rds_set_cache(handle, cache);
+	/* the PI is accepted once it was received twice */
+	n += put_group(data + n, PI, 0x0000, 0xe0cd, 0x2020, 0xf);
+	n += put_group(data + n, PI, 0x0000, 0xe0cd, 0x2020, 0xf);
+	/* list for AF code 10 with 3 frequencies, list for 40 with 2 */
+	n += put_group(data + n, PI, 0x0000, (224 + 3) << 8 | 10, 0x2020, 0xf);
+	n += put_group(data + n, PI, 0x0001, 10 << 8 | 20, 0x2020, 0xf);
+	n += put_group(data + n, PI, 0x0002, 10 << 8 | 30, 0x2020, 0xf);
+	n += put_group(data + n, PI, 0x0003, (224 + 2) << 8 | 40, 0x2020, 0xf);
+	n += put_group(data + n, PI, 0x0000, 50 << 8 | 40, 0x2020, 0xf);
+	add_blocks(handle, data, n, &fields);
+
+	CHECK(handle->decode_information & V4L2_RDS_AF_B);
+	CHECK(handle->valid_fields & V4L2_RDS_AF);
+	/* the set of all AFs has no announced count with Method B */
+	CHECK(handle->rds_af.announced_af == 0);
+	CHECK(handle->rds_af.size == 5);
+	v4l2_rds_get_af_lists(handle, &cnt);
+	CHECK(cnt == 2);
+	list = v4l2_rds_get_af_list(handle, af_freq(10));
+	CHECK(list && list->size == 2 && list->announced_af == 3);
+	list = v4l2_rds_get_af_list(handle, af_freq(40));
+	CHECK(list && list->size == 1 && list->af[0].freq == af_freq(50) &&
+	      (list->af[0].flags & V4L2_RDS_AF_REGIONAL));
+	CHECK(v4l2_rds_is_af(handle, af_freq(10), af_freq(30), NULL));
+
+	/* switch to another station */
+	n = put_group(data, PI + 1, 0x0000, 0xe0cd, 0x2020, 0xf);
+	n += put_group(data + n, PI + 1, 0x0000, 0xe0cd, 0x2020, 0xf);
+	add_blocks(handle, data, n, &fields);
+
+	CHECK(handle->pi == PI + 1);
+	CHECK(!(handle->decode_information & V4L2_RDS_AF_B));
+	CHECK(handle->rds_af.size == 0);
+	v4l2_rds_get_af_lists(handle, &cnt);
+	CHECK(cnt == 0);
+	CHECK(!v4l2_rds_get_af_list(handle, af_freq(10)));
+	CHECK(!v4l2_rds_is_af(handle, af_freq(10), af_freq(30), NULL));
+
+	v4l2_rds_destroy(handle);
+	v4l2_rds_cache_destroy(cache);
+}
+
+/* other networks from EON groups, which must not survive a change of the
+ * station either */
+static void test_eon_switch(void)
+{
+	static const char ps[] = "OTHER FM";
+	struct v4l2_rds_cache *cache = v4l2_rds_cache_create(4);
+	struct v4l2_rds *handle = v4l2_rds_create(false);
+	const struct v4l2_rds_eon *eon;
+	struct v4l2_rds_data data[64];
+	unsigned cnt, n = 0;
+	uint32_t fields;
+
+	v4l2_rds_set_cache(handle, cache);
+	n += put_group(data + n, PI, 0x0000, 0xe0cd, 0x2020, 0xf);
+	n += put_group(data + n, PI, 0x0000, 0xe0cd, 0x2020, 0xf);
+	/* 14A groups with the PS name of the other network 0x5678 */
+	for (int seg = 0; seg < 4; seg++)
+		n += put_group(data + n, PI, 0xe000 | seg,
+				(uint8_t)ps[seg * 2] << 8 | (uint8_t)ps[seg * 2 + 1],
+				0x5678, 0xf);
+	add_blocks(handle, data, n, &fields);
+
+	CHECK(handle->valid_fields & V4L2_RDS_EON);
+	v4l2_rds_get_eons(handle, &cnt);
+	CHECK(cnt == 1);
+	eon = v4l2_rds_get_eon(handle, 0x5678);
+	CHECK(eon && (eon->valid_fields & V4L2_RDS_PS) &&
+	      !memcmp(eon->ps, ps, 8));
+
+	/* switch to another station */
+	n = put_group(data, PI + 1, 0x0000, 0xe0cd, 0x2020, 0xf);
+	n += put_group(data + n, PI + 1, 0x0000, 0xe0cd, 0x2020, 0xf);
+	add_blocks(handle, data, n, &fields);
+
+	CHECK(handle->pi == PI + 1);
+	CHECK(!(handle->valid_fields & (V4L2_RDS_EON | V4L2_RDS_RTPLUS)));
+	v4l2_rds_get_eons(handle, &cnt);
+	CHECK(cnt == 0);
+	CHECK(!v4l2_rds_get_eon(handle, 0x5678));
+
+	v4l2_rds_destroy(handle);
+	v4l2_rds_cache_destroy(cache);
+}
+
+/* size of the header of a capture file, block_cnt is at offset 24 */
+#define CAPTURE_HDR_SIZE	64
+
+/* overwrites 64 bits of a capture file */
+static void patch_capture(const char *path, off_t offset, uint64_t value)
+{
+	int fd = open(path, O_WRONLY);
+
+	CHECK(fd >= 0 && pwrite(fd, &value, sizeof(value), offset) == sizeof(value));
+	if (fd >= 0)
+		close(fd);
+}
+
+/* opens a capture and checks that it has cnt records, which all can be
+ * found by their reception time */
+static void check_capture(const char *path, uint64_t start, unsigned cnt)
+{
+	struct v4l2_rds_capture *cap = v4l2_rds_capture_open(path);
+	const struct v4l2_rds_capture_block *blocks;
+	uint64_t block_cnt;
+
+	CHECK(cap);
+	if (!cap)
+		return;
+	blocks = v4l2_rds_capture_get_blocks(cap, &block_cnt);
+	CHECK(block_cnt == cnt);
+	for (unsigned i = 0; i < cnt && i < block_cnt; i += 7) {
+		uint64_t pos = v4l2_rds_capture_seek(cap, start + i * 1000ULL);
+
+		CHECK(pos == i && blocks[pos].time_ms == i * 1000);
+	}
+	CHECK(v4l2_rds_capture_seek(cap, start + cnt * 1000ULL) == block_cnt);
+	v4l2_rds_capture_close(cap);
+}
+
+/* the header of a capture file is not trusted, a corrupt index is
+ * rebuilt from the records */
+static void test_capture_corrupt(void)
+{
+	const uint64_t start = 1000000000000ULL;
+	const unsigned cnt = 200;
+	struct v4l2_rds_capture *cap;
+	struct v4l2_rds_data data;
+	char path[64];
+
+	snprintf(path, sizeof(path), "/tmp/rds-test-%d.cap", (int)getpid());
+	cap = v4l2_rds_capture_create(path, start);
+	CHECK(cap);
+	if (!cap)
+		return;
+	for (unsigned i = 0; i < cnt; i++) {
+		put_block(&data, PI, V4L2_RDS_BLOCK_A);
+		CHECK(!v4l2_rds_capture_write(cap, &data, 1, start + i * 1000ULL,
+					      100000000));
+	}
+	CHECK(!v4l2_rds_capture_close(cap));
+	check_capture(path, start, cnt);
+
+	/* a block count which wraps around the size of the records */
+	patch_capture(path, 24, 1ULL << 60);
+	check_capture(path, start, cnt);
+	/* a time index entry past the records */
+	cap = v4l2_rds_capture_create(path, start);
+	for (unsigned i = 0; cap && i < cnt; i++) {
+		put_block(&data, PI, V4L2_RDS_BLOCK_A);
+		v4l2_rds_capture_write(cap, &data, 1, start + i * 1000ULL, 100000000);
+	}
+	CHECK(cap && !v4l2_rds_capture_close(cap));
+	patch_capture(path, CAPTURE_HDR_SIZE +
+		      cnt * sizeof(struct v4l2_rds_capture_block) +
+		      sizeof(uint64_t), 1ULL << 40);
+	check_capture(path, start, cnt);
+	/* the index cut off */
+	CHECK(!truncate(path, CAPTURE_HDR_SIZE +
+			cnt * sizeof(struct v4l2_rds_capture_block) + 4));
+	check_capture(path, start, cnt);
+	unlink(path);
+}
+
+/* a capture is stopped by the first failed write */
+static void test_capture_full(void)
+{
+	struct v4l2_rds_capture *cap = v4l2_rds_capture_create("/dev/full", 0);
+	struct v4l2_rds_data data[64];
+	int ret = 0;
+
+	if (!cap)
+		return;
+	for (unsigned i = 0; i < 64; i++)
+		put_block(&data[i], PI, V4L2_RDS_BLOCK_A);
+	/* fill the buffer of the file until it is written */
+	for (unsigned i = 0; i < 1000 && !ret; i++)
+		ret = v4l2_rds_capture_write(cap, data, 64, i * 1000ULL, 0);
+	CHECK(ret == -1 && errno == ENOSPC);
+	errno = 0;
+	CHECK(v4l2_rds_capture_write(cap, data, 64, 0, 0) == -1 &&
+	      errno == ENOSPC);
+	errno = 0;
+	CHECK(v4l2_rds_capture_close(cap) == -1 && errno == ENOSPC);
+}
+
+/* snapshots stay available to readers across a reset of the handle */
+static void test_snapshot_reset(void)
+{
+	struct v4l2_rds *handle = v4l2_rds_create(false);
+	struct v4l2_rds snapshot;
+	struct v4l2_rds_data data[8];
+	uint32_t fields, seq;
+	unsigned n;
+
+	CHECK(!v4l2_rds_get_snapshot(handle, &snapshot));
+	CHECK(!v4l2_rds_snapshot_begin(handle, &seq));
+	CHECK(!v4l2_rds_snapshot_retry(handle, 0));
+
+	CHECK(!v4l2_rds_enable_snapshots(handle));
+	n = put_group(data, PI, 0x0000, 0xe0cd, 0x2020, 0xf);
+	n += put_group(data + n, PI, 0x0000, 0xe0cd, 0x2020, 0xf);
+	add_blocks(handle, data, n, &fields);
+	CHECK(v4l2_rds_get_snapshot(handle, &snapshot));
+	CHECK(snapshot.pi == PI);
+
+	v4l2_rds_reset(handle, true);
+	CHECK(v4l2_rds_snapshot_begin(handle, &seq));
+	CHECK(v4l2_rds_get_snapshot(handle, &snapshot));
+	CHECK(!(snapshot.valid_fields & V4L2_RDS_PI));
+	add_blocks(handle, data, n, &fields);
+	CHECK(v4l2_rds_get_snapshot(handle, &snapshot));
+	CHECK(snapshot.pi == PI);
+	v4l2_rds_destroy(handle);
+}
+
+/* a segment is only taken over from a publisher that is gone */
+static void test_shm_owner(void)
+{
+	struct v4l2_rds_shm *shm, *other;
+	char name[32];
+	int status;
+	pid_t pid;
+
+	snprintf(name, sizeof(name), "/rds-test-%d", (int)getpid());
+	shm = v4l2_rds_shm_create(name, 16);
+	CHECK(shm);
+	if (!shm)
+		return;
+	errno = 0;
+	other = v4l2_rds_shm_create(name, 16);
+	CHECK(!other && errno == EEXIST);
+	CHECK(!v4l2_rds_shm_close(shm));
+
+	/* closed by its publisher */
+	shm = v4l2_rds_shm_create(name, 16);
+	CHECK(shm);
+	if (shm)
+		v4l2_rds_shm_close(shm);
+
+	/* left behind by a publisher that died */
+	pid = fork();
+	if (!pid)
+		_exit(v4l2_rds_shm_create(name, 16) ? 0 : 1);
+	CHECK(pid > 0 && waitpid(pid, &status, 0) == pid &&
+	      WIFEXITED(status) && !WEXITSTATUS(status));
+	shm = v4l2_rds_shm_create(name, 16);
+	CHECK(shm);
+	if (shm)
+		CHECK(!v4l2_rds_shm_close(shm));
+}
+
+int main(void)
+{
+	test_ab_stream();
+	test_missing_cd();
+	test_af_method_b();
+	test_eon_switch();
+	test_capture_corrupt();
+	test_capture_full();
+	test_snapshot_reset();
+	test_shm_owner();
+
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("all checks passed\n");
+	return 0;
+}
@@ -42,10 +42,9 @@ extern "C" {
 /* Constants used to define the size of arrays used to store RDS information */
 #define MAX_ODA_CNT 18 	/* there are 16 groups each with type a or b. Of these
 			 * 32 distinct groups, 18 can be used for ODA purposes */
-#define MAX_AF_CNT 25	/* AF Method A allows a maximum of 25 AFs to be defined
-			 * AF Method B does not impose a limit on the number of AFs
-			 * but it is not fully supported at the moment and will
-			 * not receive more than 25 AFs */
+#define MAX_AF_CNT 25	/* AF Method A allows a maximum of 25 AFs to be defined,
+			 * AF Method B allows 25 AFs per tuned frequency */
+#define MAX_EON_CNT 16	/* number of other networks kept from EON groups */
 
 /* Define Constants for the possible types of RDS information
  * used to address the relevant bit in the valid_fields bitmask */
@@ -63,11 +62,16 @@ extern "C" {
 #define V4L2_RDS_AF		0x800	/* AF (alternative freq) available */
 #define V4L2_RDS_ECC		0x1000	/* Extended County Code */
 #define V4L2_RDS_LC		0x2000	/* Language Code */
+#define V4L2_RDS_EON		0x4000	/* Enhanced Other Networks info */
+#define V4L2_RDS_RTPLUS		0x8000	/* Radio Text Plus tags */
 
 /* Define Constants for the state of the RDS decoding process
  * used to address the relevant bit in the decode_information bitmask */
 #define V4L2_RDS_GROUP_NEW 	0x01	/* New group received */
 #define V4L2_RDS_ODA		0x02	/* Open Data Group announced */
+#define V4L2_RDS_SYNC		0x04	/* Block synchronization acquired
+					 * (software block decoder only) */
+#define V4L2_RDS_AF_B		0x08	/* AF Method B lists received */
 
 /* Decoder Information (DI) codes
  * used to decode the DI information according to the RDS standard */
@@ -129,12 +133,61 @@ struct v4l2_rds_oda_set {
 
 /* struct to encapsulate an array of Alternative Frequencies for a channel */
 /* Every channel can send out AFs for his program. The number of AFs that
- * will be broadcasted is announced by the channel */
+ * will be broadcasted is announced by the channel. With AF Method B the
+ * set holds the frequencies of all lists */
 struct v4l2_rds_af_set {
 	uint8_t size;			/* size of the set (might be smaller
 					 * than the announced size) */
-	uint8_t announced_af;		/* number of announced AF */
-	uint32_t af[MAX_AF_CNT];	/* AFs defined in Hz */
+	uint8_t announced_af;		/* number of announced AF, 0 with
+					 * Method B, see the lists */
+	uint32_t af[MAX_AF_CNT];	/* AFs defined in Hz, sorted */
+};
+
+/* flags of an entry of an AF Method B list */
+#define V4L2_RDS_AF_REGIONAL	0x01	/* regional variant, the AF carries
+					 * a different program at times */
+
+/* struct to encapsulate one AF of an AF Method B list */
+struct v4l2_rds_af_entry {
+	uint32_t freq;		/* AF in Hz */
+	uint8_t flags;		/* V4L2_RDS_AF_* */
+};
+
+/* struct to encapsulate the AF Method B list of one tuned frequency */
+/* Stations with many transmitters send one AF list for each of them,
+ * holding the AFs that are suitable when tuned to that transmitter */
+struct v4l2_rds_af_list {
+	uint32_t tuned_freq;	/* frequency the list applies to, in Hz */
+	uint8_t announced_af;	/* number of announced frequencies,
+				 * including tuned_freq */
+	uint8_t size;		/* number of received AFs */
+	struct v4l2_rds_af_entry af[MAX_AF_CNT];	/* sorted by freq */
+};
+
+/* struct to encapsulate one mapped frequency of an other network */
+/* when tuned to tuned_freq, the other network can be received on
+ * other_freq */
+struct v4l2_rds_eon_mapped {
+	uint32_t tuned_freq;	/* frequency of the tuned network in Hz */
+	uint32_t other_freq;	/* frequency of the other network in Hz */
+};
+
+/* struct to encapsulate the information about one other network */
+/* Stations send the PS name, AFs, PTY and TA flag of linked stations in
+ * type 14 (Enhanced Other Networks) groups, so that a receiver can switch
+ * to them (e.g. for traffic announcements) without scanning the band */
+struct v4l2_rds_eon {
+	uint32_t valid_fields;	/* valid info fields of this struct: PS,
+				 * PTY, TP, TA and AF (V4L2_RDS_*) */
+	uint16_t pi;		/* Program Identification */
+	uint8_t ps[9];		/* Program Service Name, '\0' terminated */
+	uint8_t pty;		/* Program Type */
+	bool tp;		/* Traffic Program */
+	bool ta;		/* Traffic Announcement */
+	struct v4l2_rds_af_set af;	/* AFs of the other network */
+	uint8_t mapped_cnt;	/* number of mapped frequencies */
+	struct v4l2_rds_eon_mapped mapped[MAX_AF_CNT];	/* mapped frequencies,
+				 * sorted by tuned_freq and other_freq */
 };
 
 /* struct to encapsulate state and RDS information for current decoding process */
@@ -196,6 +249,468 @@ LIBV4L_PUBLIC void v4l2_rds_reset(struct v4l2_rds *handle, bool reset_statistics
  * 				on RDS capable V4L2 devices */
 LIBV4L_PUBLIC uint32_t v4l2_rds_add(struct v4l2_rds *handle, struct v4l2_rds_data *rds_data);
 
+/* adds an array of raw RDS blocks (e.g. the result of a single read() call
+ * on a RDS capable V4L2 device) and decodes them into RDS groups
+ * @rds_data:	array of n raw RDS blocks of 3 bytes each
+ * @n:		number of blocks in rds_data
+ * @updated:	optional (may be NULL), receives one bitmask of updated fields
+ *		for every completed group, in the order the groups were
+ *		completed. Must have room for n entries, in tolerant mode
+ *		(see v4l2_rds_set_tolerant()) every block may complete a group
+ * @return:	number of completed groups
+ * The handle reflects the state after the last block; the raw data of the
+ * last completed group is available through v4l2_rds_get_group() */
+LIBV4L_PUBLIC unsigned v4l2_rds_add_blocks(struct v4l2_rds *handle,
+		const struct v4l2_rds_data *rds_data, unsigned n, uint32_t *updated);
+
+/* enables / disables the tolerant group assembly mode
+ * By default a group is dropped as soon as one of its blocks is erroneous
+ * or missing. In tolerant mode incomplete groups are kept and decoded as
+ * far as the error free blocks allow it (block B is always required), e.g.
+ * PS characters from block D of a 0A group with a corrupted block C.
+ * Useful under weak reception, at the cost of less protection against
+ * corrupted data */
+LIBV4L_PUBLIC void v4l2_rds_set_tolerant(struct v4l2_rds *handle, bool tolerant);
+
+/* adds raw, demodulated RDS bits to the software block decoder
+ * For receivers that don't do block synchronization and error correction
+ * in hardware. The decoder searches the stream for the offset words of
+ * the blocks, and checks and corrects (burst errors of up to 2 bits) the
+ * blocks once synchronized. The recovered blocks are decoded like the
+ * ones passed to v4l2_rds_add(). V4L2_RDS_SYNC in decode_information
+ * signals if the decoder is synchronized
+ * @bits:	bit stream, most significant bit of each byte first
+ * @bit_cnt:	number of bits in bits
+ * @return:	bitmask with updated fields set to 1 */
+LIBV4L_PUBLIC uint32_t v4l2_rds_add_raw_bits(struct v4l2_rds *handle,
+		const uint8_t *bits, unsigned bit_cnt);
+
+/*
+ * snapshots for concurrent readers
+ *
+ * The handle is updated in place while blocks are added, so other threads
+ * reading it could see half-updated fields. With snapshots enabled the
+ * decoding thread publishes a consistent copy of the handle after every
+ * completed group in v4l2_rds_add(), and once per call of
+ * v4l2_rds_add_blocks() and v4l2_rds_add_raw_bits(). Any number of reader
+ * threads can read the snapshots without locks (seqlock over two buffers),
+ * copying only the fields they need:
+ *
+ *	do {
+ *		s = v4l2_rds_snapshot_begin(handle, &seq);
+ *		memcpy(ps, s->ps, sizeof(ps));
+ *	} while (v4l2_rds_snapshot_retry(handle, seq));
+ *
+ * Readers only have to retry if two snapshots were published while they
+ * were reading. The sequence number increases with every snapshot, so it
+ * also tells readers if anything changed since their last read. Like the
+ * state in shared memory, a snapshot holds only the public part of the
+ * handle */
+
+/* enables publishing of snapshots, must be called by the decoding thread
+ * before any reader is started
+ * @return:	0 on success, -1 if out of memory */
+LIBV4L_PUBLIC int v4l2_rds_enable_snapshots(struct v4l2_rds *handle);
+
+/* starts reading the latest snapshot
+ * @seq:	receives the sequence number of the snapshot
+ * @return:	the snapshot, NULL if snapshots are not enabled */
+LIBV4L_PUBLIC const struct v4l2_rds *v4l2_rds_snapshot_begin
+	(const struct v4l2_rds *handle, uint32_t *seq);
+
+/* checks if the snapshot read since v4l2_rds_snapshot_begin() was
+ * overwritten in the meantime
+ * @return:	true if the read data is inconsistent and has to be read again,
+ *		false if snapshots are not enabled */
+LIBV4L_PUBLIC bool v4l2_rds_snapshot_retry(const struct v4l2_rds *handle, uint32_t seq);
+
+/* copies the latest snapshot, for readers that need the whole handle
+ * @return:	false if snapshots are not enabled */
+LIBV4L_PUBLIC bool v4l2_rds_get_snapshot(const struct v4l2_rds *handle,
+		struct v4l2_rds *snapshot);
+
+/*
+ * publication in shared memory
+ *
+ * Only one process can read the RDS blocks of a radio device. To share
+ * the decoded data with other processes, the owner of the device can
+ * publish the state of its handle and a ring of the recently decoded
+ * groups in a POSIX shared memory segment. Subscribers map the segment
+ * read-only and read it without locks and without involving the
+ * publisher, in the same way as the snapshots of a handle:
+ *
+ *	do {
+ *		s = v4l2_rds_shm_state_begin(shm, &seq);
+ *		memcpy(ps, s->ps, sizeof(ps));
+ *	} while (v4l2_rds_shm_state_retry(shm, seq));
+ *
+ * The state is published at the same points as the snapshots. It holds
+ * only the public part of the handle, so functions that need the private
+ * decoder state (like v4l2_rds_get_af_lists(), v4l2_rds_get_eons() or
+ * v4l2_rds_get_rtplus())
+ * must not be called with it. Publisher and subscribers have to use the
+ * same version of the library, v4l2_rds_shm_open() rejects segments with
+ * a different layout */
+struct v4l2_rds_shm;
+
+/* creates the shared memory segment name (see shm_open(), e.g. "/rds0")
+ * for publishing. An existing segment of that name is only replaced when
+ * its publisher closed it or died, otherwise this fails with EEXIST
+ * @group_slots:	number of groups kept in the ring, rounded up to a
+ *			power of 2
+ * @return:	segment handle, NULL on error (errno is set) */
+LIBV4L_PUBLIC struct v4l2_rds_shm *v4l2_rds_shm_create(const char *name,
+		unsigned group_slots);
+
+/* publishes the state and the decoded groups of a handle in a segment
+ * created by v4l2_rds_shm_create(), NULL stops the publication. The
+ * segment must not be published by more than one handle */
+LIBV4L_PUBLIC void v4l2_rds_set_shm(struct v4l2_rds *handle, struct v4l2_rds_shm *shm);
+
+/* opens a published segment read-only
+ * @return:	segment handle, NULL on error (errno is set, EAGAIN if the
+ *		publisher didn't finish creating the segment yet) */
+LIBV4L_PUBLIC struct v4l2_rds_shm *v4l2_rds_shm_open(const char *name);
+
+/* unmaps a segment and frees the handle. The publisher removes the
+ * segment name and marks the segment as closed, subscribers that have
+ * it mapped can still read the last published data
+ * @return:	0 on success, -1 if the name couldn't be removed (errno is set) */
+LIBV4L_PUBLIC int v4l2_rds_shm_close(struct v4l2_rds_shm *shm);
+
+/* checks if the publisher closed the segment */
+LIBV4L_PUBLIC bool v4l2_rds_shm_is_closed(const struct v4l2_rds_shm *shm);
+
+/* starts reading the latest published state
+ * @seq:	receives the sequence number of the state
+ * @return:	the state, in the mapped segment */
+LIBV4L_PUBLIC const struct v4l2_rds *v4l2_rds_shm_state_begin
+	(const struct v4l2_rds_shm *shm, uint32_t *seq);
+
+/* checks if the state read since v4l2_rds_shm_state_begin() was
+ * overwritten in the meantime
+ * @return:	true if the read data is inconsistent and has to be read again */
+LIBV4L_PUBLIC bool v4l2_rds_shm_state_retry(const struct v4l2_rds_shm *shm, uint32_t seq);
+
+/* copies the latest published state
+ * @return:	sequence number of the state, it changes with every
+ *		publication */
+LIBV4L_PUBLIC uint32_t v4l2_rds_shm_get_state(const struct v4l2_rds_shm *shm,
+		struct v4l2_rds *state);
+
+/* returns the position of the next group to be published, subscribers
+ * that only want new groups start reading there */
+LIBV4L_PUBLIC uint32_t v4l2_rds_shm_get_group_pos(const struct v4l2_rds_shm *shm);
+
+/* copies up to n groups, starting at position *pos
+ * @pos:	position of the next group to read, updated on return
+ * @lost:	incremented by the number of groups that were overwritten
+ *		before they could be read
+ * @return:	number of copied groups */
+LIBV4L_PUBLIC unsigned v4l2_rds_shm_get_groups(const struct v4l2_rds_shm *shm,
+		uint32_t *pos, struct v4l2_rds_group *groups, unsigned n,
+		uint32_t *lost);
+
+/*
+ * reception quality metrics
+ *
+ * The statistics of the handle only count since the handle was created.
+ * For monitoring a receiver, the metrics describe the recent reception:
+ * block error rate and group rates over a rolling window, how long it took
+ * to receive PI, PS and RT, and how the gaps between decoded groups are
+ * distributed.
+ * All times are stream time: every block passed to the handle advances
+ * the clock by the transmission time of a block (26 bits at 1187.5 bit/s,
+ * about 21.9ms). Drivers pass on erroneous blocks too, so stream time
+ * follows the wall clock during live reception, and replayed streams give
+ * the same metrics as the live reception did. The metrics restart with
+ * every v4l2_rds_reset() */
+
+/* number of bins of the histogram of the gaps between decoded groups */
+#define V4L2_RDS_METRICS_GAP_BINS 8
+/* length of the rolling window in seconds */
+#define V4L2_RDS_METRICS_WINDOW 10
+
+/* struct to encapsulate the reception quality metrics */
+struct v4l2_rds_metrics {
+	uint32_t time;			/* stream time since the reset in ms */
+	uint32_t window;		/* time covered by the rolling window
+					 * in ms, up to V4L2_RDS_METRICS_WINDOW s */
+	uint32_t window_blocks;		/* blocks received within the window */
+	uint32_t window_block_errors;	/* of which were erroneous */
+	uint32_t window_block_corrected; /* of which were corrected */
+	float block_error_rate;		/* window_block_errors / window_blocks */
+	float group_rate[16];		/* decoded groups per second within the
+					 * window, for each group id */
+	uint32_t time_to_pi;		/* stream time in ms until PI, PS and */
+	uint32_t time_to_ps;		/* the complete RT were valid, 0 if they */
+	uint32_t time_to_rt;		/* are not valid yet */
+	uint32_t gap_hist[V4L2_RDS_METRICS_GAP_BINS];	/* gaps between
+					 * decoded groups since the reset, bin n
+					 * counts gaps of up to 2^n group
+					 * durations (87.6ms), the last bin all
+					 * longer gaps */
+};
+
+/* enables the collection of metrics. Without metrics, decoding doesn't
+ * spend any time on them
+ * @return:	0 on success, -1 if out of memory */
+LIBV4L_PUBLIC int v4l2_rds_enable_metrics(struct v4l2_rds *handle);
+
+/* computes the current metrics, this is cheap enough to be called after
+ * every read from the device
+ * @return:	false if metrics are not enabled */
+LIBV4L_PUBLIC bool v4l2_rds_get_metrics(const struct v4l2_rds *handle,
+		struct v4l2_rds_metrics *metrics);
+
+/*
+ * station cache
+ *
+ * Retuning throws away all information about the station, and learning
+ * it again from the air takes seconds. A station cache keeps the slowly
+ * changing fields (PTY, TP, PS, DI, PTYN, AF, ECC, LC and ODAs) of
+ * recently received stations, keyed by PI and ECC. When a handle with a
+ * cache accepts a new PI code, the fields of the previous station are
+ * merged into the cache and the cached fields of the new station are
+ * restored at once (and reported as updated). Later groups update the
+ * restored fields as usual.
+ * A cache can be shared by several handles, but is not thread-safe */
+struct v4l2_rds_cache;
+
+/* creates a station cache
+ * @max_stations:	number of stations to keep (1..65535), the least
+ *			recently used station is dropped if the cache is full
+ * @return:		cache, NULL on error (errno is set) */
+LIBV4L_PUBLIC struct v4l2_rds_cache *v4l2_rds_cache_create(unsigned max_stations);
+
+/* frees a station cache, it must not be in use by any handle */
+LIBV4L_PUBLIC void v4l2_rds_cache_destroy(struct v4l2_rds_cache *cache);
+
+/* attaches a station cache to the handle (NULL detaches the cache). The
+ * current station is stored in the cache here, in v4l2_rds_reset() and in
+ * v4l2_rds_destroy() */
+LIBV4L_PUBLIC void v4l2_rds_set_cache(struct v4l2_rds *handle, struct v4l2_rds_cache *cache);
+
+/*
+ * change notification events
+ *
+ * Instead of comparing the whole handle after every group, applications
+ * can enable a queue of fine-grained change events. Events are queued
+ * while blocks are added and fetched with v4l2_rds_get_event() */
+
+/* Define Constants for the types of change events
+ * used as type field of v4l2_rds_event and in the mask of enabled events */
+#define V4L2_RDS_EVENT_PI		0x0001	/* value: new PI code */
+#define V4L2_RDS_EVENT_PTY		0x0002	/* value: new PTY */
+#define V4L2_RDS_EVENT_TP		0x0004	/* value: new TP flag */
+#define V4L2_RDS_EVENT_TA		0x0008	/* value: new TA flag */
+#define V4L2_RDS_EVENT_MS		0x0010	/* value: new Music / Speech flag */
+#define V4L2_RDS_EVENT_DI		0x0020	/* value: new Decoder Information */
+#define V4L2_RDS_EVENT_PS		0x0040	/* new PS name validated, value:
+						 * bitmask of the changed char
+						 * positions, data: the PS name */
+#define V4L2_RDS_EVENT_PTYN		0x0080	/* data: new PTYN */
+#define V4L2_RDS_EVENT_RT_CLEAR		0x0100	/* A/B flag toggled, a new RT
+						 * follows. value: new flag */
+#define V4L2_RDS_EVENT_RT_SEGMENT	0x0200	/* RT segment received, value:
+						 * segment number, data: chars
+						 * as received for positions
+						 * pos..pos+len-1 of the RT */
+#define V4L2_RDS_EVENT_RT		0x0400	/* complete new RT, value: length */
+#define V4L2_RDS_EVENT_AF		0x0800	/* AF added, value: AF in Hz */
+#define V4L2_RDS_EVENT_TIME		0x1000	/* time: new clock time */
+#define V4L2_RDS_EVENT_ECC		0x2000	/* value: new Extended Country Code */
+#define V4L2_RDS_EVENT_LC		0x4000	/* value: new Language Code */
+#define V4L2_RDS_EVENT_ODA		0x8000	/* oda: newly announced ODA */
+#define V4L2_RDS_EVENT_TMC		0x10000	/* TMC message stored or changed,
+						 * value: its sequence number
+						 * in the TMC message store */
+#define V4L2_RDS_EVENT_EON		0x20000	/* information about an other
+						 * network changed, value: its
+						 * PI code */
+#define V4L2_RDS_EVENT_RTPLUS		0x40000	/* RT+ tag complete or changed,
+						 * value: content type, pos and
+						 * len: position of the tag in
+						 * the RT, data: its first chars */
+#define V4L2_RDS_EVENT_OVERFLOW		0x80000000 /* the queue overflowed, value:
+						 * number of lost events. Always
+						 * enabled */
+#define V4L2_RDS_EVENT_ALL		0x0007ffff
+
+/* struct to encapsulate one change event */
+struct v4l2_rds_event {
+	uint32_t type;		/* V4L2_RDS_EVENT_* */
+	uint32_t value;		/* type dependent value, see V4L2_RDS_EVENT_* */
+	uint8_t pos;		/* position of data[0] within PS / PTYN / RT */
+	uint8_t len;		/* number of chars in data */
+	uint8_t data[8];	/* PS / PTYN / RT chars */
+	struct v4l2_rds_oda oda;	/* announced ODA */
+	time_t time;		/* decoded clock time */
+};
+
+/* selects the types of events that are queued, 0 (the default) disables
+ * the event queue. Queued events are kept, v4l2_rds_reset() clears the
+ * queue but keeps the mask
+ * @event_mask:	bitmask of V4L2_RDS_EVENT_* types */
+LIBV4L_PUBLIC void v4l2_rds_set_events(struct v4l2_rds *handle, uint32_t event_mask);
+
+/* fetches the oldest event from the queue. The queue holds 128 events,
+ * if it overflows the oldest events are dropped and a
+ * V4L2_RDS_EVENT_OVERFLOW event is returned before the remaining ones
+ * @return:	true if an event was stored in ev, false if the queue is empty */
+LIBV4L_PUBLIC bool v4l2_rds_get_event(struct v4l2_rds *handle, struct v4l2_rds_event *ev);
+
+/*
+ * ODA decoders
+ *
+ * Open Data Applications are announced in type 3A groups, together with
+ * the group type carrying their data. Decoders for ODAs are registered
+ * per handle and AID, and are called for all groups of the announced
+ * group type. The RT+ decoder of the library is registered by default */
+
+/* struct to encapsulate a decoder for one ODA */
+struct v4l2_rds_oda_decoder {
+	uint16_t aid;		/* Application Identification of the ODA */
+	/* called for the type 3A groups announcing the ODA, may be NULL.
+	 * Block C of these groups carries ODA specific data
+	 * @return:	bitmask of the updated fields (V4L2_RDS_*) */
+	uint32_t (*announce)(struct v4l2_rds *handle,
+			const struct v4l2_rds_group *group, void *priv);
+	/* called for every group of the announced group type, with blocks
+	 * B, C (version A only) and D received without errors
+	 * @return:	bitmask of the updated fields (V4L2_RDS_*) */
+	uint32_t (*decode)(struct v4l2_rds *handle,
+			const struct v4l2_rds_group *group, void *priv);
+	void *priv;		/* passed to announce and decode */
+};
+
+/* registers a decoder, replacing the decoder registered for the same AID.
+ * Up to 8 decoders can be registered, they are kept by v4l2_rds_reset()
+ * @return:	0 on success, -1 on error (errno is set) */
+LIBV4L_PUBLIC int v4l2_rds_register_oda(struct v4l2_rds *handle,
+		const struct v4l2_rds_oda_decoder *decoder);
+
+/* removes the decoder registered for an AID */
+LIBV4L_PUBLIC void v4l2_rds_unregister_oda(struct v4l2_rds *handle, uint16_t aid);
+
+/*
+ * Radio Text Plus (RT+)
+ *
+ * RT+ tags mark parts of the Radio Text, like the artist and the title of
+ * the song being played. A tag is reported as soon as the RT segments it
+ * refers to are received, the tags of an item (e.g. a song) are dropped
+ * when the next item starts */
+
+/* content types of RT+ tags, see the RT+ specification for the others */
+#define V4L2_RDS_RTPLUS_TITLE		1
+#define V4L2_RDS_RTPLUS_ALBUM		2
+#define V4L2_RDS_RTPLUS_TRACKNUMBER	3
+#define V4L2_RDS_RTPLUS_ARTIST		4
+#define V4L2_RDS_RTPLUS_COMPOSITION	5
+#define V4L2_RDS_RTPLUS_MOVEMENT	6
+#define V4L2_RDS_RTPLUS_CONDUCTOR	7
+#define V4L2_RDS_RTPLUS_COMPOSER	8
+#define V4L2_RDS_RTPLUS_BAND		9
+#define V4L2_RDS_RTPLUS_COMMENT		10
+#define V4L2_RDS_RTPLUS_GENRE		11
+
+#define V4L2_RDS_RTPLUS_MAX_TAGS	8
+
+/* struct to encapsulate one RT+ tag */
+struct v4l2_rds_rtplus_tag {
+	uint8_t content_type;	/* V4L2_RDS_RTPLUS_* */
+	uint8_t start;		/* position of the tag in the RT */
+	uint8_t len;		/* length of the tag */
+	uint8_t text[65];	/* the tagged text, '\0' terminated */
+};
+
+/* struct to encapsulate the RT+ tags of the current item */
+struct v4l2_rds_rtplus {
+	bool item_toggle;	/* toggled when a new item starts */
+	bool item_running;	/* an item is running, false between items */
+	uint8_t size;		/* number of tags */
+	struct v4l2_rds_rtplus_tag tag[V4L2_RDS_RTPLUS_MAX_TAGS];	/* one
+				 * per content type, in order of reception */
+};
+
+/* returns the RT+ tags of the current item */
+LIBV4L_PUBLIC const struct v4l2_rds_rtplus *v4l2_rds_get_rtplus
+	(const struct v4l2_rds *handle);
+
+/* returns the RT+ tag of the current item with the given content type,
+ * NULL if there is no such tag */
+LIBV4L_PUBLIC const struct v4l2_rds_rtplus_tag *v4l2_rds_get_rtplus_tag
+	(const struct v4l2_rds *handle, uint8_t content_type);
+
+/*
+ * TMC (Traffic Message Channel)
+ *
+ * TMC messages are broadcast in type 8A groups, either in a single group
+ * or in up to 5 groups carrying additional information in a free format.
+ * Decoded messages are kept in a message store, which can be shared by
+ * the handles of several tuners. A message replaces an earlier one with
+ * the same location table, location, direction and event, receiving an
+ * unchanged message again only extends its lifetime. Messages expire
+ * after the duration they were sent with (15 minutes if unknown).
+ * A store is not thread-safe */
+
+/* flags of a TMC message */
+#define V4L2_RDS_TMC_NEGATIVE	0x01	/* the queue grows in negative
+					 * direction of the road */
+#define V4L2_RDS_TMC_DIVERSION	0x02	/* diversion advised */
+#define V4L2_RDS_TMC_MULTI_GROUP 0x04	/* multi-group message, with free
+					 * format data */
+
+/* struct to encapsulate one TMC message */
+struct v4l2_rds_tmc_msg {
+	uint16_t pi;		/* station that sent the message last */
+	uint16_t location;	/* location code of the primary location */
+	uint16_t event;		/* event code (11 bits) */
+	uint8_t extent;		/* number of steps to the secondary location */
+	uint8_t flags;		/* V4L2_RDS_TMC_* */
+	uint8_t duration;	/* duration code (0..7) */
+	uint8_t ltn;		/* location table number, 0 if unknown */
+	uint8_t data_bits;	/* number of bits in data */
+	uint8_t data[14];	/* free format data of multi-group messages,
+				 * most significant bit first */
+	uint32_t seq;		/* sequence number of the last change */
+	time_t received;	/* time of the last reception */
+	time_t expires;		/* the message is removed at this time */
+};
+
+struct v4l2_rds_tmc;
+
+/* creates a TMC message store
+ * @max_messages:	number of messages to keep (1..65535), the message
+ *			closest to expiry is dropped if the store is full
+ * @return:		store, NULL on error (errno is set) */
+LIBV4L_PUBLIC struct v4l2_rds_tmc *v4l2_rds_tmc_create(unsigned max_messages);
+
+/* frees a TMC message store, it must not be in use by any handle */
+LIBV4L_PUBLIC void v4l2_rds_tmc_destroy(struct v4l2_rds_tmc *tmc);
+
+/* attaches a TMC message store to the handle (NULL detaches it). Type 8A
+ * groups are only decoded if a store is attached, new and changed messages
+ * set V4L2_RDS_TMC in the updated fields */
+LIBV4L_PUBLIC void v4l2_rds_set_tmc(struct v4l2_rds *handle, struct v4l2_rds_tmc *tmc);
+
+/* sets the clock of the store and removes the expired messages. Received
+ * messages are timestamped with this clock, which starts at the creation
+ * time of the store, so it should be called regularly (e.g. every second)
+ * @now:	current time
+ * @return:	number of removed messages */
+LIBV4L_PUBLIC unsigned v4l2_rds_tmc_expire(struct v4l2_rds_tmc *tmc, time_t now);
+
+/* returns the sequence number of the last change of the store */
+LIBV4L_PUBLIC uint32_t v4l2_rds_tmc_get_seq(const struct v4l2_rds_tmc *tmc);
+
+/* copies the messages that were stored or changed after the change with
+ * sequence number since (0 = all messages), in no particular order
+ * @msgs:	array of max messages
+ * @return:	number of copied messages */
+LIBV4L_PUBLIC unsigned v4l2_rds_tmc_get_messages(const struct v4l2_rds_tmc *tmc,
+		uint32_t since, struct v4l2_rds_tmc_msg *msgs, unsigned max);
+
 /*
  * group of functions to translate numerical RDS data into strings
  *
@@ -206,11 +721,158 @@ LIBV4L_PUBLIC const char *v4l2_rds_get_language_str(const struct v4l2_rds *handl
 LIBV4L_PUBLIC const char *v4l2_rds_get_country_str(const struct v4l2_rds *handle);
 LIBV4L_PUBLIC const char *v4l2_rds_get_coverage_str(const struct v4l2_rds *handle);
 
+/* struct to encapsulate the codes of a station that are translated by
+ * v4l2_rds_get_strs(), e.g. taken from a station list */
+struct v4l2_rds_str_key {
+	uint16_t pi;		/* Program Identification */
+	uint8_t pty;		/* Program Type */
+	uint8_t ecc;		/* Extended Country Code */
+	uint8_t lc;		/* Language Code */
+	bool is_rbds;		/* use the RBDS program types */
+};
+
+/* struct to encapsulate the strings of one station, as returned by the
+ * v4l2_rds_get_*_str() functions */
+struct v4l2_rds_strs {
+	const char *pty;
+	const char *country;
+	const char *language;
+	const char *coverage;
+};
+
+/* translates the codes of n stations at once, for tools that display
+ * long station lists */
+LIBV4L_PUBLIC void v4l2_rds_get_strs(const struct v4l2_rds_str_key *keys,
+		unsigned n, struct v4l2_rds_strs *strs);
+
 /* returns a pointer to the last decoded RDS group, in order to give raw
  * access to RDS data if it is required (e.g. ODA decoding) */
 LIBV4L_PUBLIC const struct v4l2_rds_group *v4l2_rds_get_group
 	(const struct v4l2_rds *handle);
 
+/* returns all AF Method B lists of the station, sorted by tuned frequency.
+ * The lists are valid until the next block is added or the handle is reset
+ * @cnt:	receives the number of lists */
+LIBV4L_PUBLIC const struct v4l2_rds_af_list *v4l2_rds_get_af_lists
+	(const struct v4l2_rds *handle, unsigned *cnt);
+
+/* returns the AF Method B list for the tuned frequency (in Hz), NULL if
+ * no such list was received */
+LIBV4L_PUBLIC const struct v4l2_rds_af_list *v4l2_rds_get_af_list
+	(const struct v4l2_rds *handle, uint32_t tuned_freq);
+
+/* checks if freq is an AF when tuned to tuned_freq (both in Hz). The
+ * Method B list of tuned_freq is used if it was received, the set of all
+ * AFs (rds_af) otherwise. Binary search, O(log n)
+ * @flags:	optional (may be NULL), receives the V4L2_RDS_AF_* flags */
+LIBV4L_PUBLIC bool v4l2_rds_is_af(const struct v4l2_rds *handle,
+		uint32_t tuned_freq, uint32_t freq, uint8_t *flags);
+
+/* returns the other networks announced by EON groups (V4L2_RDS_EON), in
+ * the order of their first reception. They are valid until the next block
+ * is added or the handle is reset
+ * @cnt:	receives the number of other networks */
+LIBV4L_PUBLIC const struct v4l2_rds_eon *v4l2_rds_get_eons
+	(const struct v4l2_rds *handle, unsigned *cnt);
+
+/* returns the information about the other network with the given PI
+ * code, NULL if no EON group announced it */
+LIBV4L_PUBLIC const struct v4l2_rds_eon *v4l2_rds_get_eon
+	(const struct v4l2_rds *handle, uint16_t pi);
+
+/* returns the frequency (in Hz) to tune to the other network with the
+ * given PI code, when tuned to tuned_freq (in Hz). A mapped frequency of
+ * tuned_freq is returned if there is one (FM frequencies first), the
+ * lowest AF of the other network otherwise, 0 if neither was received */
+LIBV4L_PUBLIC uint32_t v4l2_rds_get_eon_freq(const struct v4l2_rds *handle,
+		uint16_t pi, uint32_t tuned_freq);
+
+/*
+ * RDS capture files
+ *
+ * A capture file stores received RDS blocks for long-term recordings, in
+ * fixed-size records with the reception time and the tuner frequency,
+ * followed by a sparse index by time (one entry per minute) and by PI code
+ * (one segment per station / frequency change). Capture files are
+ * memory-mapped for reading, seeking to any point in time only touches the
+ * index and a binary search over one minute of records.
+ * All values are stored in host byte order. Files of captures that were
+ * not closed properly have no index, it is rebuilt when opening them */
+
+/* struct to encapsulate one record of a capture file */
+struct v4l2_rds_capture_block {
+	uint32_t time_ms;	/* reception time in ms, relative to the
+				 * start time of the capture */
+	uint32_t freq;		/* tuner frequency in Hz, 0 if unknown */
+	struct v4l2_rds_data data;	/* the RDS block as read from the device */
+	uint8_t reserved;
+};
+
+/* struct to encapsulate one entry of the PI index of a capture file */
+/* a new segment starts whenever the tuner frequency or the (confirmed)
+ * PI code of the received station changes */
+struct v4l2_rds_capture_segment {
+	uint64_t first_block;	/* number of the first block of the segment */
+	uint64_t block_cnt;	/* number of blocks in the segment */
+	uint32_t time_ms;	/* start time, relative to the capture start */
+	uint32_t freq;		/* tuner frequency in Hz, 0 if unknown */
+	uint16_t pi;		/* Program Identification, 0 if unknown */
+	uint16_t reserved[3];
+};
+
+struct v4l2_rds_capture;
+
+/* creates a new capture file for writing
+ * @start_time:	start time of the capture in ms since the Epoch, a capture
+ *		can span up to 49 days
+ * @return:	capture handle, NULL on error (errno is set) */
+LIBV4L_PUBLIC struct v4l2_rds_capture *v4l2_rds_capture_create(const char *path,
+		uint64_t start_time);
+
+/* appends RDS blocks to a capture file opened by v4l2_rds_capture_create()
+ * @rds_data:	array of n RDS blocks
+ * @time:	reception time of the blocks in ms since the Epoch, earlier
+ *		times than the one of the last written block are adjusted
+ * @freq:	tuner frequency in Hz, 0 if unknown
+ * @return:	0 on success, -1 on error (errno is set). After an error
+ *		writing the file the capture is stopped, the records written
+ *		up to that point are kept */
+LIBV4L_PUBLIC int v4l2_rds_capture_write(struct v4l2_rds_capture *cap,
+		const struct v4l2_rds_data *rds_data, unsigned n, uint64_t time,
+		uint32_t freq);
+
+/* opens a capture file for reading by memory-mapping it
+ * @return:	capture handle, NULL on error (errno is set) */
+LIBV4L_PUBLIC struct v4l2_rds_capture *v4l2_rds_capture_open(const char *path);
+
+/* closes a capture file and frees the handle. The index of written
+ * captures is stored at this point
+ * @return:	0 on success, -1 if writing the capture failed (errno is set) */
+LIBV4L_PUBLIC int v4l2_rds_capture_close(struct v4l2_rds_capture *cap);
+
+/* returns the start time of a capture in ms since the Epoch */
+LIBV4L_PUBLIC uint64_t v4l2_rds_capture_get_start_time(const struct v4l2_rds_capture *cap);
+
+/* returns the records of a capture opened by v4l2_rds_capture_open()
+ * @block_cnt:	receives the number of records */
+LIBV4L_PUBLIC const struct v4l2_rds_capture_block *v4l2_rds_capture_get_blocks
+	(const struct v4l2_rds_capture *cap, uint64_t *block_cnt);
+
+/* returns the number of the first record received at or after time (in ms
+ * since the Epoch), the number of records if there is no such record */
+LIBV4L_PUBLIC uint64_t v4l2_rds_capture_seek(const struct v4l2_rds_capture *cap,
+		uint64_t time);
+
+/* returns the PI index of a capture
+ * @seg_cnt:	receives the number of segments */
+LIBV4L_PUBLIC const struct v4l2_rds_capture_segment *v4l2_rds_capture_get_segments
+	(const struct v4l2_rds_capture *cap, unsigned *seg_cnt);
+
+/* returns the number of the first segment starting at segment number from
+ * with the given PI code, -1 if there is no such segment */
+LIBV4L_PUBLIC int v4l2_rds_capture_find_pi(const struct v4l2_rds_capture *cap,
+		uint16_t pi, unsigned from);
+
 
 #ifdef __cplusplus
 }
@@ -89,8 +89,19 @@ LIBV4L_PUBLIC int v4lconvert_needs_conversion(struct v4lconvert_data *data,
 		const struct v4l2_format *src_fmt,   /* in */
 		const struct v4l2_format *dest_fmt); /* in */
 
+/* Can the next frame be used as is? Unlike v4lconvert_needs_conversion() this
+   looks at the current flip and processing settings, so the answer may change
+   from frame to frame. When true, v4lconvert_convert() would just copy src to
+   dest, callers which can use the src buffer directly may skip it, or pass
+   dest == src to get the frame size without any copying. */
+LIBV4L_PUBLIC int v4lconvert_can_pass_through(struct v4lconvert_data *data,
+		const struct v4l2_format *src_fmt,   /* in */
+		const struct v4l2_format *dest_fmt); /* in */
+
 /* return value of -1 on error, otherwise the amount of bytes written to
-   dest */
+   dest. The lines written to dest are dest_fmt->fmt.pix.bytesperline bytes
+   apart, for writing into buffers with padding at the end of the lines, a
+   bytesperline which is too small for a line (0) means no padding. */
 LIBV4L_PUBLIC int v4lconvert_convert(struct v4lconvert_data *data,
 		const struct v4l2_format *src_fmt,  /* in */
 		const struct v4l2_format *dest_fmt, /* in */
@@ -125,6 +136,16 @@ LIBV4L_PUBLIC int v4lconvert_supported_dst_format(unsigned int pixelformat);
 LIBV4L_PUBLIC int v4lconvert_get_fps(struct v4lconvert_data *data);
 LIBV4L_PUBLIC void v4lconvert_set_fps(struct v4lconvert_data *data, int fps);
 
+/* Get/set the no threads v4lconvert_convert() uses for large frames, which
+   are split into horizontal bands. The default is 1, only the calling thread,
+   unless the LIBV4LCONVERT_THREADS environment variable says otherwise. The
+   extra threads belong to the convert instance, so it still must not be used
+   from multiple threads at once. v4lconvert_set_threads returns 0 on success,
+   -1 on error. */
+LIBV4L_PUBLIC int v4lconvert_get_threads(struct v4lconvert_data *data);
+LIBV4L_PUBLIC int v4lconvert_set_threads(struct v4lconvert_data *data,
+		int threads);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -365,6 +365,25 @@ static int v4l2_read_and_convert(int index, unsigned char *dest, int dest_size)
 
 	buf_size = devices[index].dest_fmt.fmt.pix.sizeimage;
 
+	/* When the frame can be used as is, read it straight into dest instead
+	   of reading it into readbuf and copying it from there */
+	if (dest_size >= buf_size &&
+			v4lconvert_can_pass_through(devices[index].convert,
+				&devices[index].src_fmt, &devices[index].dest_fmt)) {
+		result = devices[index].dev_ops->read(
+				devices[index].dev_ops_priv,
+				devices[index].fd, dest, buf_size);
+		if (result < 0 && errno != EAGAIN) {
+			int saved_err = errno;
+
+			V4L2_LOG_ERR("reading: %s\n", strerror(errno));
+			errno = saved_err;
+		}
+		if (result > 0 && devices[index].first_frame)
+			devices[index].first_frame--;
+		return result;
+	}
+
 	if (devices[index].readbuf_size < buf_size) {
 		unsigned char *new_buf;
 
@@ -0,0 +1,508 @@
+/*
+ * RDS capture files: recording and memory-mapped replay of RDS blocks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335  USA
+ */
+
+#include <errno.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <config.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <linux/videodev2.h>
+
+#include "../include/libv4l2rds.h"
+
+#define RDS_CAPTURE_MAGIC	"V4L2RDSC"
+#define RDS_CAPTURE_VERSION	1
+/* time between two entries of the time index, in ms */
+#define RDS_CAPTURE_INTERVAL	60000
+/* number of records written to the file at once */
+#define RDS_CAPTURE_BATCH	64
+
+/* file layout:
+ * header | records | padding to 8 bytes | time index | PI index
+ * The time index has one entry for every interval since the start of
+ * the capture: the number of the first record received in that interval */
+struct rds_capture_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t block_size;		/* sizeof(struct v4l2_rds_capture_block) */
+	uint64_t start_time;		/* ms since the Epoch */
+	uint64_t block_cnt;		/* 0 if the capture wasn't closed */
+	uint64_t time_index_offset;	/* 0 if the capture wasn't closed */
+	uint32_t time_index_cnt;
+	uint32_t time_interval;		/* ms between two time index entries */
+	uint64_t pi_index_offset;
+	uint32_t pi_index_cnt;
+	uint32_t reserved;
+};
+
+struct v4l2_rds_capture {
+	FILE *f;			/* capture file, for writing only,
+					 * NULL once writing failed */
+	int write_err;			/* errno of the failed write */
+	void *map;			/* mapping of the capture file,
+					 * for reading only */
+	size_t map_size;
+	uint64_t start_time;
+	uint32_t time_interval;
+
+	const struct v4l2_rds_capture_block *blocks;
+	uint64_t block_cnt;
+
+	uint64_t *time_index;
+	uint32_t time_index_cnt;
+	uint32_t time_index_size;	/* allocated entries, 0 if the index
+					 * is part of the mapping */
+	struct v4l2_rds_capture_segment *segs;
+	uint32_t seg_cnt;
+	uint32_t seg_size;		/* allocated entries, 0 if the index
+					 * is part of the mapping */
+
+	/* indexing state */
+	uint32_t last_time;		/* time of the last record */
+	uint16_t new_pi;		/* PI received once, not yet confirmed */
+	uint64_t new_pi_block;		/* first record with new_pi */
+	uint32_t new_pi_time;
+};
+
+/* grows an index array if it is full, returns false if out of memory */
+static bool rds_capture_grow(void **array, uint32_t *size, uint32_t cnt,
+		size_t entry_size)
+{
+	void *p;
+
+	if (cnt < *size)
+		return true;
+	p = realloc(*array, (*size ? *size * 2 : 256) * entry_size);
+	if (!p)
+		return false;
+	*array = p;
+	*size = *size ? *size * 2 : 256;
+	return true;
+}
+
+static bool rds_capture_new_segment(struct v4l2_rds_capture *cap,
+		uint64_t first_block, uint32_t time_ms, uint32_t freq, uint16_t pi)
+{
+	struct v4l2_rds_capture_segment *seg;
+
+	if (!rds_capture_grow((void **)&cap->segs, &cap->seg_size, cap->seg_cnt,
+			sizeof(*seg)))
+		return false;
+	seg = &cap->segs[cap->seg_cnt++];
+	memset(seg, 0, sizeof(*seg));
+	seg->first_block = first_block;
+	seg->time_ms = time_ms;
+	seg->freq = freq;
+	seg->pi = pi;
+	return true;
+}
+
+/* adds the record with the number block_nr to the time and PI index */
+static bool rds_capture_index(struct v4l2_rds_capture *cap, uint64_t block_nr,
+		const struct v4l2_rds_capture_block *block)
+{
+	struct v4l2_rds_capture_segment *seg;
+	uint16_t pi;
+
+	while ((uint64_t)cap->time_index_cnt * cap->time_interval <= block->time_ms) {
+		if (!rds_capture_grow((void **)&cap->time_index, &cap->time_index_size,
+				cap->time_index_cnt, sizeof(*cap->time_index)))
+			return false;
+		cap->time_index[cap->time_index_cnt++] = block_nr;
+	}
+
+	seg = cap->seg_cnt ? &cap->segs[cap->seg_cnt - 1] : NULL;
+	if (!seg || seg->freq != block->freq) {
+		cap->new_pi = 0;
+		return rds_capture_new_segment(cap, block_nr, block->time_ms,
+				block->freq, 0);
+	}
+
+	/* the PI code is taken from error free A blocks and has to be
+	 * received twice in a row, like in the decoder */
+	if ((block->data.block & (V4L2_RDS_BLOCK_ERROR | V4L2_RDS_BLOCK_MSK)) !=
+			V4L2_RDS_BLOCK_A)
+		return true;
+	pi = (block->data.msb << 8) | block->data.lsb;
+	if (pi != cap->new_pi) {
+		cap->new_pi = pi;
+		cap->new_pi_block = block_nr;
+		cap->new_pi_time = block->time_ms;
+		return true;
+	}
+	if (pi == seg->pi)
+		return true;
+	/* the first PI received on a frequency completes its segment */
+	if (!seg->pi) {
+		seg->pi = pi;
+		return true;
+	}
+	return rds_capture_new_segment(cap, cap->new_pi_block, cap->new_pi_time,
+			block->freq, pi);
+}
+
+/* sets the block count of all segments, once all records are indexed */
+static void rds_capture_finish_index(struct v4l2_rds_capture *cap)
+{
+	for (uint32_t i = 0; i < cap->seg_cnt; i++) {
+		uint64_t end = i + 1 < cap->seg_cnt ?
+			cap->segs[i + 1].first_block : cap->block_cnt;
+
+		cap->segs[i].block_cnt = end - cap->segs[i].first_block;
+	}
+}
+
+static void rds_capture_free(struct v4l2_rds_capture *cap)
+{
+	if (cap->time_index_size)
+		free(cap->time_index);
+	if (cap->seg_size)
+		free(cap->segs);
+	if (cap->map)
+		munmap(cap->map, cap->map_size);
+	free(cap);
+}
+
+struct v4l2_rds_capture *v4l2_rds_capture_create(const char *path,
+		uint64_t start_time)
+{
+	struct v4l2_rds_capture *cap = calloc(1, sizeof(*cap));
+	struct rds_capture_header hdr;
+
+	if (!cap)
+		return NULL;
+	cap->start_time = start_time;
+	cap->time_interval = RDS_CAPTURE_INTERVAL;
+
+	/* the header is rewritten with the index information when closing */
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, RDS_CAPTURE_MAGIC, sizeof(hdr.magic));
+	hdr.version = RDS_CAPTURE_VERSION;
+	hdr.block_size = sizeof(struct v4l2_rds_capture_block);
+	hdr.start_time = start_time;
+	hdr.time_interval = cap->time_interval;
+
+	cap->f = fopen(path, "w");
+	if (!cap->f || fwrite(&hdr, sizeof(hdr), 1, cap->f) != 1) {
+		int saved_err = errno;
+
+		if (cap->f)
+			fclose(cap->f);
+		free(cap);
+		errno = saved_err;
+		return NULL;
+	}
+	return cap;
+}
+
+/* stops writing a capture after an error. The header isn't updated, so
+ * the records written up to here are indexed again when it is opened */
+static int rds_capture_fail(struct v4l2_rds_capture *cap, int err)
+{
+	fclose(cap->f);
+	cap->f = NULL;
+	cap->write_err = err;
+	errno = err;
+	return -1;
+}
+
+int v4l2_rds_capture_write(struct v4l2_rds_capture *cap,
+		const struct v4l2_rds_data *rds_data, unsigned n, uint64_t time,
+		uint32_t freq)
+{
+	struct v4l2_rds_capture_block blocks[RDS_CAPTURE_BATCH];
+	uint64_t time_ms = time > cap->start_time ? time - cap->start_time : 0;
+
+	if (!cap->f) {
+		errno = cap->write_err ? cap->write_err : EBADF;
+		return -1;
+	}
+	if (time_ms > UINT32_MAX) {
+		errno = EOVERFLOW;
+		return -1;
+	}
+	if (time_ms < cap->last_time)
+		time_ms = cap->last_time;
+	cap->last_time = time_ms;
+
+	while (n) {
+		unsigned cnt = n < RDS_CAPTURE_BATCH ? n : RDS_CAPTURE_BATCH;
+
+		for (unsigned i = 0; i < cnt; i++) {
+			blocks[i].time_ms = time_ms;
+			blocks[i].freq = freq;
+			blocks[i].data = rds_data[i];
+			blocks[i].reserved = 0;
+		}
+		/* the index may only refer to records that are in the file */
+		if (fwrite(blocks, sizeof(blocks[0]), cnt, cap->f) != cnt)
+			return rds_capture_fail(cap, errno ? errno : EIO);
+		for (unsigned i = 0; i < cnt; i++)
+			if (!rds_capture_index(cap, cap->block_cnt + i, &blocks[i]))
+				return rds_capture_fail(cap, ENOMEM);
+		cap->block_cnt += cnt;
+		rds_data += cnt;
+		n -= cnt;
+	}
+	return 0;
+}
+
+/* writes the index and the final header of a capture */
+static int rds_capture_write_index(struct v4l2_rds_capture *cap)
+{
+	static const uint8_t padding[8];
+	struct rds_capture_header hdr;
+	uint64_t offset = sizeof(hdr) +
+		cap->block_cnt * sizeof(struct v4l2_rds_capture_block);
+
+	rds_capture_finish_index(cap);
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, RDS_CAPTURE_MAGIC, sizeof(hdr.magic));
+	hdr.version = RDS_CAPTURE_VERSION;
+	hdr.block_size = sizeof(struct v4l2_rds_capture_block);
+	hdr.start_time = cap->start_time;
+	hdr.block_cnt = cap->block_cnt;
+	hdr.time_interval = cap->time_interval;
+	hdr.time_index_offset = (offset + 7) & ~7ULL;
+	hdr.time_index_cnt = cap->time_index_cnt;
+	hdr.pi_index_offset = hdr.time_index_offset +
+		cap->time_index_cnt * sizeof(*cap->time_index);
+	hdr.pi_index_cnt = cap->seg_cnt;
+
+	if (fwrite(padding, 1, hdr.time_index_offset - offset, cap->f) !=
+			hdr.time_index_offset - offset ||
+	    fwrite(cap->time_index, sizeof(*cap->time_index), cap->time_index_cnt,
+			cap->f) != cap->time_index_cnt ||
+	    fwrite(cap->segs, sizeof(*cap->segs), cap->seg_cnt, cap->f) !=
+			cap->seg_cnt ||
+	    fseek(cap->f, 0, SEEK_SET) ||
+	    fwrite(&hdr, sizeof(hdr), 1, cap->f) != 1)
+		return -1;
+	return 0;
+}
+
+/* checks the index of a mapped capture, returns false if it is unusable.
+ * Nothing in the header is trusted, a file may be truncated or corrupt */
+static bool rds_capture_check_index(struct v4l2_rds_capture *cap,
+		const struct rds_capture_header *hdr)
+{
+	const uint64_t max_blocks = (cap->map_size - sizeof(*hdr)) /
+		sizeof(struct v4l2_rds_capture_block);
+	const uint64_t *time_index;
+	const struct v4l2_rds_capture_segment *segs;
+	uint64_t records_end;
+
+	if (!hdr->time_index_offset || !hdr->time_interval ||
+	    hdr->block_cnt > max_blocks)
+		return false;
+	records_end = sizeof(*hdr) +
+		hdr->block_cnt * sizeof(struct v4l2_rds_capture_block);
+	if (hdr->time_index_offset < records_end ||
+	    hdr->time_index_offset > cap->map_size ||
+	    hdr->time_index_offset % 8 ||
+	    hdr->time_index_cnt > (cap->map_size - hdr->time_index_offset) /
+			sizeof(uint64_t) ||
+	    hdr->pi_index_offset != hdr->time_index_offset +
+			(uint64_t)hdr->time_index_cnt * sizeof(uint64_t) ||
+	    hdr->pi_index_cnt > (cap->map_size - hdr->pi_index_offset) /
+			sizeof(struct v4l2_rds_capture_segment))
+		return false;
+
+	/* the entries have to be in order and within the records */
+	time_index = (const uint64_t *)((const uint8_t *)cap->map +
+			hdr->time_index_offset);
+	for (uint32_t i = 0; i < hdr->time_index_cnt; i++)
+		if (time_index[i] > hdr->block_cnt ||
+		    (i && time_index[i] < time_index[i - 1]))
+			return false;
+	segs = (const struct v4l2_rds_capture_segment *)
+		((const uint8_t *)cap->map + hdr->pi_index_offset);
+	for (uint32_t i = 0; i < hdr->pi_index_cnt; i++)
+		if (segs[i].first_block > hdr->block_cnt ||
+		    segs[i].block_cnt > hdr->block_cnt - segs[i].first_block ||
+		    (i && segs[i].first_block < segs[i - 1].first_block))
+			return false;
+
+	cap->block_cnt = hdr->block_cnt;
+	cap->time_interval = hdr->time_interval;
+	cap->time_index = (uint64_t *)time_index;
+	cap->time_index_cnt = hdr->time_index_cnt;
+	cap->segs = (struct v4l2_rds_capture_segment *)segs;
+	cap->seg_cnt = hdr->pi_index_cnt;
+	return true;
+}
+
+/* rebuilds the index of a capture that was not closed properly, the
+ * records written up to that point are kept */
+static bool rds_capture_rebuild_index(struct v4l2_rds_capture *cap)
+{
+	cap->block_cnt = (cap->map_size - sizeof(struct rds_capture_header)) /
+		sizeof(struct v4l2_rds_capture_block);
+	cap->time_interval = RDS_CAPTURE_INTERVAL;
+	madvise(cap->map, cap->map_size, MADV_SEQUENTIAL);
+	for (uint64_t i = 0; i < cap->block_cnt; i++) {
+		/* the records are written in the order of time, a time going
+		 * back is already part of an index that couldn't be used */
+		if (i && cap->blocks[i].time_ms < cap->blocks[i - 1].time_ms) {
+			cap->block_cnt = i;
+			break;
+		}
+		if (!rds_capture_index(cap, i, &cap->blocks[i]))
+			return false;
+	}
+	madvise(cap->map, cap->map_size, MADV_NORMAL);
+	rds_capture_finish_index(cap);
+	return true;
+}
+
+struct v4l2_rds_capture *v4l2_rds_capture_open(const char *path)
+{
+	struct v4l2_rds_capture *cap = calloc(1, sizeof(*cap));
+	const struct rds_capture_header *hdr;
+	struct stat st;
+	int saved_err;
+	int fd;
+
+	if (!cap)
+		return NULL;
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0)
+		goto error;
+	if ((uint64_t)st.st_size < sizeof(*hdr) || (uint64_t)st.st_size > SIZE_MAX) {
+		errno = EINVAL;
+		goto error;
+	}
+	cap->map_size = st.st_size;
+	cap->map = mmap(NULL, cap->map_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (cap->map == MAP_FAILED) {
+		cap->map = NULL;
+		goto error;
+	}
+	close(fd);
+	fd = -1;
+
+	hdr = cap->map;
+	if (memcmp(hdr->magic, RDS_CAPTURE_MAGIC, sizeof(hdr->magic)) ||
+	    hdr->version != RDS_CAPTURE_VERSION ||
+	    hdr->block_size != sizeof(struct v4l2_rds_capture_block)) {
+		errno = EINVAL;
+		goto error;
+	}
+	cap->start_time = hdr->start_time;
+	cap->blocks = (const struct v4l2_rds_capture_block *)(hdr + 1);
+	if (!rds_capture_check_index(cap, hdr) &&
+	    !rds_capture_rebuild_index(cap)) {
+		errno = ENOMEM;
+		goto error;
+	}
+	return cap;
+
+error:
+	saved_err = errno;
+	if (fd >= 0)
+		close(fd);
+	rds_capture_free(cap);
+	errno = saved_err;
+	return NULL;
+}
+
+int v4l2_rds_capture_close(struct v4l2_rds_capture *cap)
+{
+	int ret = 0;
+
+	if (cap->f) {
+		ret = rds_capture_write_index(cap);
+		if (fclose(cap->f))
+			ret = -1;
+	} else if (cap->write_err) {
+		errno = cap->write_err;
+		ret = -1;
+	}
+	if (ret) {
+		int saved_err = errno;
+
+		rds_capture_free(cap);
+		errno = saved_err;
+		return ret;
+	}
+	rds_capture_free(cap);
+	return 0;
+}
+
+uint64_t v4l2_rds_capture_get_start_time(const struct v4l2_rds_capture *cap)
+{
+	return cap->start_time;
+}
+
+const struct v4l2_rds_capture_block *v4l2_rds_capture_get_blocks
+	(const struct v4l2_rds_capture *cap, uint64_t *block_cnt)
+{
+	*block_cnt = cap->block_cnt;
+	return cap->blocks;
+}
+
+uint64_t v4l2_rds_capture_seek(const struct v4l2_rds_capture *cap, uint64_t time)
+{
+	uint64_t time_ms;
+	uint64_t lo, hi, i;
+
+	if (!cap->blocks)
+		return 0;
+	if (time <= cap->start_time)
+		return 0;
+	time_ms = time - cap->start_time;
+
+	/* the time index narrows the search down to one interval */
+	i = time_ms / cap->time_interval;
+	if (i >= cap->time_index_cnt)
+		return cap->block_cnt;
+	lo = cap->time_index[i];
+	hi = i + 1 < cap->time_index_cnt ? cap->time_index[i + 1] : cap->block_cnt;
+
+	while (lo < hi) {
+		uint64_t mid = lo + (hi - lo) / 2;
+
+		if (cap->blocks[mid].time_ms < time_ms)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+const struct v4l2_rds_capture_segment *v4l2_rds_capture_get_segments
+	(const struct v4l2_rds_capture *cap, unsigned *seg_cnt)
+{
+	*seg_cnt = cap->seg_cnt;
+	return cap->segs;
+}
+
+int v4l2_rds_capture_find_pi(const struct v4l2_rds_capture *cap, uint16_t pi,
+		unsigned from)
+{
+	for (unsigned i = from; i < cap->seg_cnt; i++)
+		if (cap->segs[i].pi == pi)
+			return i;
+	return -1;
+}
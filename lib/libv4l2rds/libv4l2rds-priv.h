@@ -0,0 +1,135 @@
+/*
+ * Internal interfaces between the parts of libv4l2rds
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335  USA
+ */
+
+#ifndef __LIBV4L2RDS_PRIV_H
+#define __LIBV4L2RDS_PRIV_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../include/libv4l2rds.h"
+
+/* multi-group TMC message being received, one for each continuity index */
+struct rds_tmc_assembly {
+	struct v4l2_rds_tmc_msg msg;
+	bool active;		/* a message is being received */
+	bool second;		/* the next group is the second group */
+	uint8_t next_gsi;	/* group sequence indicator of the next group,
+				 * if it is not the second group */
+};
+
+/* per handle state of the TMC decoder */
+struct rds_tmc_decoder {
+	struct v4l2_rds_tmc *store;	/* see v4l2_rds_set_tmc() */
+	uint8_t ltn;		/* announced location table number */
+	/* last type 8A group: TMC groups are usually repeated right away,
+	 * repetitions are dropped before any decoding */
+	bool last_valid;
+	uint8_t last_b;
+	uint16_t last_c;
+	uint16_t last_d;
+	struct rds_tmc_assembly assembly[8];
+};
+
+/* decodes the TMC part of a type 3A group announcing TMC
+ * @msg:	block C of the group */
+void rds_tmc_decode_announcement(struct rds_tmc_decoder *dec, uint16_t msg);
+
+/* decodes a type 8A group
+ * @return:	sequence number of the stored message if it is new or
+ *		changed, 0 otherwise */
+uint32_t rds_tmc_decode_group(struct rds_tmc_decoder *dec,
+		const struct v4l2_rds_group *grp);
+
+/* RT+ tag whose RT chars were not received yet */
+struct rds_rtplus_pending {
+	uint8_t content_type;
+	uint8_t start;
+	uint8_t len;
+};
+
+/* per handle state of the RT+ decoder */
+struct rds_rtplus {
+	struct v4l2_rds_rtplus info;
+	bool valid;		/* RT+ groups were received */
+	uint8_t pending_cnt;
+	struct rds_rtplus_pending pending[V4L2_RDS_RTPLUS_MAX_TAGS];
+};
+
+/* Application Identification of RT+ */
+#define RDS_AID_RTPLUS	0x4bd7
+
+/* decodes an RT+ group, ODA decoder callback with priv = struct rds_rtplus */
+uint32_t rds_rtplus_decode(struct v4l2_rds *handle,
+		const struct v4l2_rds_group *grp, void *priv);
+
+/* completes the pending RT+ tags, called when RT segments are received
+ * @return:	bitmask of the updated fields */
+uint32_t rds_rtplus_update(struct rds_rtplus *rtplus, struct v4l2_rds *handle);
+
+/* returns len chars of the current RT starting at start, NULL if they
+ * were not received yet */
+const uint8_t *rds_get_rt_chars(const struct v4l2_rds *handle, uint8_t start,
+		uint8_t len);
+
+/* counters of one second of stream time */
+struct rds_metrics_bucket {
+	uint32_t second;	/* stream time of the counted blocks */
+	uint16_t blocks;
+	uint16_t block_errors;
+	uint16_t block_corrected;
+	uint8_t group_cnt[16];	/* decoded groups of each group id */
+};
+
+/* per handle state of the metrics, see v4l2_rds_enable_metrics().
+ * Times are kept as numbers of blocks */
+struct rds_metrics {
+	uint64_t blocks;	/* blocks since the reset: the stream time */
+	uint64_t last_group;	/* time of the last decoded group, 0 = none */
+	uint64_t pi_time;	/* time PI, PS and RT became valid, */
+	uint64_t ps_time;	/* 0 = not yet */
+	uint64_t rt_time;
+	uint32_t gap_hist[V4L2_RDS_METRICS_GAP_BINS];
+	struct rds_metrics_bucket *cur;	/* bucket of the last block */
+	/* rolling window, second n is counted in bucket[n % WINDOW] */
+	struct rds_metrics_bucket bucket[V4L2_RDS_METRICS_WINDOW];
+};
+
+/* counts a received block
+ * @block:	the block field of the block (V4L2_RDS_BLOCK_*) */
+void rds_metrics_block(struct rds_metrics *metrics, uint8_t block);
+
+/* counts a decoded group, called after the group updated the handle */
+void rds_metrics_group(struct rds_metrics *metrics,
+		const struct v4l2_rds *handle, uint8_t group_id);
+
+/* computes the metrics for v4l2_rds_get_metrics() */
+void rds_metrics_get(const struct rds_metrics *metrics,
+		struct v4l2_rds_metrics *out);
+
+/* publishes the state of a handle in a shared memory segment */
+void rds_shm_publish(struct v4l2_rds_shm *shm, const struct v4l2_rds *handle);
+
+/* appends a decoded group to the group ring of a shared memory segment */
+void rds_shm_add_group(struct v4l2_rds_shm *shm, const struct v4l2_rds_group *grp);
+
+/* queues a change event, see v4l2_rds_set_events()
+ * @return:	the event to fill in, NULL if the type is not enabled */
+struct v4l2_rds_event *rds_add_event(struct v4l2_rds *handle, uint32_t type);
+
+#endif
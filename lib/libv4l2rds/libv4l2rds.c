@@ -20,9 +20,11 @@
 #include <errno.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
 #include <config.h>
 #include <sys/types.h>
 #include <sys/mman.h>
@@ -30,6 +32,7 @@
 #include <linux/videodev2.h>
 
 #include "../include/libv4l2rds.h"
+#include "libv4l2rds-priv.h"
 
 /* struct to encapsulate the private state information of the decoding process */
 /* the fields (except for handle) are for internal use only - new information
@@ -39,6 +42,11 @@
 // 结构体用于封装解码过程的私有状态信息
 // 其中的字段（handle 除外）仅供内部使用
 // 新解码的信息会存储在这些字段中，直到它们被验证后再复制到 rds 结构的公共部分（handle）
+/* size of the change event queue */
+#define RDS_EVENT_QUEUE	128
+/* number of ODA decoders that can be registered */
+#define RDS_MAX_ODA_DECODERS 8
+
 struct rds_private_state {
 	/* v4l2_rds has to be in first position, to allow typecasting between
 	 * v4l2_rds and rds_private_state pointers */
@@ -50,12 +58,13 @@ struct rds_private_state {
 	/* temporal storage locations for rds fields */
 	uint16_t new_pi;
 	uint8_t new_ps[8];
-	uint8_t new_ps_valid[8];
+	uint8_t new_ps_valid;	/* bitmask of validated new_ps chars */
 	uint8_t new_pty;
 	uint8_t new_ptyn[2][4];
 	bool new_ptyn_valid[2];
 	uint8_t new_rt[64];
 	uint8_t next_rt_segment;
+	uint8_t new_rt_received;	/* chars of new_rt received in order */
 	uint8_t new_di;
 	uint8_t next_di_segment;
 	uint8_t new_ecc;
@@ -67,9 +76,133 @@ struct rds_private_state {
 	uint8_t utc_offset;
 
 	struct v4l2_rds_group rds_group;
+	/* group type code (bits 11-15 of block B) of rds_group:
+	 * group id * 2 + version (A = 0, B = 1) */
+	uint8_t group_type;
 	struct v4l2_rds_data rds_data_raw[4];
+	/* blocks of rds_data_raw that were received without errors
+	 * (RDS_VALID_A..D), only differs from RDS_VALID_ALL in tolerant mode */
+	uint8_t group_valid;
+	/* tolerant group assembly, see v4l2_rds_set_tolerant() */
+	bool tolerant;
+
+	/* state of the software block decoder for raw bit streams */
+	uint32_t raw_reg;		/* the last 26 received bits */
+	uint64_t raw_bit_pos;		/* number of received bits */
+	uint64_t raw_offset_pos[5];	/* raw_bit_pos of the last occurrence
+					 * of each offset word (0 = never) */
+	bool raw_synced;		/* block synchronization acquired */
+	uint8_t raw_bit_cnt;		/* bits received of the current block */
+	uint8_t raw_next_block;		/* position (0..3) of the next block */
+	uint64_t raw_error_hist;	/* one bit for each of the last
+					 * RDS_SYNC_WINDOW blocks, set = error */
+
+	/* change notification queue, see v4l2_rds_get_event() */
+	uint32_t event_mask;		/* enabled V4L2_RDS_EVENT_* types */
+	uint8_t event_head;		/* oldest queued event */
+	uint8_t event_cnt;		/* number of queued events */
+	uint32_t events_lost;		/* events dropped since the last
+					 * V4L2_RDS_EVENT_OVERFLOW */
+	struct v4l2_rds_event events[RDS_EVENT_QUEUE];
+
+	/* AF Method B lists, sorted by tuned frequency */
+	struct v4l2_rds_af_list *af_lists;
+	uint16_t af_list_cnt;
+	uint16_t af_list_size;		/* allocated entries */
+	uint8_t af_head;		/* first AF code after the last AF count
+					 * (Method B: the tuned frequency) */
+	uint8_t af_head_cnt;		/* the last announced AF count */
+
+	/* TMC decoder, see v4l2_rds_set_tmc() */
+	struct rds_tmc_decoder tmc;
+
+	/* other networks from EON groups, see v4l2_rds_get_eons() */
+	struct v4l2_rds_eon eon[MAX_EON_CNT];
+	uint8_t eon_cnt;
+	/* received PS segments of each other network */
+	uint8_t eon_ps_segments[MAX_EON_CNT];
+
+	/* ODA decoders, see v4l2_rds_register_oda() */
+	struct v4l2_rds_oda_decoder oda_decoders[RDS_MAX_ODA_DECODERS];
+	uint8_t oda_decoder_cnt;
+	/* decoder for each group type, index + 1 in oda_decoders, 0 = none */
+	uint8_t oda_dispatch[32];
+
+	/* RT+ decoder, registered as ODA decoder */
+	struct rds_rtplus rtplus;
+
+	/* the members from here on are not cleared by v4l2_rds_reset(), the
+	 * snapshot readers load the snapshots pointer at any time */
+
+	/* station cache, see v4l2_rds_set_cache() */
+	struct v4l2_rds_cache *cache;
+
+	/* published snapshots of the handle, NULL if disabled,
+	 * see v4l2_rds_enable_snapshots() */
+	struct rds_snapshots *snapshots;
+
+	/* shared memory segment the handle is published in, NULL if none,
+	 * see v4l2_rds_set_shm() */
+	struct v4l2_rds_shm *shm;
+
+	/* reception quality metrics, NULL if disabled,
+	 * see v4l2_rds_enable_metrics() */
+	struct rds_metrics *metrics;
+};
+
+/* double buffered snapshots of the public part of the handle, for readers
+ * in other threads. Snapshot n is written to buf[n & 1]: start is set to n
+ * before writing it, done is set to n once it is complete. A reader of
+ * snapshot n has to retry only if start reached n + 2 in the meantime, as
+ * snapshot n + 1 goes to the other buffer. Kept in a separate allocation,
+ * so that readers don't share cache lines with the decoding state */
+struct rds_snapshots {
+	uint32_t start;
+	uint32_t done;
+	struct v4l2_rds buf[2];
+};
+
+/* Application Identification codes of TMC */
+#define RDS_AID_TMC	0xcd46
+#define RDS_AID_TMC_ALT	0xcd47
+
+/* maximum number of AF Method B lists kept per station */
+#define RDS_MAX_AF_LISTS 256
+
+/* one station of the station cache, with the slowly changing fields of
+ * the handle. RT, TA and MS change too often to be worth caching */
+struct rds_station {
+	uint16_t pi;		/* 0 = unused slot */
+	uint8_t ecc;		/* 0 = unknown */
+	uint8_t pty;
+	uint8_t lc;
+	uint8_t di;
+	bool tp;
+	uint8_t ps[8];
+	uint8_t ptyn[8];
+	uint32_t valid_fields;	/* cached fields, V4L2_RDS_* */
+	uint32_t last_used;	/* LRU clock value of the last use */
+	struct v4l2_rds_af_set rds_af;
+	struct v4l2_rds_oda_set rds_oda;
 };
 
+/* the station cache is a hash table with linear probing, indexed by PI.
+ * Stations with the same PI in different countries share a probe
+ * sequence and are told apart by their ECC */
+struct v4l2_rds_cache {
+	struct rds_station *slots;
+	uint8_t hash_shift;		/* 32 - log2(number of slots) */
+	uint32_t slot_mask;		/* number of slots - 1 */
+	unsigned max_stations;
+	unsigned station_cnt;
+	uint32_t clock;			/* LRU clock */
+};
+
+/* fields of the handle that are kept in the station cache */
+#define RDS_CACHED_FIELDS (V4L2_RDS_PTY | V4L2_RDS_TP | V4L2_RDS_PS | \
+		V4L2_RDS_DI | V4L2_RDS_PTYN | V4L2_RDS_AF | V4L2_RDS_ECC | \
+		V4L2_RDS_LC)
+
 /* states of the RDS block into group decoding state machine */
 enum rds_state {
 	RDS_EMPTY,
@@ -78,17 +211,334 @@ enum rds_state {
 	RDS_C_RECEIVED,
 };
 
+/* bits of the group_valid bitmask */
+#define RDS_VALID_A	0x01
+#define RDS_VALID_B	0x02
+#define RDS_VALID_C	0x04
+#define RDS_VALID_D	0x08
+#define RDS_VALID_ALL	0x0f
+
+/* group type code of a group id / version combination */
+#define RDS_GROUP_TYPE(id, version)	(((id) << 1) | ((version) == 'B'))
+
+/* RDS error protection (IEC 62106 Annex B): every block consists of 16 data
+ * bits followed by a 10 bit checkword. The checkword is the CRC of the data
+ * bits for the generator polynomial below, xor'ed with an offset word that
+ * identifies the position of the block within the group */
+#define RDS_BLOCK_BITS	26
+#define RDS_POLY	0x5b9	/* x^10 + x^8 + x^7 + x^5 + x^4 + x^3 + 1 */
+/* longest burst error that gets corrected. The code is able to correct
+ * bursts of up to 5 bits, but then ~40% of all syndromes map to a
+ * correction and most random errors would be "corrected" into wrong data */
+#define RDS_MAX_BURST	2
+/* block synchronization is dropped if more than RDS_SYNC_MAX_ERRORS of the
+ * last RDS_SYNC_WINDOW blocks were uncorrectable (IEC 62106 Annex C) */
+#define RDS_SYNC_WINDOW	50
+#define RDS_SYNC_MAX_ERRORS 45
+
+/* offset words A, B, C, C' and D, with the block id they are reported with
+ * and the position of the block within the group */
+static const uint16_t rds_offset_word[5] = { 0x0fc, 0x198, 0x168, 0x350, 0x1b4 };
+static const uint8_t rds_offset_block_id[5] = {
+	V4L2_RDS_BLOCK_A, V4L2_RDS_BLOCK_B, V4L2_RDS_BLOCK_C,
+	V4L2_RDS_BLOCK_C_ALT, V4L2_RDS_BLOCK_D
+};
+static const uint8_t rds_offset_block_pos[5] = { 0, 1, 2, 2, 3 };
+
+/* precomputed tables for the software block decoder, set up once by
+ * rds_init_tables():
+ * syndrome contribution of the data msb / lsb, and the error pattern of
+ * the correctable burst error for every syndrome (0 = not correctable) */
+static uint16_t rds_syndrome_msb[256];
+static uint16_t rds_syndrome_lsb[256];
+static uint32_t rds_burst_error[1024];
+static pthread_once_t rds_tables_once = PTHREAD_ONCE_INIT;
+
+/* queues a new event of the given type, the oldest event is dropped if the
+ * queue is full
+ * @return:	the new event with all fields besides type cleared */
+static struct v4l2_rds_event *rds_queue_event(struct rds_private_state *priv_state,
+		uint32_t type)
+{
+	struct v4l2_rds_event *ev;
+
+	if (priv_state->event_cnt == RDS_EVENT_QUEUE) {
+		priv_state->event_head = (priv_state->event_head + 1) % RDS_EVENT_QUEUE;
+		priv_state->event_cnt--;
+		priv_state->events_lost++;
+	}
+	ev = &priv_state->events[(priv_state->event_head + priv_state->event_cnt++) %
+		RDS_EVENT_QUEUE];
+	memset(ev, 0, sizeof(*ev));
+	ev->type = type;
+	return ev;
+}
+
+/* returns a new event to be filled in by the caller, or NULL if events of
+ * this type are disabled. Kept inline so that disabled events cost no more
+ * than a test of the mask */
+static inline struct v4l2_rds_event *rds_new_event(struct rds_private_state *priv_state,
+		uint32_t type)
+{
+	if (!(priv_state->event_mask & type))
+		return NULL;
+	return rds_queue_event(priv_state, type);
+}
+
+/* queues an event that only carries a value */
+static inline void rds_value_event(struct rds_private_state *priv_state,
+		uint32_t type, uint32_t value)
+{
+	struct v4l2_rds_event *ev = rds_new_event(priv_state, type);
+
+	if (ev)
+		ev->value = value;
+}
+
+struct v4l2_rds_event *rds_add_event(struct v4l2_rds *handle, uint32_t type)
+{
+	return rds_new_event((struct rds_private_state *)handle, type);
+}
+
 static inline uint8_t set_bit(uint8_t input, uint8_t bitmask, bool bitvalue)
 {
 	return bitvalue ? input | bitmask : input & ~bitmask;
 }
 
+/* assigns the registered ODA decoders to the group types of the
+ * announced ODAs */
+static void rds_update_oda_dispatch(struct rds_private_state *priv_state)
+{
+	const struct v4l2_rds_oda_set *oda_set = &priv_state->handle.rds_oda;
+
+	memset(priv_state->oda_dispatch, 0, sizeof(priv_state->oda_dispatch));
+	for (int i = 0; i < oda_set->size; i++) {
+		const struct v4l2_rds_oda *oda = &oda_set->oda[i];
+
+		/* group type 0A means the ODA is not sent in its own groups */
+		if (!oda->group_id && oda->group_version == 'A')
+			continue;
+		for (int j = 0; j < priv_state->oda_decoder_cnt; j++)
+			if (priv_state->oda_decoders[j].aid == oda->aid)
+				priv_state->oda_dispatch[RDS_GROUP_TYPE(oda->group_id,
+					oda->group_version)] = j + 1;
+	}
+}
+
+static inline uint32_t rds_cache_hash(const struct v4l2_rds_cache *cache, uint16_t pi)
+{
+	return (pi * 2654435761u) >> cache->hash_shift;
+}
+
+/* looks up a station in the cache
+ * @ecc:	ECC of the station, 0 if unknown. Stations with a different
+ *		known ECC don't match
+ * @return:	the matching station, the most recently used one if several
+ *		stations match, NULL if there is none */
+static struct rds_station *rds_cache_find(struct v4l2_rds_cache *cache,
+		uint16_t pi, uint8_t ecc)
+{
+	struct rds_station *found = NULL;
+
+	for (uint32_t i = rds_cache_hash(cache, pi); cache->slots[i].pi;
+			i = (i + 1) & cache->slot_mask) {
+		struct rds_station *st = &cache->slots[i];
+
+		if (st->pi != pi || (ecc && st->ecc && st->ecc != ecc))
+			continue;
+		if (!found || st->last_used > found->last_used)
+			found = st;
+	}
+	return found;
+}
+
+/* removes the station in slot i, later stations of the probe sequence are
+ * moved up so that lookups don't stop at the emptied slot */
+static void rds_cache_remove(struct v4l2_rds_cache *cache, uint32_t i)
+{
+	uint32_t j = i;
+
+	for (;;) {
+		uint32_t home;
+
+		j = (j + 1) & cache->slot_mask;
+		if (!cache->slots[j].pi)
+			break;
+		home = rds_cache_hash(cache, cache->slots[j].pi);
+		/* the station in slot j can't be moved to slot i if its home
+		 * slot lies cyclically in (i, j] */
+		if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+			continue;
+		cache->slots[i] = cache->slots[j];
+		i = j;
+	}
+	cache->slots[i].pi = 0;
+	cache->station_cnt--;
+}
+
+/* adds a new, empty station to the cache. The least recently used station
+ * is dropped if the cache is full */
+static struct rds_station *rds_cache_insert(struct v4l2_rds_cache *cache,
+		uint16_t pi)
+{
+	uint32_t i;
+
+	if (cache->station_cnt >= cache->max_stations) {
+		uint32_t lru = UINT32_MAX;
+
+		for (uint32_t j = 0; j <= cache->slot_mask; j++)
+			if (cache->slots[j].pi && (lru == UINT32_MAX ||
+			    cache->slots[j].last_used < cache->slots[lru].last_used))
+				lru = j;
+		rds_cache_remove(cache, lru);
+	}
+	for (i = rds_cache_hash(cache, pi); cache->slots[i].pi;
+			i = (i + 1) & cache->slot_mask)
+		;
+	memset(&cache->slots[i], 0, sizeof(cache->slots[i]));
+	cache->slots[i].pi = pi;
+	cache->station_cnt++;
+	return &cache->slots[i];
+}
+
+/* merges the cached fields of the current station into the cache */
+static void rds_cache_store(struct rds_private_state *priv_state)
+{
+	struct v4l2_rds *handle = &priv_state->handle;
+	struct v4l2_rds_cache *cache = priv_state->cache;
+	uint8_t ecc = (handle->valid_fields & V4L2_RDS_ECC) ? handle->ecc : 0;
+	struct rds_station *st;
+
+	if (!cache || !(handle->valid_fields & V4L2_RDS_PI) || !handle->pi)
+		return;
+	st = rds_cache_find(cache, handle->pi, ecc);
+	if (!st)
+		st = rds_cache_insert(cache, handle->pi);
+
+	st->valid_fields |= handle->valid_fields & RDS_CACHED_FIELDS;
+	st->last_used = ++cache->clock;
+	if (ecc)
+		st->ecc = ecc;
+	if (handle->valid_fields & V4L2_RDS_PTY)
+		st->pty = handle->pty;
+	if (handle->valid_fields & V4L2_RDS_TP)
+		st->tp = handle->tp;
+	if (handle->valid_fields & V4L2_RDS_PS)
+		memcpy(st->ps, handle->ps, 8);
+	if (handle->valid_fields & V4L2_RDS_DI)
+		st->di = handle->di;
+	if (handle->valid_fields & V4L2_RDS_PTYN)
+		memcpy(st->ptyn, handle->ptyn, 8);
+	if (handle->valid_fields & V4L2_RDS_LC)
+		st->lc = handle->lc;
+	/* partially received AF lists are cached as well */
+	if (handle->rds_af.size >= st->rds_af.size)
+		st->rds_af = handle->rds_af;
+	if (handle->rds_oda.size >= st->rds_oda.size)
+		st->rds_oda = handle->rds_oda;
+}
+
+/* copies the cached fields of a station into the handle
+ * @return:	bitmask of the restored fields */
+static uint32_t rds_cache_restore(struct rds_private_state *priv_state,
+		struct rds_station *st)
+{
+	struct v4l2_rds *handle = &priv_state->handle;
+	struct v4l2_rds_event *ev;
+
+	st->last_used = ++priv_state->cache->clock;
+	handle->valid_fields |= st->valid_fields;
+	if (st->valid_fields & V4L2_RDS_ECC) {
+		handle->ecc = st->ecc;
+		rds_value_event(priv_state, V4L2_RDS_EVENT_ECC, st->ecc);
+	}
+	if (st->valid_fields & V4L2_RDS_PTY) {
+		handle->pty = priv_state->new_pty = st->pty;
+		rds_value_event(priv_state, V4L2_RDS_EVENT_PTY, st->pty);
+	}
+	if (st->valid_fields & V4L2_RDS_TP) {
+		handle->tp = st->tp;
+		rds_value_event(priv_state, V4L2_RDS_EVENT_TP, st->tp);
+	}
+	if (st->valid_fields & V4L2_RDS_PS) {
+		memcpy(handle->ps, st->ps, 8);
+		if ((ev = rds_new_event(priv_state, V4L2_RDS_EVENT_PS))) {
+			ev->value = 0xff;
+			ev->len = 8;
+			memcpy(ev->data, st->ps, 8);
+		}
+	}
+	if (st->valid_fields & V4L2_RDS_DI) {
+		handle->di = st->di;
+		rds_value_event(priv_state, V4L2_RDS_EVENT_DI, st->di);
+	}
+	if (st->valid_fields & V4L2_RDS_PTYN) {
+		memcpy(handle->ptyn, st->ptyn, 8);
+		if ((ev = rds_new_event(priv_state, V4L2_RDS_EVENT_PTYN))) {
+			ev->len = 8;
+			memcpy(ev->data, st->ptyn, 8);
+		}
+	}
+	if (st->valid_fields & V4L2_RDS_LC) {
+		handle->lc = st->lc;
+		rds_value_event(priv_state, V4L2_RDS_EVENT_LC, st->lc);
+	}
+	handle->rds_af = st->rds_af;
+	for (int i = 0; i < st->rds_af.size; i++)
+		rds_value_event(priv_state, V4L2_RDS_EVENT_AF, st->rds_af.af[i]);
+	handle->rds_oda = st->rds_oda;
+	if (st->rds_oda.size) {
+		handle->decode_information |= V4L2_RDS_ODA;
+		for (int i = 0; i < st->rds_oda.size; i++)
+			if ((ev = rds_new_event(priv_state, V4L2_RDS_EVENT_ODA)))
+				ev->oda = st->rds_oda.oda[i];
+	}
+	rds_update_oda_dispatch(priv_state);
+	return st->valid_fields | (st->rds_oda.size ? V4L2_RDS_ODA : 0);
+}
+
+/* called when a new PI was accepted: the state of the previous station is
+ * stored, and replaced by the cached state of the new one
+ * @return:	bitmask of the restored fields */
+static uint32_t rds_cache_switch(struct rds_private_state *priv_state,
+		uint16_t old_pi)
+{
+	struct v4l2_rds *handle = &priv_state->handle;
+	uint16_t pi = handle->pi;
+	struct rds_station *st;
+
+	handle->pi = old_pi;
+	rds_cache_store(priv_state);
+	handle->pi = pi;
+
+	/* drop the fields of the previous station, the other networks and
+	 * the RT+ tags are not cached */
+	handle->valid_fields &= ~(RDS_CACHED_FIELDS | V4L2_RDS_EON |
+			V4L2_RDS_RTPLUS);
+	handle->decode_information &= ~(V4L2_RDS_ODA | V4L2_RDS_AF_B);
+	memset(&handle->rds_af, 0, sizeof(handle->rds_af));
+	memset(&handle->rds_oda, 0, sizeof(handle->rds_oda));
+
+	/* the Method B lists are not cached, the allocation is kept */
+	priv_state->af_list_cnt = 0;
+	priv_state->af_head = 0;
+	priv_state->af_head_cnt = 0;
+	priv_state->eon_cnt = 0;
+	memset(&priv_state->rtplus, 0, sizeof(priv_state->rtplus));
+
+	memset(priv_state->oda_dispatch, 0, sizeof(priv_state->oda_dispatch));
+
+	st = rds_cache_find(priv_state->cache, pi, 0);
+	return st ? rds_cache_restore(priv_state, st) : 0;
+}
+
 /* rds_decode_a-d(..): group of functions to decode different RDS blocks
  * into the RDS group that's currently being received
  *
  * block A of RDS group always contains PI code of program */
 // block A: PI
-static uint32_t rds_decode_a(struct rds_private_state *priv_state, struct v4l2_rds_data *rds_data)
+static inline uint32_t rds_decode_a(struct rds_private_state *priv_state,
+		const struct v4l2_rds_data *rds_data)
 {
 	struct v4l2_rds *handle = &priv_state->handle;
 	uint32_t updated_fields = 0;
@@ -102,7 +552,12 @@ static uint32_t rds_decode_a(struct rds_private_state *priv_state, struct v4l2_r
 	 * at least 2 times in a row */
 	// 仅当收到相同的 PI 至少连续2次时 才接受新的 PI
 	if (pi != handle->pi && pi == priv_state->new_pi) {
+		uint16_t old_pi = handle->pi;
+
 		handle->pi = pi;
+		rds_value_event(priv_state, V4L2_RDS_EVENT_PI, pi);
+		if (priv_state->cache)
+			updated_fields |= rds_cache_switch(priv_state, old_pi);
 		handle->valid_fields |= V4L2_RDS_PI;  // 标记 PI 字段为有效
 		updated_fields |= V4L2_RDS_PI;        // 标记 PI 字段已更新
 	} else if (pi != handle->pi && pi != priv_state->new_pi) {
@@ -116,7 +571,8 @@ static uint32_t rds_decode_a(struct rds_private_state *priv_state, struct v4l2_r
  * Traffic Program Code and Program Type Code as well as 5 bits of Group Type
  * depending information */
 // block B：组类型代码、组类型信息、TP、PTY
-static uint32_t rds_decode_b(struct rds_private_state *priv_state, struct v4l2_rds_data *rds_data)
+static inline uint32_t rds_decode_b(struct rds_private_state *priv_state,
+		const struct v4l2_rds_data *rds_data)
 {
 	struct v4l2_rds *handle = &priv_state->handle;
 	struct v4l2_rds_group *grp = &priv_state->rds_group;
@@ -124,7 +580,11 @@ static uint32_t rds_decode_b(struct rds_private_state *priv_state, struct v4l2_r
 	uint8_t pty;
 	uint32_t updated_fields = 0;
 
-	/* bits 12-15 (4-7 of msb) contain the Group Type Code */
+	/* bits 11-15 (3-7 of msb) contain the Group Type Code, which
+	 * selects the group specific decoder */
+	priv_state->group_type = rds_data->msb >> 3;
+
+	/* bits 12-15 (4-7 of msb) contain the Group ID */
 	grp->group_id = rds_data->msb >> 4 ;
 
 	/* bit 11 (3 of msb) defines Group Type info: 0 = A, 1 = B */
@@ -136,6 +596,7 @@ static uint32_t rds_decode_b(struct rds_private_state *priv_state, struct v4l2_r
 	if (handle->tp != traffic_prog) {
 		handle->tp = traffic_prog;
 		updated_fields |= V4L2_RDS_TP;
+		rds_value_event(priv_state, V4L2_RDS_EVENT_TP, traffic_prog);
 	}
 	handle->valid_fields |= V4L2_RDS_TP;
 
@@ -157,6 +618,7 @@ static uint32_t rds_decode_b(struct rds_private_state *priv_state, struct v4l2_r
 		handle->pty = priv_state->new_pty;
 		updated_fields |= V4L2_RDS_PTY;
 		handle->valid_fields |= V4L2_RDS_PTY;
+		rds_value_event(priv_state, V4L2_RDS_EVENT_PTY, pty);
 	} else {
 		priv_state->new_pty = pty;
 	}
@@ -166,7 +628,8 @@ static uint32_t rds_decode_b(struct rds_private_state *priv_state, struct v4l2_r
 
 /* block C of RDS group contains either data or the PI code, depending
  * on the Group Type - store the raw data for later decoding */
-static void rds_decode_c(struct rds_private_state *priv_state, struct v4l2_rds_data *rds_data)
+static inline void rds_decode_c(struct rds_private_state *priv_state,
+		const struct v4l2_rds_data *rds_data)
 {
 	struct v4l2_rds_group *grp = &priv_state->rds_group;
 
@@ -179,7 +642,8 @@ static void rds_decode_c(struct rds_private_state *priv_state, struct v4l2_rds_d
 }
 
 /* block D of RDS group contains data - store the raw data for later decoding */
-static void rds_decode_d(struct rds_private_state *priv_state, struct v4l2_rds_data *rds_data)
+static inline void rds_decode_d(struct rds_private_state *priv_state,
+		const struct v4l2_rds_data *rds_data)
 {
 	struct v4l2_rds_group *grp = &priv_state->rds_group;
 
@@ -190,48 +654,187 @@ static void rds_decode_d(struct rds_private_state *priv_state, struct v4l2_rds_d
 static bool rds_add_oda(struct rds_private_state *priv_state, struct v4l2_rds_oda oda)
 {
 	struct v4l2_rds *handle = &priv_state->handle;
+	struct v4l2_rds_event *ev;
 
 	/* check if there was already an ODA announced for this group type */
 	for (int i = 0; i < handle->rds_oda.size; i++) {
-		if (handle->rds_oda.oda[i].group_id == oda.group_id)
-			/* update the AID for this ODA */
-			handle->rds_oda.oda[i].aid = oda.aid;
+		struct v4l2_rds_oda *old = &handle->rds_oda.oda[i];
+
+		if (old->group_id != oda.group_id ||
+		    old->group_version != oda.group_version)
+			continue;
+		if (old->aid == oda.aid)
 			return false;
+		/* update the AID for this ODA */
+		old->aid = oda.aid;
+		goto updated;
 	}
 	/* add the new ODA */
 	if (handle->rds_oda.size >= MAX_ODA_CNT)
 		return false;
 	handle->rds_oda.oda[handle->rds_oda.size++] = oda;
+updated:
+	if ((ev = rds_new_event(priv_state, V4L2_RDS_EVENT_ODA)))
+		ev->oda = oda;
+	rds_update_oda_dispatch(priv_state);
 	return true;
 }
 
-/* add a new AF to the list, if it doesn't exist yet */
-static bool rds_add_af_to_list(struct v4l2_rds_af_set *af_set, uint8_t af, bool is_vhf)
+/* converts an AF code into a frequency in Hz (IEC 62106 section 6.2.1.6)
+ * @is_vhf:	false for the codes following the LF/MF code 250
+ * @return:	the frequency, 0 for codes that don't represent a frequency */
+static uint32_t rds_af_freq(uint8_t af, bool is_vhf)
 {
-	uint32_t freq = 0;
-
-	/* AF0 -> "Not to be used" */
-	if (af == 0)
-		return false;
-
-	/* calculate the AF values in HZ */
 	if (is_vhf)
-		freq = 87500000 + af * 100000;
-	else if (freq <= 15)
-		freq = 152000 + af * 9000;
-	else
-		freq = 531000 + af * 9000;
+		return (af >= 1 && af <= 204) ? 87500000 + af * 100000 : 0;
+	/* LF: 153 - 279 kHz, MF: 531 - 1602 kHz, in 9 kHz steps */
+	if (af >= 1 && af <= 15)
+		return 153000 + (af - 1) * 9000;
+	if (af >= 16 && af <= 135)
+		return 531000 + (af - 16) * 9000;
+	return 0;
+}
+
+/* inserts an AF (in Hz) into a sorted AF set, unless it is already there
+ * or the set holds max AFs (usually the announced number)
+ * @return:	true if the AF was added */
+static bool rds_af_set_insert(struct v4l2_rds_af_set *af_set, uint32_t freq,
+		uint8_t max)
+{
+	int lo = 0, hi = af_set->size;
 
 	/* prevent buffer overflows */
-	if (af_set->size >= MAX_AF_CNT || af_set->size >= af_set->announced_af)
+	if (af_set->size >= MAX_AF_CNT || af_set->size >= max)
 		return false;
 	/* check if AF already exists */
-	for (int i = 0; i < af_set->size; i++) {
-		if (af_set->af[i] == freq)
-			return false;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (af_set->af[mid] < freq)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
+	if (lo < af_set->size && af_set->af[lo] == freq)
+		return false;
 	/* it's a new AF, add it to the list */
-	af_set->af[(af_set->size)++] = freq;
+	memmove(&af_set->af[lo + 1], &af_set->af[lo],
+		(af_set->size - lo) * sizeof(af_set->af[0]));
+	af_set->af[lo] = freq;
+	af_set->size++;
+	return true;
+}
+
+/* add a new AF to the set of all AFs, if it doesn't exist yet. The set is
+ * kept sorted by frequency */
+static bool rds_add_af_to_list(struct rds_private_state *priv_state, uint8_t af,
+		bool is_vhf)
+{
+	struct v4l2_rds *handle = &priv_state->handle;
+	uint32_t freq = rds_af_freq(af, is_vhf);
+	/* with Method B the AF counts belong to the lists, not to the set */
+	uint8_t max = (handle->decode_information & V4L2_RDS_AF_B) ?
+		MAX_AF_CNT : handle->rds_af.announced_af;
+
+	/* AF0 -> "Not to be used" */
+	if (!freq || !rds_af_set_insert(&handle->rds_af, freq, max))
+		return false;
+	rds_value_event(priv_state, V4L2_RDS_EVENT_AF, freq);
+	return true;
+}
+
+/* returns the position of the first AF list with a tuned frequency >= freq */
+static int rds_find_af_list(const struct v4l2_rds_af_list *lists, int cnt,
+		uint32_t freq)
+{
+	int lo = 0, hi = cnt;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (lists[mid].tuned_freq < freq)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* returns the position of the first entry of an AF list with freq >= freq */
+static int rds_find_af_entry(const struct v4l2_rds_af_list *list, uint32_t freq)
+{
+	int lo = 0, hi = list->size;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (list->af[mid].freq < freq)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* adds an AF to the Method B list of the tuned frequency, the list is
+ * created if necessary
+ * @return:	true if the AF is new or its flags changed */
+static bool rds_add_af_b(struct rds_private_state *priv_state, uint8_t tuned,
+		uint8_t af, bool regional)
+{
+	uint32_t tuned_freq = rds_af_freq(tuned, true);
+	uint32_t freq = rds_af_freq(af, true);
+	uint8_t flags = regional ? V4L2_RDS_AF_REGIONAL : 0;
+	struct v4l2_rds_af_list *list;
+	int pos = rds_find_af_list(priv_state->af_lists, priv_state->af_list_cnt,
+			tuned_freq);
+
+	if (pos == priv_state->af_list_cnt ||
+	    priv_state->af_lists[pos].tuned_freq != tuned_freq) {
+		if (priv_state->af_list_cnt >= RDS_MAX_AF_LISTS)
+			return false;
+		if (priv_state->af_list_cnt == priv_state->af_list_size) {
+			uint16_t size = priv_state->af_list_size ?
+				2 * priv_state->af_list_size : 4;
+			void *p = realloc(priv_state->af_lists, size * sizeof(*list));
+
+			if (!p)
+				return false;
+			priv_state->af_lists = p;
+			priv_state->af_list_size = size;
+		}
+		list = &priv_state->af_lists[pos];
+		memmove(list + 1, list, (priv_state->af_list_cnt - pos) * sizeof(*list));
+		memset(list, 0, sizeof(*list));
+		list->tuned_freq = tuned_freq;
+		priv_state->af_list_cnt++;
+	}
+	list = &priv_state->af_lists[pos];
+	list->announced_af = priv_state->af_head_cnt;
+	if (!(priv_state->handle.decode_information & V4L2_RDS_AF_B)) {
+		/* the count in front of the first list was taken for a
+		 * Method A count, the set of all AFs has none with Method B */
+		priv_state->handle.decode_information |= V4L2_RDS_AF_B;
+		priv_state->handle.rds_af.announced_af = 0;
+	}
+
+	pos = rds_find_af_entry(list, freq);
+	if (pos < list->size && list->af[pos].freq == freq) {
+		if (list->af[pos].flags == flags)
+			return false;
+		list->af[pos].flags = flags;
+		return true;
+	}
+	if (list->size >= MAX_AF_CNT)
+		return false;
+	memmove(&list->af[pos + 1], &list->af[pos],
+		(list->size - pos) * sizeof(list->af[0]));
+	list->af[pos].freq = freq;
+	list->af[pos].flags = flags;
+	list->size++;
+	/* the AFs are valid once the first list is complete */
+	if (list->size + 1 >= list->announced_af)
+		priv_state->handle.valid_fields |= V4L2_RDS_AF;
 	return true;
 }
 
@@ -254,20 +857,35 @@ static bool rds_add_af(struct rds_private_state *priv_state)
 
 	/* 250: LF / MF frequency follows */
 	if (c_msb == 250) {
-		if (rds_add_af_to_list(af_set, c_lsb, false))
+		if (rds_add_af_to_list(priv_state, c_lsb, false))
 			updated_af = true;
 		c_lsb = 0; /* invalidate */
 	}
 	/* 224..249: announcement of AF count (224=0, 249=25)*/
-	if (c_msb >= 224 && c_msb <= 249)
-		af_set->announced_af = c_msb - 224;
+	if (c_msb >= 224 && c_msb <= 249) {
+		if (!(handle->decode_information & V4L2_RDS_AF_B))
+			af_set->announced_af = c_msb - 224;
+		/* with Method B the count is followed by the tuned frequency */
+		priv_state->af_head = c_lsb <= 204 ? c_lsb : 0;
+		priv_state->af_head_cnt = c_msb - 224;
+	} else if (priv_state->af_head && c_msb != c_lsb &&
+		   c_msb >= 1 && c_msb <= 204 && c_lsb >= 1 && c_lsb <= 204 &&
+		   (c_msb == priv_state->af_head || c_lsb == priv_state->af_head)) {
+		/* Method B: every pair contains the tuned frequency and one
+		 * AF, in ascending order for AFs carrying the same program
+		 * and in descending order for regional variants */
+		uint8_t af = c_msb == priv_state->af_head ? c_lsb : c_msb;
+
+		if (rds_add_af_b(priv_state, priv_state->af_head, af, c_msb > c_lsb))
+			updated_af = true;
+	}
 	/* check if the data represents an AF (for 1 =< val <= 204 the
 	 * value represents an AF) */
 	if (c_msb < 205)
-		if (rds_add_af_to_list(af_set, c_msb, true))
+		if (rds_add_af_to_list(priv_state, c_msb, true))
 			updated_af = true;
 	if (c_lsb < 205)
-		if (rds_add_af_to_list(af_set, c_lsb, true))
+		if (rds_add_af_to_list(priv_state, c_lsb, true))
 			updated_af = true;
 	/* did we receive all announced AFs? */
 	if (af_set->size >= af_set->announced_af && af_set->announced_af != 0)
@@ -280,27 +898,27 @@ static bool rds_add_af(struct rds_private_state *priv_state)
  * @pos:	position of the char within the PS name (0..7)
  * @ps_char:	the new character to be added
  * @return:	true, if all 8 temporal ps chars have been validated */
-static bool rds_add_ps(struct rds_private_state *priv_state, uint8_t pos, uint8_t ps_char)
+static inline bool rds_add_ps(struct rds_private_state *priv_state, uint8_t pos, uint8_t ps_char)
 {
 	if (ps_char == priv_state->new_ps[pos]) {
-		priv_state->new_ps_valid[pos] = 1;
+		priv_state->new_ps_valid |= 1 << pos;
 	} else {
 		priv_state->new_ps[pos] = ps_char;
-		memset(priv_state->new_ps_valid, 0, 8);
+		priv_state->new_ps_valid = 0;
 	}
 
 	/* check if all ps positions have been validated */
-	for (int i = 0; i < 8; i++)
-		if (priv_state->new_ps_valid[i] != 1)
-			return false;
-	return true;
+	return priv_state->new_ps_valid == 0xff;
 }
 
 /* group of functions to decode successfully received RDS groups into
  * easily accessible data fields
  *
- * group 0: basic tuning and switching */
-static uint32_t rds_decode_group0(struct rds_private_state *priv_state)
+ * group 0: basic tuning and switching
+ * version_a is a constant in the callers, so that the compiler generates
+ * specialized code for 0A and 0B groups */
+static inline uint32_t rds_decode_group0(struct rds_private_state *priv_state,
+		bool version_a)
 {
 	struct v4l2_rds *handle = &priv_state->handle;
 	struct v4l2_rds_group *grp = &priv_state->rds_group;
@@ -313,6 +931,7 @@ static uint32_t rds_decode_group0(struct rds_private_state *priv_state)
 	if (handle->ta != tmp) {
 		handle->ta = tmp;
 		updated_fields |= V4L2_RDS_TA;
+		rds_value_event(priv_state, V4L2_RDS_EVENT_TA, tmp);
 	}
 	handle->valid_fields |= V4L2_RDS_TA;
 
@@ -321,6 +940,7 @@ static uint32_t rds_decode_group0(struct rds_private_state *priv_state)
 	if (handle->ms != tmp) {
 		handle->ms = tmp;
 		updated_fields |= V4L2_RDS_MS;
+		rds_value_event(priv_state, V4L2_RDS_EVENT_MS, tmp);
 	}
 	handle->valid_fields |= V4L2_RDS_MS;
 
@@ -330,11 +950,22 @@ static uint32_t rds_decode_group0(struct rds_private_state *priv_state)
 
 	/* put the received station-name characters into the correct position
 	 * of the station name, and check if the new PS is validated */
-	rds_add_ps(priv_state, segment * 2, grp->data_d_msb);
-	new_ps = rds_add_ps(priv_state, segment * 2 + 1, grp->data_d_lsb);
+	if (priv_state->group_valid & RDS_VALID_D) {
+		rds_add_ps(priv_state, segment * 2, grp->data_d_msb);
+		new_ps = rds_add_ps(priv_state, segment * 2 + 1, grp->data_d_lsb);
+	}
 	if (new_ps) {
 		/* check if new PS is the same as the old one */
 		if (memcmp(priv_state->new_ps, handle->ps, 8) != 0) {
+			struct v4l2_rds_event *ev;
+
+			if ((ev = rds_new_event(priv_state, V4L2_RDS_EVENT_PS))) {
+				for (int i = 0; i < 8; i++)
+					if (handle->ps[i] != priv_state->new_ps[i])
+						ev->value |= 1 << i;
+				ev->len = 8;
+				memcpy(ev->data, priv_state->new_ps, 8);
+			}
 			memcpy(handle->ps, priv_state->new_ps, 8);
 			updated_fields |= V4L2_RDS_PS;
 		}
@@ -370,6 +1001,8 @@ static uint32_t rds_decode_group0(struct rds_private_state *priv_state)
 			if (handle->di != priv_state->new_di) {
 				handle->di = priv_state->new_di;
 				updated_fields |= V4L2_RDS_DI;
+				rds_value_event(priv_state, V4L2_RDS_EVENT_DI,
+						handle->di);
 			}
 			priv_state->next_di_segment = 0;
 			handle->valid_fields |= V4L2_RDS_DI;
@@ -382,13 +1015,23 @@ static uint32_t rds_decode_group0(struct rds_private_state *priv_state)
 	}
 
 	/* version A groups contain AFs in block C */
-	if (grp->group_version == 'A')
+	if (version_a && (priv_state->group_valid & RDS_VALID_C))
 		if (rds_add_af(priv_state))
 			updated_fields |= V4L2_RDS_AF;
 
 	return updated_fields;
 }
 
+static uint32_t rds_decode_group0a(struct rds_private_state *priv_state)
+{
+	return rds_decode_group0(priv_state, true);
+}
+
+static uint32_t rds_decode_group0b(struct rds_private_state *priv_state)
+{
+	return rds_decode_group0(priv_state, false);
+}
+
 /* group 1: slow labeling codes & program item number */
 static uint32_t rds_decode_group1(struct rds_private_state *priv_state)
 {
@@ -399,19 +1042,28 @@ static uint32_t rds_decode_group1(struct rds_private_state *priv_state)
 
 	/* version A groups contain slow labeling codes,
 	 * version B groups only contain program item number which is a
-	 * very uncommonly used feature */
-	if (grp->group_version != 'A')
-		return 0;
-
+	 * very uncommonly used feature and are not decoded */
 	/* bit 14-12 of block c contain the variant code */
 	variant_code = (grp->data_c_msb >> 4) & 0x07;
 	if (variant_code == 0) {
 		/* var 0 -> ECC, only accept if same lc is
 		 * received twice */
 		if (grp->data_c_lsb == priv_state->new_ecc) {
+			struct rds_station *st;
+
+			/* the cached station restored for this PI is located in
+			 * another country, switch to the right one if known */
+			if (priv_state->cache && handle->ecc != grp->data_c_lsb &&
+			    (handle->valid_fields & V4L2_RDS_ECC) &&
+			    (st = rds_cache_find(priv_state->cache, handle->pi,
+					grp->data_c_lsb)) && st->ecc)
+				updated_fields |= rds_cache_restore(priv_state, st);
 			handle->valid_fields |= V4L2_RDS_ECC;
-			if (handle->ecc != grp->data_c_lsb)
+			if (handle->ecc != grp->data_c_lsb) {
 				updated_fields |= V4L2_RDS_ECC;
+				rds_value_event(priv_state, V4L2_RDS_EVENT_ECC,
+						grp->data_c_lsb);
+			}
 			handle->ecc = grp->data_c_lsb;
 		} else {
 			priv_state->new_ecc = grp->data_c_lsb;
@@ -422,6 +1074,9 @@ static uint32_t rds_decode_group1(struct rds_private_state *priv_state)
 		if (grp->data_c_lsb == priv_state->new_lc) {
 			handle->valid_fields |= V4L2_RDS_LC;
 			updated_fields |= V4L2_RDS_LC;
+			if (handle->lc != grp->data_c_lsb)
+				rds_value_event(priv_state, V4L2_RDS_EVENT_LC,
+						grp->data_c_lsb);
 			handle->lc = grp->data_c_lsb;
 		} else {
 			priv_state->new_lc = grp->data_c_lsb;
@@ -430,9 +1085,12 @@ static uint32_t rds_decode_group1(struct rds_private_state *priv_state)
 	return updated_fields;
 }
 
-/* group 2: radio text */
+/* group 2: radio text
+ * version_a is a constant in the callers, so that the compiler generates
+ * specialized code for 2A and 2B groups */
 // RT
-static uint32_t rds_decode_group2(struct rds_private_state *priv_state)
+static inline uint32_t rds_decode_group2(struct rds_private_state *priv_state,
+		bool version_a)
 {
 	struct v4l2_rds *handle = &priv_state->handle;
 	struct v4l2_rds_group *grp = &priv_state->rds_group;
@@ -443,6 +1101,12 @@ static uint32_t rds_decode_group2(struct rds_private_state *priv_state)
 	/* bit 4 of block b contains the A/B text flag (new radio text
 	 * will be transmitted) */
 	bool rt_ab_flag_n = grp->data_b_lsb & 0x10;  // 检查 A/B 标志位，用于判断是否是新的广播文本
+	/* further decoding of data depends on type of message (A or B)
+	 * Type A allows RTs with a max length of 64 chars (4 per segment)
+	 * Type B allows RTs with a max length of 32 chars (2 per segment) */
+	const uint8_t segment_len = version_a ? 4 : 2;
+	uint8_t *new_rt = &priv_state->new_rt[segment * segment_len];
+	struct v4l2_rds_event *ev;
 
 	/* new Radio Text will be transmitted */
 	if (rt_ab_flag_n != handle->rt_ab_flag) {
@@ -451,75 +1115,85 @@ static uint32_t rds_decode_group2(struct rds_private_state *priv_state)
 		handle->valid_fields &= ~V4L2_RDS_RT; // 标记文本无效
 		updated_fields |= V4L2_RDS_RT;  // 标记更新
 		priv_state->next_rt_segment = 0;   // 重置段计数器
+		priv_state->new_rt_received = 0;
+		rds_value_event(priv_state, V4L2_RDS_EVENT_RT_CLEAR, rt_ab_flag_n);
 	}
 
-	/* further decoding of data depends on type of message (A or B)
-	 * Type A allows RTs with a max length of 64 chars
-	 * Type B allows RTs with a max length of 32 chars */
-	// 数据的进一步解码取决于消息类型（A 或 B）
-	// A 类允许 RT 的最大长度为 64 个字符
-	// B 型允许 RT 最大长度为 32 个字符
-	if (grp->group_version == 'A') {
-		// 用于确保 RDS 文本片段按正确的顺序处理
-		// 当收到第一个片段（segment = 0）时，这是新文本消息的开始
-		// segment == priv_state->next_rt_segment, 保接收到的片段正是我们期待的下一个片段
-		if (segment == 0 || segment == priv_state->next_rt_segment) {  
-			priv_state->new_rt[segment * 4] = grp->data_c_msb;
-			priv_state->new_rt[segment * 4 + 1] = grp->data_c_lsb;
-			priv_state->new_rt[segment * 4 + 2] = grp->data_d_msb;
-			priv_state->new_rt[segment * 4 + 3] = grp->data_d_lsb;
-			priv_state->next_rt_segment = segment + 1;
-			if (segment == 0x0f) {  // 到达了最后一个文本片段 15, 16个片段*4 = 64 字节
-				handle->rt_length = 64;
-				handle->valid_fields |= V4L2_RDS_RT;
-				if (memcmp(handle->rt, priv_state->new_rt, 64)) {  // 当前文本和新文本不相同
-					memcpy(handle->rt, priv_state->new_rt, 64);  // 复制新文本
-					updated_fields |= V4L2_RDS_RT;
-				}
-				priv_state->next_rt_segment = 0;  // 重置段计数器
-			}
-		}
+	/* segments are only accepted in the correct order, segment 0
+	 * starts a new message */
+	// 用于确保 RDS 文本片段按正确的顺序处理
+	if (segment != 0 && segment != priv_state->next_rt_segment)
+		return updated_fields;
+
+	if (version_a) {
+		new_rt[0] = grp->data_c_msb;
+		new_rt[1] = grp->data_c_lsb;
+		new_rt[2] = grp->data_d_msb;
+		new_rt[3] = grp->data_d_lsb;
 	} else {
-		if (segment == 0 || segment == priv_state->next_rt_segment) {
-			priv_state->new_rt[segment * 2] = grp->data_d_msb;
-			priv_state->new_rt[segment * 2 + 1] = grp->data_d_lsb;
-			/* PI code in block C will be ignored */
-			priv_state->next_rt_segment = segment + 1;
-			if (segment == 0x0f) {
-				handle->rt_length = 32;
-				handle->valid_fields |= V4L2_RDS_RT;
-				updated_fields |= V4L2_RDS_RT;
-				if (memcmp(handle->rt, priv_state->new_rt, 32)) {
-					memcpy(handle->rt, priv_state->new_rt, 32);
-					updated_fields |= V4L2_RDS_RT;
-				}
-				priv_state->next_rt_segment = 0;
-			}
+		/* PI code in block C will be ignored */
+		new_rt[0] = grp->data_d_msb;
+		new_rt[1] = grp->data_d_lsb;
+	}
+	priv_state->next_rt_segment = segment + 1;
+	priv_state->new_rt_received = (segment + 1) * segment_len;
+	if ((ev = rds_new_event(priv_state, V4L2_RDS_EVENT_RT_SEGMENT))) {
+		ev->value = segment;
+		ev->pos = segment * segment_len;
+		ev->len = segment_len;
+		memcpy(ev->data, new_rt, segment_len);
+	}
+	if (segment == 0x0f) {  // 到达了最后一个文本片段
+		handle->rt_length = 16 * segment_len;
+		handle->valid_fields |= V4L2_RDS_RT;
+		if (!version_a)
+			updated_fields |= V4L2_RDS_RT;
+		if (memcmp(handle->rt, priv_state->new_rt, handle->rt_length)) {
+			memcpy(handle->rt, priv_state->new_rt, handle->rt_length);
+			updated_fields |= V4L2_RDS_RT;
+			rds_value_event(priv_state, V4L2_RDS_EVENT_RT,
+					handle->rt_length);
 		}
+		priv_state->next_rt_segment = 0;  // 重置段计数器
 	}
 
 	/* determine if complete rt was received
-	 * a carriage return (0x0d) can end a message early */
-	// 判断是否收到完整的rt
+	 * a carriage return (0x0d) can end a message early. CRs of earlier
+	 * segments were already replaced, so only the new chars are checked */
 	// 回车符（0x0d）可以提前结束消息
-	for (int i = 0; i < 64; i++) {
-		if (priv_state->new_rt[i] == 0x0d) {   // 0x0d 是回车符 CR
-			/* replace CR with terminating character */
-			priv_state->new_rt[i] = '\0';     // 将回车符替换为字符串结束符
-			handle->rt_length = i;
-			handle->valid_fields |= V4L2_RDS_RT;
-			// 更新文本并标记变化
-			if (memcmp(handle->rt, priv_state->new_rt, handle->rt_length)) {
-					memcpy(handle->rt, priv_state->new_rt,
-						handle->rt_length);
-					updated_fields |= V4L2_RDS_RT;
-				}
-			priv_state->next_rt_segment = 0;
+	for (int i = 0; i < segment_len; i++) {
+		if (new_rt[i] != 0x0d)
+			continue;
+		/* replace CR with terminating character */
+		new_rt[i] = '\0';
+		handle->rt_length = segment * segment_len + i;
+		handle->valid_fields |= V4L2_RDS_RT;
+		if (memcmp(handle->rt, priv_state->new_rt, handle->rt_length)) {
+			memcpy(handle->rt, priv_state->new_rt, handle->rt_length);
+			updated_fields |= V4L2_RDS_RT;
+			rds_value_event(priv_state, V4L2_RDS_EVENT_RT,
+					handle->rt_length);
 		}
+		priv_state->next_rt_segment = 0;
+		priv_state->new_rt_received = handle->rt_length;
 	}
+
+	/* RT+ tags that refer to the received chars are complete now */
+	if (priv_state->rtplus.pending_cnt)
+		updated_fields |= rds_rtplus_update(&priv_state->rtplus, handle);
 	return updated_fields;
 }
 
+static uint32_t rds_decode_group2a(struct rds_private_state *priv_state)
+{
+	return rds_decode_group2(priv_state, true);
+}
+
+static uint32_t rds_decode_group2b(struct rds_private_state *priv_state)
+{
+	return rds_decode_group2(priv_state, false);
+}
+
 /* group 3: Open Data Announcements */
 static uint32_t rds_decode_group3(struct rds_private_state *priv_state)
 {
@@ -528,9 +1202,6 @@ static uint32_t rds_decode_group3(struct rds_private_state *priv_state)
 	struct v4l2_rds_oda new_oda;
 	uint32_t updated_fields = 0;
 
-	if (grp->group_version != 'A')
-		return 0;
-
 	/* 0th bit of block b contains Group Type Info version of announced ODA
 	 * Group Type info: 0 = A, 1 = B */
 	new_oda.group_version = (grp->data_b_lsb & 0x01) ? 'B' : 'A';
@@ -544,6 +1215,24 @@ static uint32_t rds_decode_group3(struct rds_private_state *priv_state)
 		handle->decode_information |= V4L2_RDS_ODA;
 		updated_fields |= V4L2_RDS_ODA;
 	}
+
+	/* block C carries ODA specific data */
+	for (int i = 0; i < priv_state->oda_decoder_cnt; i++) {
+		const struct v4l2_rds_oda_decoder *dec = &priv_state->oda_decoders[i];
+
+		if (dec->aid == new_oda.aid && dec->announce)
+			updated_fields |= dec->announce(handle, grp, dec->priv);
+	}
+
+	/* TMC announcements carry the location table number in block C */
+	if (new_oda.aid == RDS_AID_TMC || new_oda.aid == RDS_AID_TMC_ALT) {
+		rds_tmc_decode_announcement(&priv_state->tmc,
+			(grp->data_c_msb << 8) | grp->data_c_lsb);
+		if (!(handle->valid_fields & V4L2_RDS_TMC)) {
+			handle->valid_fields |= V4L2_RDS_TMC;
+			updated_fields |= V4L2_RDS_TMC;
+		}
+	}
 	return updated_fields;
 }
 
@@ -602,12 +1291,10 @@ static uint32_t rds_decode_group4(struct rds_private_state *priv_state)
 {
 	struct v4l2_rds *handle = &priv_state->handle;
 	struct v4l2_rds_group *grp = &priv_state->rds_group;
+	struct v4l2_rds_event *ev;
 	uint32_t mjd;
 	uint32_t updated_fields = 0;
 
-	if (grp->group_version != 'A')
-		return 0;
-
 	/* bits 0-1 of block b lsb contain bits 15 and 16 of Julian day code
 	 * bits 0-7 of block c msb contain bits 7 to 14 of Julian day code
 	 * bits 1-7 of block c lsb contain bits 0 to 6 of Julian day code */
@@ -636,8 +1323,9 @@ static uint32_t rds_decode_group4(struct rds_private_state *priv_state)
 	/* decode RDS time representation into commonly used c representation */
 	handle->time = rds_decode_mjd(priv_state);
 	updated_fields |= V4L2_RDS_TIME;
+	if ((ev = rds_new_event(priv_state, V4L2_RDS_EVENT_TIME)))
+		ev->time = handle->time;
 	handle->valid_fields |= V4L2_RDS_TIME;
-	printf("\nLIB: time_t: %ld", handle->time);
 	return updated_fields;
 }
 
@@ -648,6 +1336,7 @@ static uint32_t rds_decode_group10(struct rds_private_state *priv_state)
 	struct v4l2_rds_group *grp = &priv_state->rds_group;
 	uint32_t updated_fields = 0;
 	uint8_t ptyn_tmp[4];
+	struct v4l2_rds_event *ev;
 
 	/* bit 0 of block B contain the segment code */
 	uint8_t segment_code = grp->data_b_lsb & 0x01;
@@ -655,9 +1344,6 @@ static uint32_t rds_decode_group10(struct rds_private_state *priv_state)
 	 * will be transmitted) */
 	bool ptyn_ab_flag_n = grp->data_b_lsb & 0x10;
 
-	if (grp->group_version != 'A')
-		return 0;
-
 	/* new Program Type Text will be transmitted */
 	if (ptyn_ab_flag_n != handle->ptyn_ab_flag) {
 		handle->ptyn_ab_flag = ptyn_ab_flag_n;
@@ -690,47 +1376,422 @@ static uint32_t rds_decode_group10(struct rds_private_state *priv_state)
 		}
 		handle->valid_fields |= V4L2_RDS_PTYN;
 		updated_fields |= V4L2_RDS_PTYN;
+		if ((ev = rds_new_event(priv_state, V4L2_RDS_EVENT_PTYN))) {
+			ev->len = 8;
+			memcpy(ev->data, handle->ptyn, 8);
+		}
 	}
 	return updated_fields;
 }
 
+/* group 8A: Traffic Message Channel, decoded in tmc.c */
+static uint32_t rds_decode_group8(struct rds_private_state *priv_state)
+{
+	struct v4l2_rds *handle = &priv_state->handle;
+	uint32_t updated_fields = 0;
+	uint32_t seq;
+
+	if (!(handle->valid_fields & V4L2_RDS_TMC)) {
+		handle->valid_fields |= V4L2_RDS_TMC;
+		updated_fields |= V4L2_RDS_TMC;
+	}
+	seq = rds_tmc_decode_group(&priv_state->tmc, &priv_state->rds_group);
+	if (seq) {
+		updated_fields |= V4L2_RDS_TMC;
+		rds_value_event(priv_state, V4L2_RDS_EVENT_TMC, seq);
+	}
+	return updated_fields;
+}
+
+/* returns the entry of the other network with the given PI code, it is
+ * added if it is new and there is room for it */
+static struct v4l2_rds_eon *rds_find_eon(struct rds_private_state *priv_state,
+		uint16_t pi)
+{
+	struct v4l2_rds_eon *eon;
+
+	for (int i = 0; i < priv_state->eon_cnt; i++)
+		if (priv_state->eon[i].pi == pi)
+			return &priv_state->eon[i];
+	if (!pi || priv_state->eon_cnt >= MAX_EON_CNT)
+		return NULL;
+	eon = &priv_state->eon[priv_state->eon_cnt];
+	memset(eon, 0, sizeof(*eon));
+	eon->pi = pi;
+	priv_state->eon_ps_segments[priv_state->eon_cnt++] = 0;
+	return eon;
+}
+
+/* adds the AFs of an other network, sent like the AFs of AF Method A in
+ * type 0A groups */
+static bool rds_add_eon_af(struct v4l2_rds_eon *eon, uint8_t c_msb, uint8_t c_lsb)
+{
+	struct v4l2_rds_af_set *af_set = &eon->af;
+	bool updated_af = false;
+	uint32_t freq;
+
+	if (c_msb >= 224 && c_msb <= 249) {
+		/* AF count, followed by an AF */
+		af_set->announced_af = c_msb - 224;
+	} else if (c_msb == 250) {
+		/* LF / MF frequency follows */
+		freq = rds_af_freq(c_lsb, false);
+		if (freq && rds_af_set_insert(af_set, freq, af_set->announced_af))
+			updated_af = true;
+		c_lsb = 0;
+	} else if ((freq = rds_af_freq(c_msb, true)) &&
+		   rds_af_set_insert(af_set, freq, af_set->announced_af)) {
+		updated_af = true;
+	}
+	if ((freq = rds_af_freq(c_lsb, true)) &&
+	    rds_af_set_insert(af_set, freq, af_set->announced_af))
+		updated_af = true;
+	if (af_set->announced_af && af_set->size >= af_set->announced_af)
+		eon->valid_fields |= V4L2_RDS_AF;
+	return updated_af;
+}
+
+/* adds a mapped frequency pair of an other network, unless it exists */
+static bool rds_add_eon_mapped(struct v4l2_rds_eon *eon, uint32_t tuned_freq,
+		uint32_t other_freq)
+{
+	struct v4l2_rds_eon_mapped *mapped = eon->mapped;
+	int pos = 0;
+
+	if (!tuned_freq || !other_freq)
+		return false;
+	while (pos < eon->mapped_cnt && (mapped[pos].tuned_freq < tuned_freq ||
+	       (mapped[pos].tuned_freq == tuned_freq && mapped[pos].other_freq < other_freq)))
+		pos++;
+	if (pos < eon->mapped_cnt && mapped[pos].tuned_freq == tuned_freq &&
+	    mapped[pos].other_freq == other_freq)
+		return false;
+	if (eon->mapped_cnt >= MAX_AF_CNT)
+		return false;
+	memmove(&mapped[pos + 1], &mapped[pos],
+		(eon->mapped_cnt - pos) * sizeof(mapped[0]));
+	mapped[pos].tuned_freq = tuned_freq;
+	mapped[pos].other_freq = other_freq;
+	eon->mapped_cnt++;
+	eon->valid_fields |= V4L2_RDS_AF;
+	return true;
+}
+
+/* sets a flag of an other network
+ * @field:	V4L2_RDS_TP or V4L2_RDS_TA
+ * @return:	true if the flag was unknown or changed */
+static bool rds_set_eon_flag(struct v4l2_rds_eon *eon, uint32_t field,
+		bool *flag, bool value)
+{
+	if ((eon->valid_fields & field) && *flag == value)
+		return false;
+	*flag = value;
+	eon->valid_fields |= field;
+	return true;
+}
+
+/* group 14: Enhanced Other Networks information */
+static uint32_t rds_decode_group14(struct rds_private_state *priv_state)
+{
+	struct v4l2_rds *handle = &priv_state->handle;
+	struct v4l2_rds_group *grp = &priv_state->rds_group;
+	struct v4l2_rds_eon *eon;
+	uint8_t c_msb = grp->data_c_msb;
+	uint8_t c_lsb = grp->data_c_lsb;
+	uint8_t *ps_segments;
+	uint8_t variant;
+	bool updated = false;
+
+	/* block D contains the PI code of the other network */
+	eon = rds_find_eon(priv_state, (grp->data_d_msb << 8) | grp->data_d_lsb);
+	if (!eon)
+		return 0;
+	/* bit 4 of block B contains the TP flag of the other network */
+	updated |= rds_set_eon_flag(eon, V4L2_RDS_TP, &eon->tp,
+			grp->data_b_lsb & 0x10);
+
+	/* version B groups carry the TA flag of the other network in bit 3
+	 * of block B, block C repeats the PI code of the tuned network */
+	if (grp->group_version == 'B') {
+		updated |= rds_set_eon_flag(eon, V4L2_RDS_TA, &eon->ta,
+				grp->data_b_lsb & 0x08);
+		goto done;
+	}
+
+	/* bits 0-3 of block B contain the variant code, which defines the
+	 * meaning of block C */
+	variant = grp->data_b_lsb & 0x0f;
+	switch (variant) {
+	case 0:
+	case 1:
+	case 2:
+	case 3:
+		/* PS name, 2 chars per segment */
+		ps_segments = &priv_state->eon_ps_segments[eon - priv_state->eon];
+		if (eon->ps[2 * variant] != c_msb || eon->ps[2 * variant + 1] != c_lsb) {
+			eon->ps[2 * variant] = c_msb;
+			eon->ps[2 * variant + 1] = c_lsb;
+			updated |= (eon->valid_fields & V4L2_RDS_PS) != 0;
+		}
+		*ps_segments |= 1 << variant;
+		if (*ps_segments == 0x0f && !(eon->valid_fields & V4L2_RDS_PS)) {
+			eon->valid_fields |= V4L2_RDS_PS;
+			updated = true;
+		}
+		break;
+	case 4:
+		/* AFs of the other network */
+		updated |= rds_add_eon_af(eon, c_msb, c_lsb);
+		break;
+	case 5:
+	case 6:
+	case 7:
+	case 8:
+		/* mapped FM frequency: tuned network in block C msb, other
+		 * network in block C lsb */
+		updated |= rds_add_eon_mapped(eon, rds_af_freq(c_msb, true),
+				rds_af_freq(c_lsb, true));
+		break;
+	case 9:
+		/* mapped AM frequency */
+		updated |= rds_add_eon_mapped(eon, rds_af_freq(c_msb, true),
+				rds_af_freq(c_lsb, false));
+		break;
+	case 13:
+		/* PTY in bits 11-15 and TA flag in bit 0 of block C */
+		if (!(eon->valid_fields & V4L2_RDS_PTY) || eon->pty != c_msb >> 3) {
+			eon->pty = c_msb >> 3;
+			eon->valid_fields |= V4L2_RDS_PTY;
+			updated = true;
+		}
+		updated |= rds_set_eon_flag(eon, V4L2_RDS_TA, &eon->ta, c_lsb & 0x01);
+		break;
+	default:
+		/* linkage information, PIN and reserved variants are not
+		 * decoded */
+		break;
+	}
+
+done:
+	if (!updated)
+		return 0;
+	handle->valid_fields |= V4L2_RDS_EON;
+	rds_value_event(priv_state, V4L2_RDS_EVENT_EON, eon->pi);
+	return V4L2_RDS_EON;
+}
+
 typedef uint32_t (*decode_group_func)(struct rds_private_state *);
 
-/* array of function pointers to contain all group specific decoding functions */
-static const decode_group_func decode_group[16] = {
-	[0] = rds_decode_group0,
-	[1] = rds_decode_group1,
-	[2] = rds_decode_group2,
-	[3] = rds_decode_group3,
-	[4] = rds_decode_group4,
-	[10] = rds_decode_group10,
+/* array of function pointers to contain all group specific decoding
+ * functions, indexed by the group type code. Type 1B, 3B, 4B, 8B and 10B
+ * groups carry no information decoded by this library */
+static const decode_group_func decode_group[32] = {
+	[RDS_GROUP_TYPE(0, 'A')] = rds_decode_group0a,
+	[RDS_GROUP_TYPE(0, 'B')] = rds_decode_group0b,
+	[RDS_GROUP_TYPE(1, 'A')] = rds_decode_group1,
+	[RDS_GROUP_TYPE(2, 'A')] = rds_decode_group2a,
+	[RDS_GROUP_TYPE(2, 'B')] = rds_decode_group2b,
+	[RDS_GROUP_TYPE(3, 'A')] = rds_decode_group3,
+	[RDS_GROUP_TYPE(4, 'A')] = rds_decode_group4,
+	[RDS_GROUP_TYPE(8, 'A')] = rds_decode_group8,
+	[RDS_GROUP_TYPE(10, 'A')] = rds_decode_group10,
+	[RDS_GROUP_TYPE(14, 'A')] = rds_decode_group14,
+	[RDS_GROUP_TYPE(14, 'B')] = rds_decode_group14,
 };
 
-static uint32_t rds_decode_group(struct rds_private_state *priv_state)
+/* blocks that have to be received without errors to decode a group.
+ * Group 0 checks block C and D itself, as they carry independent
+ * information (AF and PS). Block C of version B groups only repeats
+ * the PI code */
+static const uint8_t decode_group_valid[32] = {
+	[RDS_GROUP_TYPE(0, 'A')] = RDS_VALID_B,
+	[RDS_GROUP_TYPE(0, 'B')] = RDS_VALID_B,
+	[RDS_GROUP_TYPE(1, 'A')] = RDS_VALID_B | RDS_VALID_C | RDS_VALID_D,
+	[RDS_GROUP_TYPE(2, 'A')] = RDS_VALID_B | RDS_VALID_C | RDS_VALID_D,
+	[RDS_GROUP_TYPE(2, 'B')] = RDS_VALID_B | RDS_VALID_D,
+	[RDS_GROUP_TYPE(3, 'A')] = RDS_VALID_B | RDS_VALID_C | RDS_VALID_D,
+	[RDS_GROUP_TYPE(4, 'A')] = RDS_VALID_B | RDS_VALID_C | RDS_VALID_D,
+	[RDS_GROUP_TYPE(8, 'A')] = RDS_VALID_B | RDS_VALID_C | RDS_VALID_D,
+	[RDS_GROUP_TYPE(10, 'A')] = RDS_VALID_B | RDS_VALID_C | RDS_VALID_D,
+	[RDS_GROUP_TYPE(14, 'A')] = RDS_VALID_B | RDS_VALID_C | RDS_VALID_D,
+	[RDS_GROUP_TYPE(14, 'B')] = RDS_VALID_B | RDS_VALID_D,
+};
+
+/* ODA groups: passed to the decoder registered for the announced AID */
+static uint32_t rds_decode_oda(struct rds_private_state *priv_state)
+{
+	const struct v4l2_rds_oda_decoder *dec =
+		&priv_state->oda_decoders[priv_state->oda_dispatch[priv_state->group_type] - 1];
+	uint8_t needed = RDS_VALID_B | RDS_VALID_D;
+
+	if (priv_state->rds_group.group_version == 'A')
+		needed |= RDS_VALID_C;
+	if ((priv_state->group_valid & needed) != needed)
+		return 0;
+	return dec->decode(&priv_state->handle, &priv_state->rds_group, dec->priv);
+}
+
+static inline uint32_t rds_decode_group(struct rds_private_state *priv_state)
 {
 	struct v4l2_rds *handle = &priv_state->handle;
-	uint8_t group_id = priv_state->rds_group.group_id;
+	uint8_t group_type = priv_state->group_type;
+	uint8_t needed = decode_group_valid[group_type];
+	uint32_t updated_fields = 0;
 
 	/* count the group type, and decode it if it is supported */
-	handle->rds_statistics.group_type_cnt[group_id]++;
-	if (decode_group[group_id])
-		return (*decode_group[group_id])(priv_state);
+	handle->rds_statistics.group_type_cnt[group_type >> 1]++;
+	if ((priv_state->group_valid & needed) != needed)
+		return 0;
+
+	/* 0A/0B (PS) and 2A/2B (RT) groups make up most of the traffic,
+	 * call their decoders directly so that they can be inlined */
+	switch (group_type) {
+	case RDS_GROUP_TYPE(0, 'A'):
+		return rds_decode_group0(priv_state, true);
+	case RDS_GROUP_TYPE(0, 'B'):
+		return rds_decode_group0(priv_state, false);
+	case RDS_GROUP_TYPE(2, 'A'):
+		return rds_decode_group2(priv_state, true);
+	case RDS_GROUP_TYPE(2, 'B'):
+		return rds_decode_group2(priv_state, false);
+	}
+	if (decode_group[group_type])
+		updated_fields = (*decode_group[group_type])(priv_state);
+	if (priv_state->oda_dispatch[group_type])
+		updated_fields |= rds_decode_oda(priv_state);
+	return updated_fields;
+}
+
+/* publishes the current state of the handle as a new snapshot */
+static void rds_publish(struct rds_private_state *priv_state)
+{
+	struct rds_snapshots *snap = priv_state->snapshots;
+	/* only the decoding thread writes to the counters */
+	uint32_t seq = snap->done + 1;
+
+	__atomic_store_n(&snap->start, seq, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	snap->buf[seq & 1] = priv_state->handle;
+	__atomic_store_n(&snap->done, seq, __ATOMIC_RELEASE);
+}
+
+static inline void rds_snapshot(struct rds_private_state *priv_state)
+{
+	if (priv_state->snapshots)
+		rds_publish(priv_state);
+	if (priv_state->shm)
+		rds_shm_publish(priv_state->shm, &priv_state->handle);
+}
+
+int v4l2_rds_enable_snapshots(struct v4l2_rds *handle)
+{
+	struct rds_private_state *priv_state = (struct rds_private_state *) handle;
+
+	if (priv_state->snapshots)
+		return 0;
+	priv_state->snapshots = calloc(1, sizeof(*priv_state->snapshots));
+	if (!priv_state->snapshots)
+		return -1;
+	rds_publish(priv_state);
 	return 0;
 }
 
+const struct v4l2_rds *v4l2_rds_snapshot_begin(const struct v4l2_rds *handle,
+		uint32_t *seq)
+{
+	const struct rds_snapshots *snap =
+		((const struct rds_private_state *) handle)->snapshots;
+
+	if (!snap)
+		return NULL;
+	*seq = __atomic_load_n(&snap->done, __ATOMIC_ACQUIRE);
+	return &snap->buf[*seq & 1];
+}
+
+bool v4l2_rds_snapshot_retry(const struct v4l2_rds *handle, uint32_t seq)
+{
+	const struct rds_snapshots *snap =
+		((const struct rds_private_state *) handle)->snapshots;
+
+	if (!snap)
+		return false;
+	/* the reads of the snapshot must be complete before start is read */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&snap->start, __ATOMIC_RELAXED) - seq > 1;
+}
+
+bool v4l2_rds_get_snapshot(const struct v4l2_rds *handle, struct v4l2_rds *snapshot)
+{
+	const struct v4l2_rds *s;
+	uint32_t seq;
+
+	do {
+		s = v4l2_rds_snapshot_begin(handle, &seq);
+		if (!s)
+			return false;
+		*snapshot = *s;
+	} while (v4l2_rds_snapshot_retry(handle, seq));
+	return true;
+}
+
+void v4l2_rds_set_shm(struct v4l2_rds *handle, struct v4l2_rds_shm *shm)
+{
+	struct rds_private_state *priv_state = (struct rds_private_state *) handle;
+
+	priv_state->shm = shm;
+	if (shm)
+		rds_shm_publish(shm, handle);
+}
+
+int v4l2_rds_enable_metrics(struct v4l2_rds *handle)
+{
+	struct rds_private_state *priv_state = (struct rds_private_state *) handle;
+
+	if (priv_state->metrics)
+		return 0;
+	priv_state->metrics = calloc(1, sizeof(*priv_state->metrics));
+	return priv_state->metrics ? 0 : -1;
+}
+
+bool v4l2_rds_get_metrics(const struct v4l2_rds *handle,
+		struct v4l2_rds_metrics *metrics)
+{
+	const struct rds_private_state *priv_state =
+		(const struct rds_private_state *) handle;
+
+	if (!priv_state->metrics)
+		return false;
+	rds_metrics_get(priv_state->metrics, metrics);
+	return true;
+}
+
 struct v4l2_rds *v4l2_rds_create(bool is_rbds)
 {
 	struct rds_private_state *internal_handle =
 		calloc(1, sizeof(struct rds_private_state));
+	struct v4l2_rds_oda_decoder rtplus = {
+		.aid = RDS_AID_RTPLUS,
+		.decode = rds_rtplus_decode,
+	};
+
+	if (!internal_handle)
+		return NULL;
 	internal_handle->handle.is_rbds = is_rbds;
+	rtplus.priv = &internal_handle->rtplus;
+	v4l2_rds_register_oda(&internal_handle->handle, &rtplus);
 
 	return (struct v4l2_rds *)internal_handle;
 }
 
 void v4l2_rds_destroy(struct v4l2_rds *handle)
 {
-	if (handle)
+	if (handle) {
+		rds_cache_store((struct rds_private_state *)handle);
+		free(((struct rds_private_state *)handle)->af_lists);
+		free(((struct rds_private_state *)handle)->snapshots);
+		free(((struct rds_private_state *)handle)->metrics);
 		free(handle);
+	}
 }
 
 void v4l2_rds_reset(struct v4l2_rds *handle, bool reset_statistics)
@@ -740,14 +1801,153 @@ void v4l2_rds_reset(struct v4l2_rds *handle, bool reset_statistics)
 
 	/* store members of handle that shouldn't be affected by reset */
 	bool is_rbds = handle->is_rbds;
+	bool tolerant = priv_state->tolerant;
+	uint32_t event_mask = priv_state->event_mask;
+	struct v4l2_rds_tmc *tmc = priv_state->tmc.store;
+	struct v4l2_rds_oda_decoder oda_decoders[RDS_MAX_ODA_DECODERS];
+	uint8_t oda_decoder_cnt = priv_state->oda_decoder_cnt;
 	struct v4l2_rds_statistics rds_statistics = handle->rds_statistics;
 
-	/* reset the handle */
-	memset(priv_state, 0, sizeof(*priv_state));
+	/* keep what was learned about the current station */
+	rds_cache_store(priv_state);
+	free(priv_state->af_lists);
+	memcpy(oda_decoders, priv_state->oda_decoders, sizeof(oda_decoders));
+
+	/* reset the handle, up to the members that are kept */
+	memset(priv_state, 0, offsetof(struct rds_private_state, cache));
 	/* re-initialize members */
 	handle->is_rbds = is_rbds;
+	priv_state->tolerant = tolerant;
+	priv_state->event_mask = event_mask;
+	if (priv_state->metrics)
+		memset(priv_state->metrics, 0, sizeof(*priv_state->metrics));
+	priv_state->tmc.store = tmc;
+	memcpy(priv_state->oda_decoders, oda_decoders, sizeof(oda_decoders));
+	priv_state->oda_decoder_cnt = oda_decoder_cnt;
 	if (!reset_statistics)
 		handle->rds_statistics = rds_statistics;
+	rds_snapshot(priv_state);
+}
+
+struct v4l2_rds_cache *v4l2_rds_cache_create(unsigned max_stations)
+{
+	struct v4l2_rds_cache *cache;
+	uint32_t slot_cnt = 16;
+	uint8_t bits = 4;
+
+	if (!max_stations || max_stations > 65535) {
+		errno = EINVAL;
+		return NULL;
+	}
+	/* keep the table at most half full, for short probe sequences */
+	while (slot_cnt < 2 * max_stations) {
+		slot_cnt *= 2;
+		bits++;
+	}
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+	cache->slots = calloc(slot_cnt, sizeof(*cache->slots));
+	if (!cache->slots) {
+		free(cache);
+		return NULL;
+	}
+	cache->hash_shift = 32 - bits;
+	cache->slot_mask = slot_cnt - 1;
+	cache->max_stations = max_stations;
+	return cache;
+}
+
+void v4l2_rds_cache_destroy(struct v4l2_rds_cache *cache)
+{
+	if (cache) {
+		free(cache->slots);
+		free(cache);
+	}
+}
+
+void v4l2_rds_set_cache(struct v4l2_rds *handle, struct v4l2_rds_cache *cache)
+{
+	struct rds_private_state *priv_state = (struct rds_private_state *) handle;
+
+	rds_cache_store(priv_state);
+	priv_state->cache = cache;
+}
+
+int v4l2_rds_register_oda(struct v4l2_rds *handle,
+		const struct v4l2_rds_oda_decoder *decoder)
+{
+	struct rds_private_state *priv_state = (struct rds_private_state *) handle;
+	int i;
+
+	if (!decoder->decode) {
+		errno = EINVAL;
+		return -1;
+	}
+	for (i = 0; i < priv_state->oda_decoder_cnt; i++)
+		if (priv_state->oda_decoders[i].aid == decoder->aid)
+			break;
+	if (i == RDS_MAX_ODA_DECODERS) {
+		errno = ENOSPC;
+		return -1;
+	}
+	if (i == priv_state->oda_decoder_cnt)
+		priv_state->oda_decoder_cnt++;
+	priv_state->oda_decoders[i] = *decoder;
+	rds_update_oda_dispatch(priv_state);
+	return 0;
+}
+
+void v4l2_rds_unregister_oda(struct v4l2_rds *handle, uint16_t aid)
+{
+	struct rds_private_state *priv_state = (struct rds_private_state *) handle;
+
+	for (int i = 0; i < priv_state->oda_decoder_cnt; i++) {
+		if (priv_state->oda_decoders[i].aid != aid)
+			continue;
+		priv_state->oda_decoders[i] =
+			priv_state->oda_decoders[--priv_state->oda_decoder_cnt];
+		rds_update_oda_dispatch(priv_state);
+		return;
+	}
+}
+
+void v4l2_rds_set_tmc(struct v4l2_rds *handle, struct v4l2_rds_tmc *tmc)
+{
+	struct rds_private_state *priv_state = (struct rds_private_state *) handle;
+
+	/* drop partially received messages */
+	memset(priv_state->tmc.assembly, 0, sizeof(priv_state->tmc.assembly));
+	priv_state->tmc.last_valid = false;
+	priv_state->tmc.store = tmc;
+}
+
+void v4l2_rds_set_events(struct v4l2_rds *handle, uint32_t event_mask)
+{
+	struct rds_private_state *priv_state = (struct rds_private_state *) handle;
+
+	priv_state->event_mask = event_mask & V4L2_RDS_EVENT_ALL;
+}
+
+bool v4l2_rds_get_event(struct v4l2_rds *handle, struct v4l2_rds_event *ev)
+{
+	struct rds_private_state *priv_state = (struct rds_private_state *) handle;
+
+	/* report lost events first, the consumer has to resynchronize
+	 * with the handle before applying later changes */
+	if (priv_state->events_lost) {
+		memset(ev, 0, sizeof(*ev));
+		ev->type = V4L2_RDS_EVENT_OVERFLOW;
+		ev->value = priv_state->events_lost;
+		priv_state->events_lost = 0;
+		return true;
+	}
+	if (!priv_state->event_cnt)
+		return false;
+	*ev = priv_state->events[priv_state->event_head];
+	priv_state->event_head = (priv_state->event_head + 1) % RDS_EVENT_QUEUE;
+	priv_state->event_cnt--;
+	return true;
 }
 
 /* function decodes raw RDS data blocks into complete groups. Once a full group is
@@ -763,19 +1963,106 @@ void v4l2_rds_reset(struct v4l2_rds *handle, bool reset_statistics)
  * 这种方式比直接解码与组类型无关的信息要慢，但能有效防止数据损坏，  
  * （在信号接收较弱时，数据损坏是常见情况）。 
  */
-uint32_t v4l2_rds_add(struct v4l2_rds *handle, struct v4l2_rds_data *rds_data)
+/* decodes the blocks in rds_data_raw, that were marked as valid in
+ * group_valid, into the fields of the RDS handle
+ * @return:	true if the group could be decoded */
+static bool rds_decode_raw_group(struct rds_private_state *priv_state,
+		uint32_t *updated_fields)
 {
-	struct rds_private_state *priv_state = (struct rds_private_state *) handle;
+	struct v4l2_rds *handle = &priv_state->handle;
 	struct v4l2_rds_data *rds_data_raw = priv_state->rds_data_raw;
-	struct v4l2_rds_statistics *rds_stats = &handle->rds_statistics;
 
-	uint32_t updated_fields = 0;
+	/* without block B the group type is unknown */
+	if (!(priv_state->group_valid & RDS_VALID_B)) {
+		handle->rds_statistics.group_error_cnt++;
+		return false;
+	}
+	handle->rds_statistics.group_cnt++;
+
+	/* decode group type independent fields, every member
+	 * of rds_group is (re)written by rds_decode_a-d */
+	// 解码与组类型无关的字段
+	if (priv_state->group_valid & RDS_VALID_A) {
+		*updated_fields = rds_decode_a(priv_state, &rds_data_raw[0]);
+	} else {
+		*updated_fields = 0;
+		priv_state->rds_group.pi = handle->pi;
+	}
+	*updated_fields |= rds_decode_b(priv_state, &rds_data_raw[1]);
+	rds_decode_c(priv_state, &rds_data_raw[2]);
+	rds_decode_d(priv_state, &rds_data_raw[3]);
+
+	/* decode group type dependent fields */
+	// 解码与组类型有关的字段
+	*updated_fields |= rds_decode_group(priv_state);
+	if (priv_state->metrics)
+		rds_metrics_group(priv_state->metrics, handle,
+				priv_state->group_type >> 1);
+	if (priv_state->shm)
+		rds_shm_add_group(priv_state->shm, &priv_state->rds_group);
+	return true;
+}
+
+/* tolerant variant of the group state machine: erroneous blocks don't
+ * abort the group but are only marked as invalid, and missing blocks are
+ * skipped. The group is decoded as far as the valid blocks allow it once
+ * block D or a block of the next group arrives */
+static bool rds_add_block_tolerant(struct rds_private_state *priv_state,
+		int block_id, const struct v4l2_rds_data *rds_data,
+		uint32_t *updated_fields)
+{
+	uint8_t *decode_state = &(priv_state->decode_state);
+	bool valid = block_id >= 0 && block_id <= V4L2_RDS_BLOCK_C_ALT;
+	bool completed = false;
+	int pos;
+
+	/* erroneous blocks are assumed to be the next expected block,
+	 * type C and C' blocks are handled alike */
+	if (!valid)
+		pos = *decode_state;
+	else if (block_id == V4L2_RDS_BLOCK_C_ALT)
+		pos = V4L2_RDS_BLOCK_C;
+	else
+		pos = block_id;
+
+	/* a block belonging to an earlier position starts a new group */
+	if (pos < *decode_state) {
+		completed = rds_decode_raw_group(priv_state, updated_fields);
+		*decode_state = RDS_EMPTY;
+	}
+	if (*decode_state == RDS_EMPTY)
+		priv_state->group_valid = 0;
+
+	priv_state->rds_data_raw[pos] = *rds_data;
+	if (valid)
+		priv_state->group_valid |= 1 << pos;
+	*decode_state = pos + 1;
+
+	if (pos == V4L2_RDS_BLOCK_D) {
+		completed = rds_decode_raw_group(priv_state, updated_fields);
+		*decode_state = RDS_EMPTY;
+	}
+	return completed;
+}
+
+/* The block counter is not touched here, so that callers handling many
+ * blocks at once can update it in a single step.
+ * @return:	true if the block completed a group, the fields updated by
+ *		decoding that group are stored in updated_fields */
+static inline bool rds_add_block(struct rds_private_state *priv_state,
+		const struct v4l2_rds_data *rds_data, uint32_t *updated_fields)
+{
+	struct v4l2_rds *handle = &priv_state->handle;
+	struct v4l2_rds_data *rds_data_raw = priv_state->rds_data_raw;
+	struct v4l2_rds_statistics *rds_stats = &handle->rds_statistics;
 	uint8_t *decode_state = &(priv_state->decode_state);
 
 	/* get the block id by masking out irrelevant bits */
 	int block_id = rds_data->block & V4L2_RDS_BLOCK_MSK;
 
-	rds_stats->block_cnt++;
+	if (priv_state->metrics)
+		rds_metrics_block(priv_state->metrics, rds_data->block);
+
 	/* check for corrected / uncorrectable errors in the data */
 	// 数据校验
 	if (rds_data->block & V4L2_RDS_BLOCK_ERROR) {
@@ -785,13 +2072,16 @@ uint32_t v4l2_rds_add(struct v4l2_rds *handle, struct v4l2_rds_data *rds_data)
 		rds_stats->block_corrected_cnt++;
 	}
 
+	if (priv_state->tolerant)
+		return rds_add_block_tolerant(priv_state, block_id, rds_data,
+				updated_fields);
+
 	switch (*decode_state) {
 	case RDS_EMPTY:
 		if (block_id == 0) {
+			/* begin reception of a new data group, the raw buffer
+			 * entries are overwritten as the blocks arrive */
 			*decode_state = RDS_A_RECEIVED;
-			/* begin reception of a new data group, reset raw buffer to 0 */
-			// 开始接收新的数据组，重置原始缓冲区为 0
-			memset(rds_data_raw, 0, sizeof(rds_data_raw));
 			rds_data_raw[0] = *rds_data;
 		} else {
 			/* ignore block if it is not the first block of a group */
@@ -826,20 +2116,8 @@ uint32_t v4l2_rds_add(struct v4l2_rds *handle, struct v4l2_rds_data *rds_data)
 			*decode_state = RDS_EMPTY;
 			rds_data_raw[3] = *rds_data;
 			/* a full group was received */
-			rds_stats->group_cnt++;
-
-			/* decode group type independent fields */
-			// 解码与组类型无关的字段
-			memset(&priv_state->rds_group, 0, sizeof(priv_state->rds_group));
-			updated_fields |= rds_decode_a(priv_state, &rds_data_raw[0]);
-			updated_fields |= rds_decode_b(priv_state, &rds_data_raw[1]);
-			rds_decode_c(priv_state, &rds_data_raw[2]);
-			rds_decode_d(priv_state, &rds_data_raw[3]);
-
-			/* decode group type dependent fields */
-			// 解码与组类型有关的字段
-			updated_fields |= rds_decode_group(priv_state);
-			return updated_fields;
+			priv_state->group_valid = RDS_VALID_ALL;
+			return rds_decode_raw_group(priv_state, updated_fields);
 		}
 		rds_stats->group_error_cnt++;
 		*decode_state = RDS_EMPTY;
@@ -851,142 +2129,341 @@ uint32_t v4l2_rds_add(struct v4l2_rds *handle, struct v4l2_rds_data *rds_data)
 		*decode_state = RDS_EMPTY;
 	}
 	/* if we reach here, no RDS group was completed */
+	return false;
+}
+
+uint32_t v4l2_rds_add(struct v4l2_rds *handle, struct v4l2_rds_data *rds_data)
+{
+	struct rds_private_state *priv_state = (struct rds_private_state *) handle;
+	uint32_t updated_fields = 0;
+
+	handle->rds_statistics.block_cnt++;
+	if (rds_add_block(priv_state, rds_data, &updated_fields)) {
+		rds_snapshot(priv_state);
+		return updated_fields;
+	}
 	return 0;
 }
 
-const char *v4l2_rds_get_pty_str(const struct v4l2_rds *handle)
+unsigned v4l2_rds_add_blocks(struct v4l2_rds *handle,
+		const struct v4l2_rds_data *rds_data, unsigned n, uint32_t *updated)
 {
-	const uint8_t pty = handle->pty;
+	struct rds_private_state *priv_state = (struct rds_private_state *) handle;
+	unsigned group_cnt = 0;
+	uint32_t updated_fields;
+
+	handle->rds_statistics.block_cnt += n;
+	for (unsigned i = 0; i < n; i++) {
+		if (!rds_add_block(priv_state, &rds_data[i], &updated_fields))
+			continue;
+		if (updated)
+			updated[group_cnt] = updated_fields;
+		group_cnt++;
+	}
+	rds_snapshot(priv_state);
+	return group_cnt;
+}
 
-	if (pty >= 32)
-		return NULL;
+void v4l2_rds_set_tolerant(struct v4l2_rds *handle, bool tolerant)
+{
+	struct rds_private_state *priv_state = (struct rds_private_state *) handle;
 
-	static const char *rds_lut[32] = {
-		"None", "News", "Affairs", "Info", "Sport", "Education", "Drama",
-		"Culture", "Science", "Varied Speech", "Pop Music",
-		"Rock Music", "Easy Listening", "Light Classics M",
-		"Serious Classics", "Other Music", "Weather", "Finance",
-		"Children", "Social Affairs", "Religion", "Phone In",
-		"Travel & Touring", "Leisure & Hobby", "Jazz Music",
-		"Country Music", "National Music", "Oldies Music", "Folk Music",
-		"Documentary", "Alarm Test", "Alarm!"
-	};
-	static const char *rbds_lut[32] = {
-		"None", "News", "Information", "Sports", "Talk", "Rock",
-		"Classic Rock", "Adult Hits", "Soft Rock", "Top 40", "Country",
-		"Oldies", "Soft", "Nostalgia", "Jazz", "Classical",
-		"R&B", "Soft R&B", "Foreign Language", "Religious Music",
-		"Religious Talk", "Personality", "Public", "College",
-		"Spanish Talk", "Spanish Music", "Hip-Hop", "Unassigned",
-		"Unassigned", "Weather", "Emergency Test", "Emergency"
-	};
+	priv_state->tolerant = tolerant;
+	priv_state->decode_state = RDS_EMPTY;
+}
 
-	return handle->is_rbds ? rbds_lut[pty] : rds_lut[pty];
-}
-
-const char *v4l2_rds_get_country_str(const struct v4l2_rds *handle)
-{
-	/* defines the  region of the world
-	 * 0x0e = Europe, 0x0d = Africa, 0x0a = ITU Region 2,
-	 * 0x0f = ITU Region 3 */
-	uint8_t ecc_h = handle->ecc >> 4;
-	/* sub identifier for the region, valid range 0..4 */
-	uint8_t ecc_l = handle->ecc & 0x0f;
-	/* bits 12-15 pi contain the country code */
-	uint8_t country_code = handle->pi >> 12;
-
-	/* LUT for European countries
-	 * the standard doesn't define every possible value but leaves some
-	 * undefined. An exception is e4-7 which is defined as a dash ("-") */
-	static const char *e_lut[5][16] = {
-	{
-		NULL, "DE", "DZ", "AD", "IL", "IT", "BE", "RU", "PS", "AL",
-		"AT", "HU", "MT", "DE", NULL, "EG"
-	}, {
-		NULL, "GR", "CY", "SM", "CH", "JO", "FI", "LU", "BG", "DK",
-		"GI", "IQ", "GB", "LY", "RO", "FR"
-	}, {
-		NULL, "MA", "CZ", "PL", "VA", "SK", "SY", "TN", NULL, "LI",
-		"IS", "MC", "LT", "RS", "ES", "NO"
-	}, {
-		NULL, "ME", "IE", "TR", "MK", NULL, NULL, NULL, "NL", "LV",
-		"LB", "AZ", "HR", "KZ", "SE", "BY"
-	}, {
-		NULL, "MD", "EE", "KG", NULL, NULL, "UA", "-", "PT", "SI",
-		"AM", NULL, "GE", NULL, NULL, "BA"
+/* remainder of the polynomial division of a bits long word by RDS_POLY */
+static uint16_t rds_poly_mod(uint32_t word, int bits)
+{
+	for (int i = bits - 1; i >= 10; i--)
+		if (word & (1 << i))
+			word ^= RDS_POLY << (i - 10);
+	return word & 0x3ff;
+}
+
+static void rds_init_tables(void)
+{
+	for (int i = 0; i < 256; i++) {
+		rds_syndrome_msb[i] = rds_poly_mod(i << 18, RDS_BLOCK_BITS);
+		rds_syndrome_lsb[i] = rds_poly_mod(i << 10, RDS_BLOCK_BITS);
 	}
-	};
 
-	/* for now only European countries are supported -> ECC E0 - E4
-	 * but the standard defines country codes for the whole world,
-	 * that's the reason for returning "unknown" instead of a NULL
-	 * pointer until all defined countries are supported */
-	if (ecc_h == 0x0e && ecc_l <= 0x04)
-		return e_lut[ecc_l][country_code];
-	return "Unknown";
-}
-
-static const char *rds_language_lut(const uint8_t lc)
-{
-	const uint8_t max_lc = 127;
-	const char *language;
-
-	static const char *language_lut[128] = {
-		"Unknown", "Albanian", "Breton", "Catalan",
-		"Croatian", "Welsh", "Czech", "Danish",
-		"German", "English", "Spanish", "Esperanto",
-		"Estonian", "Basque", "Faroese", "French",
-		"Frisian", "Irish", "Gaelic", "Galician",
-		"Icelandic", "Italian", "Lappish", "Latin",
-		"Latvian", "Luxembourgian", "Lithuanian", "Hungarian",
-		"Maltese", "Dutch", "Norwegian", "Occitan",
-		"Polish", "Portuguese", "Romanian", "Ramansh",
-		"Serbian", "Slovak", "Slovene", "Finnish",
-		"Swedish", "Turkish", "Flemish", "Walloon",
-		NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-		NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-		NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-		NULL, "Zulu", "Vietnamese", "Uzbek",
-		"Urdu", "Ukrainian", "Thai", "Telugu",
-		"Tatar", "Tamil", "Tadzhik", "Swahili",
-		"Sranan Tongo", "Somali", "Sinhalese", "Shona",
-		"Serbo-Croat", "Ruthenian", "Russian", "Quechua",
-		"Pushtu", "Punjabi", "Persian", "Papamiento",
-		"Oriya", "Nepali", "Ndebele", "Marathi",
-		"Moldavian", "Malaysian", "Malagasay", "Macedonian",
-		"Laotian", "Korean", "Khmer", "Kazahkh",
-		"Kannada", "Japanese", "Indonesian", "Hindi",
-		"Hebrew", "Hausa", "Gurani", "Gujurati",
-		"Greek", "Georgian", "Fulani", "Dani",
-		"Churash", "Chinese", "Burmese", "Bulgarian",
-		"Bengali", "Belorussian", "Bambora", "Azerbaijani",
-		"Assamese", "Armenian", "Arabic", "Amharic"
-	};
+	/* all burst errors of up to RDS_MAX_BURST bits (first and last bit of
+	 * the burst set) have distinct syndromes. Shorter bursts are entered
+	 * first, as they are the more likely ones */
+	for (int len = 1; len <= RDS_MAX_BURST; len++) {
+		for (int inner = 0; inner < (1 << (len > 2 ? len - 2 : 0)); inner++) {
+			uint32_t burst = len == 1 ? 1 : (1 << (len - 1)) | (inner << 1) | 1;
 
-	/* filter invalid values and undefined table entries */
-	language = (lc > max_lc) ? "Unknown" : language_lut[lc];
-	if (!language)
-		return "Unknown";
-	return language;
+			for (int shift = 0; shift <= RDS_BLOCK_BITS - len; shift++) {
+				uint32_t error = burst << shift;
+				uint16_t syndrome = rds_poly_mod(error, RDS_BLOCK_BITS);
+
+				if (!rds_burst_error[syndrome])
+					rds_burst_error[syndrome] = error;
+			}
+		}
+	}
 }
 
-const char *v4l2_rds_get_language_str(const struct v4l2_rds *handle)
+/* the syndrome of a block without errors equals its offset word */
+static inline uint16_t rds_syndrome(uint32_t block)
 {
-	return rds_language_lut(handle->lc);
+	return rds_syndrome_msb[(block >> 18) & 0xff] ^
+		rds_syndrome_lsb[(block >> 10) & 0xff] ^ (block & 0x3ff);
 }
 
-const char *v4l2_rds_get_coverage_str(const struct v4l2_rds *handle)
+/* hands a block recovered from the raw bit stream to the group state machine
+ * @offset:	index of the offset word (A, B, C, C', D) of the block
+ * @flags:	V4L2_RDS_BLOCK_CORRECTED / V4L2_RDS_BLOCK_ERROR */
+static uint32_t rds_raw_add_block(struct rds_private_state *priv_state,
+		uint32_t block, int offset, uint8_t flags)
 {
-	/* bits 8-11 contain the area coverage code */
-	uint8_t coverage = (handle->pi >> 8) & 0X0f;
-	static const char *coverage_lut[16] = {
-		"Local", "International", "National", "Supra-Regional",
-		"Regional 1", "Regional 2", "Regional 3", "Regional 4",
-		"Regional 5", "Regional 6", "Regional 7", "Regional 8",
-		"Regional 9", "Regional 10", "Regional 11", "Regional 12"
-	};
+	struct v4l2_rds_data rds_data;
+	uint32_t updated_fields = 0;
+	uint8_t block_id = rds_offset_block_id[offset];
+
+	rds_data.msb = block >> 18;
+	rds_data.lsb = block >> 10;
+	/* bits 0-2 contain the block id, bits 3-5 the received block id */
+	rds_data.block = block_id | (block_id << 3) | flags;
+
+	priv_state->handle.rds_statistics.block_cnt++;
+	rds_add_block(priv_state, &rds_data, &updated_fields);
+	return updated_fields;
+}
+
+/* looks for an offset word at the current bit position. Synchronization is
+ * acquired once two offset words are found at a distance matching the
+ * order of the blocks within a group */
+static uint32_t rds_raw_sync(struct rds_private_state *priv_state)
+{
+	uint16_t syndrome = rds_syndrome(priv_state->raw_reg);
+	uint64_t pos = priv_state->raw_bit_pos;
+
+	for (int i = 0; i < 5; i++) {
+		if (syndrome != rds_offset_word[i])
+			continue;
+		for (int j = 0; j < 5; j++) {
+			uint64_t dist = pos - priv_state->raw_offset_pos[j];
+			uint64_t blocks = dist / RDS_BLOCK_BITS;
+
+			if (!priv_state->raw_offset_pos[j] ||
+					dist % RDS_BLOCK_BITS || blocks > 6 ||
+					(rds_offset_block_pos[j] + blocks) % 4 !=
+					rds_offset_block_pos[i])
+				continue;
+			priv_state->raw_synced = true;
+			priv_state->raw_bit_cnt = 0;
+			priv_state->raw_error_hist = 0;
+			priv_state->raw_next_block = (rds_offset_block_pos[i] + 1) % 4;
+			priv_state->handle.decode_information |= V4L2_RDS_SYNC;
+			return rds_raw_add_block(priv_state, priv_state->raw_reg, i, 0);
+		}
+		priv_state->raw_offset_pos[i] = pos;
+	}
+	return 0;
+}
+
+/* checks the block that just ended at the current bit position against the
+ * expected offset word, and corrects burst errors if possible */
+static uint32_t rds_raw_decode_block(struct rds_private_state *priv_state)
+{
+	uint32_t block = priv_state->raw_reg;
+	uint16_t syndrome = rds_syndrome(block);
+	uint8_t pos = priv_state->raw_next_block;
+	/* index of the offset word expected at this position */
+	int offset = (pos == 3) ? 4 : pos;
+	uint16_t error = syndrome ^ rds_offset_word[offset];
+	uint8_t flags = 0;
+
+	/* block C might as well be a C' block */
+	if (pos == 2 && error && (syndrome == rds_offset_word[3] ||
+			(!rds_burst_error[error] &&
+			rds_burst_error[syndrome ^ rds_offset_word[3]]))) {
+		offset = 3;
+		error = syndrome ^ rds_offset_word[3];
+	}
+	if (error) {
+		if (rds_burst_error[error]) {
+			block ^= rds_burst_error[error];
+			flags = V4L2_RDS_BLOCK_CORRECTED;
+		} else {
+			flags = V4L2_RDS_BLOCK_ERROR;
+		}
+	}
+	priv_state->raw_next_block = (pos + 1) % 4;
+
+	priv_state->raw_error_hist <<= 1;
+	priv_state->raw_error_hist |= (flags == V4L2_RDS_BLOCK_ERROR);
+	priv_state->raw_error_hist &= (1ULL << RDS_SYNC_WINDOW) - 1;
+	if (__builtin_popcountll(priv_state->raw_error_hist) > RDS_SYNC_MAX_ERRORS) {
+		/* lost synchronization, start searching again */
+		priv_state->raw_synced = false;
+		memset(priv_state->raw_offset_pos, 0,
+			sizeof(priv_state->raw_offset_pos));
+		priv_state->handle.decode_information &= ~V4L2_RDS_SYNC;
+	}
+	return rds_raw_add_block(priv_state, block, offset, flags);
+}
+
+uint32_t v4l2_rds_add_raw_bits(struct v4l2_rds *handle, const uint8_t *bits,
+		unsigned bit_cnt)
+{
+	struct rds_private_state *priv_state = (struct rds_private_state *) handle;
+	uint32_t updated_fields = 0;
+
+	pthread_once(&rds_tables_once, rds_init_tables);
+
+	for (unsigned i = 0; i < bit_cnt; i++) {
+		uint8_t bit = (bits[i / 8] >> (7 - i % 8)) & 0x01;
+
+		priv_state->raw_reg = ((priv_state->raw_reg << 1) | bit) &
+			((1 << RDS_BLOCK_BITS) - 1);
+		priv_state->raw_bit_pos++;
+
+		if (!priv_state->raw_synced) {
+			updated_fields |= rds_raw_sync(priv_state);
+			continue;
+		}
+		if (++priv_state->raw_bit_cnt < RDS_BLOCK_BITS)
+			continue;
+		priv_state->raw_bit_cnt = 0;
+		updated_fields |= rds_raw_decode_block(priv_state);
+	}
+	rds_snapshot(priv_state);
+	return updated_fields;
+}
+
+const struct v4l2_rds_af_list *v4l2_rds_get_af_lists(const struct v4l2_rds *handle,
+		unsigned *cnt)
+{
+	const struct rds_private_state *priv_state =
+		(const struct rds_private_state *) handle;
+
+	*cnt = priv_state->af_list_cnt;
+	return priv_state->af_lists;
+}
+
+const struct v4l2_rds_af_list *v4l2_rds_get_af_list(const struct v4l2_rds *handle,
+		uint32_t tuned_freq)
+{
+	const struct rds_private_state *priv_state =
+		(const struct rds_private_state *) handle;
+	int pos = rds_find_af_list(priv_state->af_lists, priv_state->af_list_cnt,
+			tuned_freq);
+
+	if (pos < priv_state->af_list_cnt &&
+	    priv_state->af_lists[pos].tuned_freq == tuned_freq)
+		return &priv_state->af_lists[pos];
+	return NULL;
+}
+
+bool v4l2_rds_is_af(const struct v4l2_rds *handle, uint32_t tuned_freq,
+		uint32_t freq, uint8_t *flags)
+{
+	const struct v4l2_rds_af_list *list = v4l2_rds_get_af_list(handle, tuned_freq);
+	const struct v4l2_rds_af_set *af_set = &handle->rds_af;
+	int lo = 0, hi = af_set->size;
+
+	if (list) {
+		int pos = rds_find_af_entry(list, freq);
+
+		if (pos == list->size || list->af[pos].freq != freq)
+			return false;
+		if (flags)
+			*flags = list->af[pos].flags;
+		return true;
+	}
 
-	return coverage_lut[coverage];
+	/* no Method B list for the tuned frequency, use the set of all AFs */
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (af_set->af[mid] < freq)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == af_set->size || af_set->af[lo] != freq)
+		return false;
+	if (flags)
+		*flags = 0;
+	return true;
+}
+
+const uint8_t *rds_get_rt_chars(const struct v4l2_rds *handle, uint8_t start,
+		uint8_t len)
+{
+	const struct rds_private_state *priv_state =
+		(const struct rds_private_state *) handle;
+
+	/* the RT being received first, it might be newer than handle->rt */
+	if (start + len <= priv_state->new_rt_received)
+		return &priv_state->new_rt[start];
+	if ((handle->valid_fields & V4L2_RDS_RT) && start + len <= handle->rt_length)
+		return &handle->rt[start];
+	return NULL;
+}
+
+const struct v4l2_rds_rtplus *v4l2_rds_get_rtplus(const struct v4l2_rds *handle)
+{
+	return &((const struct rds_private_state *) handle)->rtplus.info;
+}
+
+const struct v4l2_rds_rtplus_tag *v4l2_rds_get_rtplus_tag
+	(const struct v4l2_rds *handle, uint8_t content_type)
+{
+	const struct v4l2_rds_rtplus *info = v4l2_rds_get_rtplus(handle);
+
+	for (int i = 0; i < info->size; i++)
+		if (info->tag[i].content_type == content_type)
+			return &info->tag[i];
+	return NULL;
+}
+
+const struct v4l2_rds_eon *v4l2_rds_get_eons(const struct v4l2_rds *handle,
+		unsigned *cnt)
+{
+	const struct rds_private_state *priv_state =
+		(const struct rds_private_state *) handle;
+
+	*cnt = priv_state->eon_cnt;
+	return priv_state->eon;
+}
+
+const struct v4l2_rds_eon *v4l2_rds_get_eon(const struct v4l2_rds *handle,
+		uint16_t pi)
+{
+	const struct rds_private_state *priv_state =
+		(const struct rds_private_state *) handle;
+
+	for (int i = 0; i < priv_state->eon_cnt; i++)
+		if (priv_state->eon[i].pi == pi)
+			return &priv_state->eon[i];
+	return NULL;
+}
+
+uint32_t v4l2_rds_get_eon_freq(const struct v4l2_rds *handle, uint16_t pi,
+		uint32_t tuned_freq)
+{
+	const struct v4l2_rds_eon *eon = v4l2_rds_get_eon(handle, pi);
+	uint32_t freq = 0;
+
+	if (!eon)
+		return 0;
+	/* LF / MF frequencies sort first, prefer FM frequencies */
+	for (int i = 0; i < eon->mapped_cnt; i++) {
+		if (eon->mapped[i].tuned_freq != tuned_freq)
+			continue;
+		if (eon->mapped[i].other_freq >= 87500000)
+			return eon->mapped[i].other_freq;
+		if (!freq)
+			freq = eon->mapped[i].other_freq;
+	}
+	if (freq)
+		return freq;
+	return eon->af.size ? eon->af.af[0] : 0;
 }
 
 const struct v4l2_rds_group *v4l2_rds_get_group
@@ -0,0 +1,443 @@
+/*
+ * Lookup tables of the names of RDS codes
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335  USA
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <config.h>
+
+#include <linux/videodev2.h>
+
+#include "../include/libv4l2rds.h"
+
+/* All names are kept in one pool of '\0' terminated strings, built at
+ * compile time as a struct with one char array per name. The lookup
+ * tables hold 16 bit offsets into the pool instead of pointers: they are
+ * a quarter of the size, need no relocations when the library is loaded,
+ * and every name is stored only once. "Unknown" is the first name, so
+ * that entries left out of a table map to it */
+
+#define RDS_STRINGS(X) \
+	X(UNKNOWN, "Unknown")	/* must stay at offset 0 */ \
+	/* program types (RDS and RBDS) */ \
+	X(NONE, "None") \
+	X(NEWS, "News") \
+	X(AFFAIRS, "Affairs") \
+	X(INFO, "Info") \
+	X(SPORT, "Sport") \
+	X(EDUCATION, "Education") \
+	X(DRAMA, "Drama") \
+	X(CULTURE, "Culture") \
+	X(SCIENCE, "Science") \
+	X(VARIED_SPEECH, "Varied Speech") \
+	X(POP_MUSIC, "Pop Music") \
+	X(ROCK_MUSIC, "Rock Music") \
+	X(EASY_LISTENING, "Easy Listening") \
+	X(LIGHT_CLASSICS_M, "Light Classics M") \
+	X(SERIOUS_CLASSICS, "Serious Classics") \
+	X(OTHER_MUSIC, "Other Music") \
+	X(WEATHER, "Weather") \
+	X(FINANCE, "Finance") \
+	X(CHILDREN, "Children") \
+	X(SOCIAL_AFFAIRS, "Social Affairs") \
+	X(RELIGION, "Religion") \
+	X(PHONE_IN, "Phone In") \
+	X(TRAVEL_TOURING, "Travel & Touring") \
+	X(LEISURE_HOBBY, "Leisure & Hobby") \
+	X(JAZZ_MUSIC, "Jazz Music") \
+	X(COUNTRY_MUSIC, "Country Music") \
+	X(NATIONAL_MUSIC, "National Music") \
+	X(OLDIES_MUSIC, "Oldies Music") \
+	X(FOLK_MUSIC, "Folk Music") \
+	X(DOCUMENTARY, "Documentary") \
+	X(ALARM_TEST, "Alarm Test") \
+	X(ALARM, "Alarm!") \
+	X(INFORMATION, "Information") \
+	X(SPORTS, "Sports") \
+	X(TALK, "Talk") \
+	X(ROCK, "Rock") \
+	X(CLASSIC_ROCK, "Classic Rock") \
+	X(ADULT_HITS, "Adult Hits") \
+	X(SOFT_ROCK, "Soft Rock") \
+	X(TOP_40, "Top 40") \
+	X(COUNTRY, "Country") \
+	X(OLDIES, "Oldies") \
+	X(SOFT, "Soft") \
+	X(NOSTALGIA, "Nostalgia") \
+	X(JAZZ, "Jazz") \
+	X(CLASSICAL, "Classical") \
+	X(R_B, "R&B") \
+	X(SOFT_R_B, "Soft R&B") \
+	X(FOREIGN_LANGUAGE, "Foreign Language") \
+	X(RELIGIOUS_MUSIC, "Religious Music") \
+	X(RELIGIOUS_TALK, "Religious Talk") \
+	X(PERSONALITY, "Personality") \
+	X(PUBLIC, "Public") \
+	X(COLLEGE, "College") \
+	X(SPANISH_TALK, "Spanish Talk") \
+	X(SPANISH_MUSIC, "Spanish Music") \
+	X(HIP_HOP, "Hip-Hop") \
+	X(UNASSIGNED, "Unassigned") \
+	X(EMERGENCY_TEST, "Emergency Test") \
+	X(EMERGENCY, "Emergency") \
+	/* ISO 3166 country codes */ \
+	X(DE, "DE") \
+	X(DZ, "DZ") \
+	X(AD, "AD") \
+	X(IL, "IL") \
+	X(IT, "IT") \
+	X(BE, "BE") \
+	X(RU, "RU") \
+	X(PS, "PS") \
+	X(AL, "AL") \
+	X(AT, "AT") \
+	X(HU, "HU") \
+	X(MT, "MT") \
+	X(EG, "EG") \
+	X(GR, "GR") \
+	X(CY, "CY") \
+	X(SM, "SM") \
+	X(CH, "CH") \
+	X(JO, "JO") \
+	X(FI, "FI") \
+	X(LU, "LU") \
+	X(BG, "BG") \
+	X(DK, "DK") \
+	X(GI, "GI") \
+	X(IQ, "IQ") \
+	X(GB, "GB") \
+	X(LY, "LY") \
+	X(RO, "RO") \
+	X(FR, "FR") \
+	X(MA, "MA") \
+	X(CZ, "CZ") \
+	X(PL, "PL") \
+	X(VA, "VA") \
+	X(SK, "SK") \
+	X(SY, "SY") \
+	X(TN, "TN") \
+	X(LI, "LI") \
+	X(IS, "IS") \
+	X(MC, "MC") \
+	X(LT, "LT") \
+	X(RS, "RS") \
+	X(ES, "ES") \
+	X(NO, "NO") \
+	X(ME, "ME") \
+	X(IE, "IE") \
+	X(TR, "TR") \
+	X(MK, "MK") \
+	X(NL, "NL") \
+	X(LV, "LV") \
+	X(LB, "LB") \
+	X(AZ, "AZ") \
+	X(HR, "HR") \
+	X(KZ, "KZ") \
+	X(SE, "SE") \
+	X(BY, "BY") \
+	X(MD, "MD") \
+	X(EE, "EE") \
+	X(KG, "KG") \
+	X(UA, "UA") \
+	X(DASH, "-") \
+	X(PT, "PT") \
+	X(SI, "SI") \
+	X(AM, "AM") \
+	X(GE, "GE") \
+	X(BA, "BA") \
+	/* languages */ \
+	X(ALBANIAN, "Albanian") \
+	X(BRETON, "Breton") \
+	X(CATALAN, "Catalan") \
+	X(CROATIAN, "Croatian") \
+	X(WELSH, "Welsh") \
+	X(CZECH, "Czech") \
+	X(DANISH, "Danish") \
+	X(GERMAN, "German") \
+	X(ENGLISH, "English") \
+	X(SPANISH, "Spanish") \
+	X(ESPERANTO, "Esperanto") \
+	X(ESTONIAN, "Estonian") \
+	X(BASQUE, "Basque") \
+	X(FAROESE, "Faroese") \
+	X(FRENCH, "French") \
+	X(FRISIAN, "Frisian") \
+	X(IRISH, "Irish") \
+	X(GAELIC, "Gaelic") \
+	X(GALICIAN, "Galician") \
+	X(ICELANDIC, "Icelandic") \
+	X(ITALIAN, "Italian") \
+	X(LAPPISH, "Lappish") \
+	X(LATIN, "Latin") \
+	X(LATVIAN, "Latvian") \
+	X(LUXEMBOURGIAN, "Luxembourgian") \
+	X(LITHUANIAN, "Lithuanian") \
+	X(HUNGARIAN, "Hungarian") \
+	X(MALTESE, "Maltese") \
+	X(DUTCH, "Dutch") \
+	X(NORWEGIAN, "Norwegian") \
+	X(OCCITAN, "Occitan") \
+	X(POLISH, "Polish") \
+	X(PORTUGUESE, "Portuguese") \
+	X(ROMANIAN, "Romanian") \
+	X(RAMANSH, "Ramansh") \
+	X(SERBIAN, "Serbian") \
+	X(SLOVAK, "Slovak") \
+	X(SLOVENE, "Slovene") \
+	X(FINNISH, "Finnish") \
+	X(SWEDISH, "Swedish") \
+	X(TURKISH, "Turkish") \
+	X(FLEMISH, "Flemish") \
+	X(WALLOON, "Walloon") \
+	X(ZULU, "Zulu") \
+	X(VIETNAMESE, "Vietnamese") \
+	X(UZBEK, "Uzbek") \
+	X(URDU, "Urdu") \
+	X(UKRAINIAN, "Ukrainian") \
+	X(THAI, "Thai") \
+	X(TELUGU, "Telugu") \
+	X(TATAR, "Tatar") \
+	X(TAMIL, "Tamil") \
+	X(TADZHIK, "Tadzhik") \
+	X(SWAHILI, "Swahili") \
+	X(SRANAN_TONGO, "Sranan Tongo") \
+	X(SOMALI, "Somali") \
+	X(SINHALESE, "Sinhalese") \
+	X(SHONA, "Shona") \
+	X(SERBO_CROAT, "Serbo-Croat") \
+	X(RUTHENIAN, "Ruthenian") \
+	X(RUSSIAN, "Russian") \
+	X(QUECHUA, "Quechua") \
+	X(PUSHTU, "Pushtu") \
+	X(PUNJABI, "Punjabi") \
+	X(PERSIAN, "Persian") \
+	X(PAPAMIENTO, "Papamiento") \
+	X(ORIYA, "Oriya") \
+	X(NEPALI, "Nepali") \
+	X(NDEBELE, "Ndebele") \
+	X(MARATHI, "Marathi") \
+	X(MOLDAVIAN, "Moldavian") \
+	X(MALAYSIAN, "Malaysian") \
+	X(MALAGASAY, "Malagasay") \
+	X(MACEDONIAN, "Macedonian") \
+	X(LAOTIAN, "Laotian") \
+	X(KOREAN, "Korean") \
+	X(KHMER, "Khmer") \
+	X(KAZAHKH, "Kazahkh") \
+	X(KANNADA, "Kannada") \
+	X(JAPANESE, "Japanese") \
+	X(INDONESIAN, "Indonesian") \
+	X(HINDI, "Hindi") \
+	X(HEBREW, "Hebrew") \
+	X(HAUSA, "Hausa") \
+	X(GURANI, "Gurani") \
+	X(GUJURATI, "Gujurati") \
+	X(GREEK, "Greek") \
+	X(GEORGIAN, "Georgian") \
+	X(FULANI, "Fulani") \
+	X(DANI, "Dani") \
+	X(CHURASH, "Churash") \
+	X(CHINESE, "Chinese") \
+	X(BURMESE, "Burmese") \
+	X(BULGARIAN, "Bulgarian") \
+	X(BENGALI, "Bengali") \
+	X(BELORUSSIAN, "Belorussian") \
+	X(BAMBORA, "Bambora") \
+	X(AZERBAIJANI, "Azerbaijani") \
+	X(ASSAMESE, "Assamese") \
+	X(ARMENIAN, "Armenian") \
+	X(ARABIC, "Arabic") \
+	X(AMHARIC, "Amharic") \
+	/* area coverage */ \
+	X(LOCAL, "Local") \
+	X(INTERNATIONAL, "International") \
+	X(NATIONAL, "National") \
+	X(SUPRA_REGIONAL, "Supra-Regional") \
+	X(REGIONAL_1, "Regional 1") \
+	X(REGIONAL_2, "Regional 2") \
+	X(REGIONAL_3, "Regional 3") \
+	X(REGIONAL_4, "Regional 4") \
+	X(REGIONAL_5, "Regional 5") \
+	X(REGIONAL_6, "Regional 6") \
+	X(REGIONAL_7, "Regional 7") \
+	X(REGIONAL_8, "Regional 8") \
+	X(REGIONAL_9, "Regional 9") \
+	X(REGIONAL_10, "Regional 10") \
+	X(REGIONAL_11, "Regional 11") \
+	X(REGIONAL_12, "Regional 12")
+
+struct rds_str_pool {
+#define RDS_STR_MEMBER(id, str) char s_##id[sizeof(str)];
+	RDS_STRINGS(RDS_STR_MEMBER)
+#undef RDS_STR_MEMBER
+};
+
+static const struct rds_str_pool rds_str_pool = {
+#define RDS_STR_INIT(id, str) str,
+	RDS_STRINGS(RDS_STR_INIT)
+#undef RDS_STR_INIT
+};
+
+/* offset of a name in the pool */
+#define S(id) offsetof(struct rds_str_pool, s_##id)
+/* table entry without a name */
+#define RDS_STR_NULL 0xffff
+
+/* program types, indexed by is_rbds and PTY */
+static const uint16_t rds_pty_lut[2][32] = {
+	{
+		S(NONE), S(NEWS), S(AFFAIRS), S(INFO), S(SPORT), S(EDUCATION),
+		S(DRAMA), S(CULTURE), S(SCIENCE), S(VARIED_SPEECH),
+		S(POP_MUSIC), S(ROCK_MUSIC), S(EASY_LISTENING),
+		S(LIGHT_CLASSICS_M), S(SERIOUS_CLASSICS), S(OTHER_MUSIC),
+		S(WEATHER), S(FINANCE), S(CHILDREN), S(SOCIAL_AFFAIRS),
+		S(RELIGION), S(PHONE_IN), S(TRAVEL_TOURING), S(LEISURE_HOBBY),
+		S(JAZZ_MUSIC), S(COUNTRY_MUSIC), S(NATIONAL_MUSIC),
+		S(OLDIES_MUSIC), S(FOLK_MUSIC), S(DOCUMENTARY), S(ALARM_TEST),
+		S(ALARM)
+	}, {
+		S(NONE), S(NEWS), S(INFORMATION), S(SPORTS), S(TALK), S(ROCK),
+		S(CLASSIC_ROCK), S(ADULT_HITS), S(SOFT_ROCK), S(TOP_40),
+		S(COUNTRY), S(OLDIES), S(SOFT), S(NOSTALGIA), S(JAZZ),
+		S(CLASSICAL), S(R_B), S(SOFT_R_B), S(FOREIGN_LANGUAGE),
+		S(RELIGIOUS_MUSIC), S(RELIGIOUS_TALK), S(PERSONALITY),
+		S(PUBLIC), S(COLLEGE), S(SPANISH_TALK), S(SPANISH_MUSIC),
+		S(HIP_HOP), S(UNASSIGNED), S(UNASSIGNED), S(WEATHER),
+		S(EMERGENCY_TEST), S(EMERGENCY)
+	}
+};
+
+/* countries, indexed by the low nibble of ECC E0 - E4 (the European
+ * countries) and the country code in bits 12-15 of PI. The standard leaves
+ * some combinations undefined. An exception is e4-7 which is defined as a
+ * dash ("-") */
+static const uint16_t rds_country_lut[5][16] = {
+	{
+		RDS_STR_NULL, S(DE), S(DZ), S(AD), S(IL), S(IT), S(BE), S(RU),
+		S(PS), S(AL), S(AT), S(HU), S(MT), S(DE), RDS_STR_NULL, S(EG)
+	}, {
+		RDS_STR_NULL, S(GR), S(CY), S(SM), S(CH), S(JO), S(FI), S(LU),
+		S(BG), S(DK), S(GI), S(IQ), S(GB), S(LY), S(RO), S(FR)
+	}, {
+		RDS_STR_NULL, S(MA), S(CZ), S(PL), S(VA), S(SK), S(SY), S(TN),
+		RDS_STR_NULL, S(LI), S(IS), S(MC), S(LT), S(RS), S(ES), S(NO)
+	}, {
+		RDS_STR_NULL, S(ME), S(IE), S(TR), S(MK), RDS_STR_NULL,
+		RDS_STR_NULL, RDS_STR_NULL, S(NL), S(LV), S(LB), S(AZ), S(HR),
+		S(KZ), S(SE), S(BY)
+	}, {
+		RDS_STR_NULL, S(MD), S(EE), S(KG), RDS_STR_NULL, RDS_STR_NULL,
+		S(UA), S(DASH), S(PT), S(SI), S(AM), RDS_STR_NULL, S(GE),
+		RDS_STR_NULL, RDS_STR_NULL, S(BA)
+	}
+};
+
+/* languages, indexed by the language code. The codes above 127 are
+ * undefined, like the gaps of the defined range they map to "Unknown" */
+static const uint16_t rds_language_lut[256] = {
+	S(UNKNOWN), S(ALBANIAN), S(BRETON), S(CATALAN), S(CROATIAN), S(WELSH),
+	S(CZECH), S(DANISH), S(GERMAN), S(ENGLISH), S(SPANISH), S(ESPERANTO),
+	S(ESTONIAN), S(BASQUE), S(FAROESE), S(FRENCH), S(FRISIAN), S(IRISH),
+	S(GAELIC), S(GALICIAN), S(ICELANDIC), S(ITALIAN), S(LAPPISH), S(LATIN),
+	S(LATVIAN), S(LUXEMBOURGIAN), S(LITHUANIAN), S(HUNGARIAN), S(MALTESE),
+	S(DUTCH), S(NORWEGIAN), S(OCCITAN), S(POLISH), S(PORTUGUESE),
+	S(ROMANIAN), S(RAMANSH), S(SERBIAN), S(SLOVAK), S(SLOVENE), S(FINNISH),
+	S(SWEDISH), S(TURKISH), S(FLEMISH), S(WALLOON),
+	[69] = S(ZULU), S(VIETNAMESE), S(UZBEK), S(URDU), S(UKRAINIAN), S(THAI),
+	S(TELUGU), S(TATAR), S(TAMIL), S(TADZHIK), S(SWAHILI), S(SRANAN_TONGO),
+	S(SOMALI), S(SINHALESE), S(SHONA), S(SERBO_CROAT), S(RUTHENIAN),
+	S(RUSSIAN), S(QUECHUA), S(PUSHTU), S(PUNJABI), S(PERSIAN),
+	S(PAPAMIENTO), S(ORIYA), S(NEPALI), S(NDEBELE), S(MARATHI),
+	S(MOLDAVIAN), S(MALAYSIAN), S(MALAGASAY), S(MACEDONIAN), S(LAOTIAN),
+	S(KOREAN), S(KHMER), S(KAZAHKH), S(KANNADA), S(JAPANESE), S(INDONESIAN),
+	S(HINDI), S(HEBREW), S(HAUSA), S(GURANI), S(GUJURATI), S(GREEK),
+	S(GEORGIAN), S(FULANI), S(DANI), S(CHURASH), S(CHINESE), S(BURMESE),
+	S(BULGARIAN), S(BENGALI), S(BELORUSSIAN), S(BAMBORA), S(AZERBAIJANI),
+	S(ASSAMESE), S(ARMENIAN), S(ARABIC), S(AMHARIC)
+};
+
+/* area coverage, indexed by bits 8-11 of PI */
+static const uint16_t rds_coverage_lut[16] = {
+	S(LOCAL), S(INTERNATIONAL), S(NATIONAL), S(SUPRA_REGIONAL),
+	S(REGIONAL_1), S(REGIONAL_2), S(REGIONAL_3), S(REGIONAL_4),
+	S(REGIONAL_5), S(REGIONAL_6), S(REGIONAL_7), S(REGIONAL_8),
+	S(REGIONAL_9), S(REGIONAL_10), S(REGIONAL_11), S(REGIONAL_12)
+};
+
+static inline const char *rds_str(uint16_t offset)
+{
+	return offset == RDS_STR_NULL ? NULL : (const char *)&rds_str_pool + offset;
+}
+
+static inline const char *rds_pty_str(uint8_t pty, bool is_rbds)
+{
+	return pty < 32 ? rds_str(rds_pty_lut[is_rbds][pty]) : NULL;
+}
+
+static inline const char *rds_country_str(uint16_t pi, uint8_t ecc)
+{
+	/* for now only European countries are supported -> ECC E0 - E4
+	 * but the standard defines country codes for the whole world,
+	 * that's the reason for returning "unknown" instead of a NULL
+	 * pointer until all defined countries are supported */
+	uint8_t ecc_l = ecc - 0xe0;
+
+	if (ecc_l <= 0x04)
+		return rds_str(rds_country_lut[ecc_l][pi >> 12]);
+	return rds_str(S(UNKNOWN));
+}
+
+static inline const char *rds_language_str(uint8_t lc)
+{
+	return (const char *)&rds_str_pool + rds_language_lut[lc];
+}
+
+static inline const char *rds_coverage_str(uint16_t pi)
+{
+	return (const char *)&rds_str_pool + rds_coverage_lut[(pi >> 8) & 0x0f];
+}
+
+const char *v4l2_rds_get_pty_str(const struct v4l2_rds *handle)
+{
+	return rds_pty_str(handle->pty, handle->is_rbds);
+}
+
+const char *v4l2_rds_get_country_str(const struct v4l2_rds *handle)
+{
+	return rds_country_str(handle->pi, handle->ecc);
+}
+
+const char *v4l2_rds_get_language_str(const struct v4l2_rds *handle)
+{
+	return rds_language_str(handle->lc);
+}
+
+const char *v4l2_rds_get_coverage_str(const struct v4l2_rds *handle)
+{
+	return rds_coverage_str(handle->pi);
+}
+
+void v4l2_rds_get_strs(const struct v4l2_rds_str_key *keys, unsigned n,
+		struct v4l2_rds_strs *strs)
+{
+	for (unsigned i = 0; i < n; i++) {
+		strs[i].pty = rds_pty_str(keys[i].pty, keys[i].is_rbds);
+		strs[i].country = rds_country_str(keys[i].pi, keys[i].ecc);
+		strs[i].language = rds_language_str(keys[i].lc);
+		strs[i].coverage = rds_coverage_str(keys[i].pi);
+	}
+}
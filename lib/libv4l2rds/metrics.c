@@ -0,0 +1,116 @@
+/*
+ * Reception quality metrics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335  USA
+ */
+
+#include <string.h>
+#include <config.h>
+
+#include "libv4l2rds-priv.h"
+
+/* a block takes 26 bits at 1187.5 bit/s, i.e. 52 / 2375 s */
+static inline uint32_t rds_metrics_second(uint64_t blocks)
+{
+	return blocks * 52 / 2375;
+}
+
+static inline uint32_t rds_metrics_ms(uint64_t blocks)
+{
+	return blocks * 52000 / 2375;
+}
+
+void rds_metrics_block(struct rds_metrics *metrics, uint8_t block)
+{
+	uint32_t second = rds_metrics_second(++metrics->blocks);
+	struct rds_metrics_bucket *bucket =
+		&metrics->bucket[second % V4L2_RDS_METRICS_WINDOW];
+
+	/* the bucket still holds a second that left the window */
+	if (bucket->second != second) {
+		memset(bucket, 0, sizeof(*bucket));
+		bucket->second = second;
+	}
+	metrics->cur = bucket;
+	bucket->blocks++;
+	if (block & V4L2_RDS_BLOCK_ERROR)
+		bucket->block_errors++;
+	else if (block & V4L2_RDS_BLOCK_CORRECTED)
+		bucket->block_corrected++;
+}
+
+void rds_metrics_group(struct rds_metrics *metrics,
+		const struct v4l2_rds *handle, uint8_t group_id)
+{
+	uint64_t now = metrics->blocks;
+
+	metrics->cur->group_cnt[group_id]++;
+
+	if (metrics->last_group) {
+		/* gap in group durations (4 blocks), rounded up */
+		uint64_t groups = (now - metrics->last_group + 3) / 4;
+		int bin = groups <= 1 ? 0 : 64 - __builtin_clzll(groups - 1);
+
+		if (bin >= V4L2_RDS_METRICS_GAP_BINS)
+			bin = V4L2_RDS_METRICS_GAP_BINS - 1;
+		metrics->gap_hist[bin]++;
+	}
+	metrics->last_group = now;
+
+	if (!metrics->pi_time && (handle->valid_fields & V4L2_RDS_PI))
+		metrics->pi_time = now;
+	if (!metrics->ps_time && (handle->valid_fields & V4L2_RDS_PS))
+		metrics->ps_time = now;
+	if (!metrics->rt_time && (handle->valid_fields & V4L2_RDS_RT))
+		metrics->rt_time = now;
+}
+
+void rds_metrics_get(const struct rds_metrics *metrics,
+		struct v4l2_rds_metrics *out)
+{
+	uint32_t now = rds_metrics_second(metrics->blocks);
+	/* the window is made of the current, partial second and the
+	 * preceding full seconds */
+	uint32_t first = now >= V4L2_RDS_METRICS_WINDOW - 1 ?
+		now - (V4L2_RDS_METRICS_WINDOW - 1) : 0;
+	uint32_t group_cnt[16] = { 0 };
+
+	memset(out, 0, sizeof(*out));
+	out->time = rds_metrics_ms(metrics->blocks);
+	out->window = out->time - first * 1000;
+	for (int i = 0; i < V4L2_RDS_METRICS_WINDOW; i++) {
+		const struct rds_metrics_bucket *bucket = &metrics->bucket[i];
+
+		if (!bucket->blocks || bucket->second < first ||
+		    bucket->second > now)
+			continue;
+		out->window_blocks += bucket->blocks;
+		out->window_block_errors += bucket->block_errors;
+		out->window_block_corrected += bucket->block_corrected;
+		for (int j = 0; j < 16; j++)
+			group_cnt[j] += bucket->group_cnt[j];
+	}
+	if (out->window_blocks)
+		out->block_error_rate =
+			(float)out->window_block_errors / out->window_blocks;
+	if (out->window)
+		for (int j = 0; j < 16; j++)
+			out->group_rate[j] = group_cnt[j] * 1000.0f / out->window;
+
+	out->time_to_pi = rds_metrics_ms(metrics->pi_time);
+	out->time_to_ps = rds_metrics_ms(metrics->ps_time);
+	out->time_to_rt = rds_metrics_ms(metrics->rt_time);
+	memcpy(out->gap_hist, metrics->gap_hist, sizeof(out->gap_hist));
+}
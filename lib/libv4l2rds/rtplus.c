@@ -0,0 +1,142 @@
+/*
+ * Radio Text Plus (RT+) decoding
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335  USA
+ */
+
+#include <string.h>
+#include <config.h>
+
+#include "libv4l2rds-priv.h"
+
+/* remembers a tag of a received RT+ group until its RT chars are there */
+static void rds_rtplus_add_pending(struct rds_rtplus *rtplus, uint8_t content_type,
+		uint8_t start, uint8_t len)
+{
+	struct rds_rtplus_pending *p = rtplus->pending;
+	int i;
+
+	/* content type 0 marks unused tags */
+	if (!content_type || start + len > 64)
+		return;
+	for (i = 0; i < rtplus->pending_cnt; i++)
+		if (p[i].content_type == content_type)
+			break;
+	if (i == V4L2_RDS_RTPLUS_MAX_TAGS)
+		return;
+	if (i == rtplus->pending_cnt)
+		rtplus->pending_cnt++;
+	p[i].content_type = content_type;
+	p[i].start = start;
+	p[i].len = len;
+}
+
+/* stores a complete tag
+ * @return:	true if the tag is new or changed */
+static bool rds_rtplus_set_tag(struct rds_rtplus *rtplus, struct v4l2_rds *handle,
+		const struct rds_rtplus_pending *p, const uint8_t *text)
+{
+	struct v4l2_rds_rtplus *info = &rtplus->info;
+	struct v4l2_rds_rtplus_tag *tag;
+	struct v4l2_rds_event *ev;
+	int i;
+
+	for (i = 0; i < info->size; i++)
+		if (info->tag[i].content_type == p->content_type)
+			break;
+	tag = &info->tag[i];
+	if (i < info->size) {
+		if (tag->start == p->start && tag->len == p->len &&
+		    !memcmp(tag->text, text, p->len))
+			return false;
+	} else if (info->size < V4L2_RDS_RTPLUS_MAX_TAGS) {
+		info->size++;
+	} else {
+		return false;
+	}
+	tag->content_type = p->content_type;
+	tag->start = p->start;
+	tag->len = p->len;
+	memcpy(tag->text, text, p->len);
+	tag->text[p->len] = '\0';
+
+	if ((ev = rds_add_event(handle, V4L2_RDS_EVENT_RTPLUS))) {
+		ev->value = p->content_type;
+		ev->pos = p->start;
+		ev->len = p->len < sizeof(ev->data) ? p->len : sizeof(ev->data);
+		memcpy(ev->data, text, ev->len);
+	}
+	return true;
+}
+
+uint32_t rds_rtplus_update(struct rds_rtplus *rtplus, struct v4l2_rds *handle)
+{
+	uint32_t updated_fields = 0;
+	int i = 0;
+
+	while (i < rtplus->pending_cnt) {
+		struct rds_rtplus_pending *p = &rtplus->pending[i];
+		const uint8_t *text = rds_get_rt_chars(handle, p->start, p->len);
+
+		if (!text) {
+			i++;
+			continue;
+		}
+		if (rds_rtplus_set_tag(rtplus, handle, p, text)) {
+			handle->valid_fields |= V4L2_RDS_RTPLUS;
+			updated_fields |= V4L2_RDS_RTPLUS;
+		}
+		*p = rtplus->pending[--rtplus->pending_cnt];
+	}
+	return updated_fields;
+}
+
+uint32_t rds_rtplus_decode(struct v4l2_rds *handle,
+		const struct v4l2_rds_group *grp, void *priv)
+{
+	struct rds_rtplus *rtplus = priv;
+	uint16_t c = (grp->data_c_msb << 8) | grp->data_c_lsb;
+	uint16_t d = (grp->data_d_msb << 8) | grp->data_d_lsb;
+	/* bit 4 of block B: item toggle, bit 3: item running */
+	bool toggle = grp->data_b_lsb & 0x10;
+	bool running = grp->data_b_lsb & 0x08;
+	uint32_t updated_fields = 0;
+
+	if (grp->group_version != 'A')
+		return 0;
+
+	/* a new item started, or no item is running: drop the old tags */
+	if (rtplus->valid && (toggle != rtplus->info.item_toggle || !running) &&
+	    (rtplus->info.size || rtplus->pending_cnt)) {
+		rtplus->info.size = 0;
+		rtplus->pending_cnt = 0;
+		updated_fields |= V4L2_RDS_RTPLUS;
+	}
+	rtplus->valid = true;
+	rtplus->info.item_toggle = toggle;
+	rtplus->info.item_running = running;
+	if (!running)
+		return updated_fields;
+
+	/* two tags: content type (6 bits), start marker (6 bits) and length
+	 * marker (6 bits for the first, 5 bits for the second tag), spread
+	 * over bits 0-2 of block B and blocks C and D. The length marker is
+	 * the length - 1 */
+	rds_rtplus_add_pending(rtplus, ((grp->data_b_lsb & 0x07) << 3) | (c >> 13),
+			(c >> 7) & 0x3f, ((c >> 1) & 0x3f) + 1);
+	rds_rtplus_add_pending(rtplus, ((c & 0x01) << 5) | (d >> 11),
+			(d >> 5) & 0x3f, (d & 0x1f) + 1);
+	return updated_fields | rds_rtplus_update(rtplus, handle);
+}
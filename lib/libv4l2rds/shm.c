@@ -0,0 +1,363 @@
+/*
+ * Publication of the RDS state in POSIX shared memory
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335  USA
+ */
+
+#include <errno.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <config.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+
+#include <linux/videodev2.h>
+
+#include "libv4l2rds-priv.h"
+
+#define RDS_SHM_MAGIC		"V4L2RDSM"
+#define RDS_SHM_VERSION		1
+#define RDS_SHM_MAX_GROUPS	(1 << 20)
+
+/* segment layout:
+ * header | state[2] | group ring
+ * The state is double buffered like the snapshots of a handle: state n
+ * is written to state[n & 1], state_start is set to n before writing it,
+ * state_done once it is complete. Group n is written to ring[n % slots]
+ * before group_cnt is set to n + 1. The counters are kept in their own
+ * cache line, apart from the constant part of the header */
+struct rds_shm_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t state_size;		/* sizeof(struct v4l2_rds) */
+	uint32_t group_size;		/* sizeof(struct v4l2_rds_group) */
+	uint32_t group_slots;		/* size of the ring, a power of 2 */
+	uint64_t state_offset;
+	uint64_t ring_offset;
+	uint32_t closed;		/* the publisher closed the segment */
+	uint32_t reserved;
+
+	uint32_t state_start __attribute__ ((aligned(64)));
+	uint32_t state_done;
+	uint32_t group_cnt;		/* groups written since the creation */
+};
+
+struct v4l2_rds_shm {
+	char *name;			/* segment name, publisher only */
+	int fd;				/* locked segment, publisher only */
+	struct rds_shm_header *hdr;
+	size_t map_size;
+	struct v4l2_rds *state;
+	struct v4l2_rds_group *ring;
+	uint32_t group_mask;		/* group_slots - 1 */
+};
+
+static void rds_shm_free(struct v4l2_rds_shm *shm)
+{
+	if (shm->hdr)
+		munmap(shm->hdr, shm->map_size);
+	if (shm->fd >= 0)
+		close(shm->fd);
+	free(shm->name);
+	free(shm);
+}
+
+/* sets the pointers into the mapped segment */
+static void rds_shm_map(struct v4l2_rds_shm *shm)
+{
+	shm->state = (struct v4l2_rds *)((char *)shm->hdr + shm->hdr->state_offset);
+	shm->ring = (struct v4l2_rds_group *)((char *)shm->hdr + shm->hdr->ring_offset);
+	shm->group_mask = shm->hdr->group_slots - 1;
+}
+
+/* creates the segment name and locks it, the lock is held as long as the
+ * publisher keeps the segment open. An existing segment is only removed
+ * when nobody holds its lock, i.e. its publisher closed it or died */
+static int rds_shm_create_locked(const char *name)
+{
+	struct stat st, st_name;
+	int fd, fd_name;
+
+	for (int tries = 0; tries < 4; tries++) {
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+		if (fd >= 0) {
+			if (!flock(fd, LOCK_EX | LOCK_NB))
+				return fd;
+			/* removed as stale by another publisher before we
+			 * could lock it, which now owns the name */
+			close(fd);
+			errno = EEXIST;
+			return -1;
+		}
+		if (errno != EEXIST)
+			return -1;
+
+		fd = shm_open(name, O_RDWR, 0);
+		if (fd < 0) {
+			if (errno == ENOENT)
+				continue;
+			return -1;
+		}
+		if (flock(fd, LOCK_EX | LOCK_NB)) {
+			/* in use by a live publisher */
+			if (errno == EWOULDBLOCK)
+				errno = EEXIST;
+			close(fd);
+			return -1;
+		}
+		/* the name may have been given to a new segment by another
+		 * publisher since we opened it, only remove our segment */
+		fd_name = shm_open(name, O_RDONLY, 0);
+		if (fd_name >= 0) {
+			if (!fstat(fd, &st) && !fstat(fd_name, &st_name) &&
+			    st.st_dev == st_name.st_dev &&
+			    st.st_ino == st_name.st_ino)
+				shm_unlink(name);
+			close(fd_name);
+		}
+		close(fd);
+	}
+	errno = EEXIST;
+	return -1;
+}
+
+struct v4l2_rds_shm *v4l2_rds_shm_create(const char *name, unsigned group_slots)
+{
+	struct v4l2_rds_shm *shm;
+	struct rds_shm_header *hdr;
+	uint32_t slots = 1;
+	int saved_err;
+
+	if (!group_slots || group_slots > RDS_SHM_MAX_GROUPS) {
+		errno = EINVAL;
+		return NULL;
+	}
+	/* positions in the ring wrap around at 2^32 */
+	while (slots < group_slots)
+		slots *= 2;
+
+	shm = calloc(1, sizeof(*shm));
+	if (!shm)
+		return NULL;
+	shm->fd = -1;
+	shm->name = strdup(name);
+	if (!shm->name)
+		goto error;
+	shm->map_size = sizeof(*hdr) + 2 * sizeof(struct v4l2_rds) +
+		slots * sizeof(struct v4l2_rds_group);
+
+	shm->fd = rds_shm_create_locked(name);
+	if (shm->fd < 0 || ftruncate(shm->fd, shm->map_size))
+		goto error;
+	hdr = mmap(NULL, shm->map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		   shm->fd, 0);
+	if (hdr == MAP_FAILED)
+		goto error;
+
+	shm->hdr = hdr;
+	hdr->version = RDS_SHM_VERSION;
+	hdr->state_size = sizeof(struct v4l2_rds);
+	hdr->group_size = sizeof(struct v4l2_rds_group);
+	hdr->group_slots = slots;
+	hdr->state_offset = sizeof(*hdr);
+	hdr->ring_offset = sizeof(*hdr) + 2 * sizeof(struct v4l2_rds);
+	rds_shm_map(shm);
+	/* subscribers only accept the segment once the header is complete */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(hdr->magic, RDS_SHM_MAGIC, sizeof(hdr->magic));
+	return shm;
+
+error:
+	saved_err = errno;
+	if (shm->fd >= 0)
+		shm_unlink(name);
+	rds_shm_free(shm);
+	errno = saved_err;
+	return NULL;
+}
+
+struct v4l2_rds_shm *v4l2_rds_shm_open(const char *name)
+{
+	struct v4l2_rds_shm *shm = calloc(1, sizeof(*shm));
+	const struct rds_shm_header *hdr;
+	struct stat st;
+	int saved_err;
+	int fd;
+
+	if (!shm)
+		return NULL;
+	shm->fd = -1;
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0 || fstat(fd, &st) < 0)
+		goto error;
+	if ((uint64_t)st.st_size < sizeof(*hdr)) {
+		errno = EAGAIN;
+		goto error;
+	}
+	shm->map_size = st.st_size;
+	shm->hdr = mmap(NULL, shm->map_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (shm->hdr == MAP_FAILED) {
+		shm->hdr = NULL;
+		goto error;
+	}
+	close(fd);
+	fd = -1;
+
+	hdr = shm->hdr;
+	if (memcmp(hdr->magic, RDS_SHM_MAGIC, sizeof(hdr->magic))) {
+		/* the publisher is still setting up the segment */
+		errno = EAGAIN;
+		goto error;
+	}
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (hdr->version != RDS_SHM_VERSION ||
+	    hdr->state_size != sizeof(struct v4l2_rds) ||
+	    hdr->group_size != sizeof(struct v4l2_rds_group) ||
+	    !hdr->group_slots || (hdr->group_slots & (hdr->group_slots - 1)) ||
+	    hdr->ring_offset + (uint64_t)hdr->group_slots * hdr->group_size >
+	    shm->map_size ||
+	    hdr->state_offset + 2 * sizeof(struct v4l2_rds) > hdr->ring_offset) {
+		errno = EINVAL;
+		goto error;
+	}
+	rds_shm_map(shm);
+	return shm;
+
+error:
+	saved_err = errno;
+	if (fd >= 0)
+		close(fd);
+	rds_shm_free(shm);
+	errno = saved_err;
+	return NULL;
+}
+
+int v4l2_rds_shm_close(struct v4l2_rds_shm *shm)
+{
+	int ret = 0;
+
+	if (shm->name) {
+		__atomic_store_n(&shm->hdr->closed, 1, __ATOMIC_RELEASE);
+		ret = shm_unlink(shm->name);
+	}
+	if (ret) {
+		int saved_err = errno;
+
+		rds_shm_free(shm);
+		errno = saved_err;
+		return ret;
+	}
+	rds_shm_free(shm);
+	return 0;
+}
+
+void rds_shm_publish(struct v4l2_rds_shm *shm, const struct v4l2_rds *handle)
+{
+	struct rds_shm_header *hdr = shm->hdr;
+	/* only the publisher writes to the counters */
+	uint32_t seq = hdr->state_done + 1;
+
+	__atomic_store_n(&hdr->state_start, seq, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(&shm->state[seq & 1], handle, sizeof(*handle));
+	__atomic_store_n(&hdr->state_done, seq, __ATOMIC_RELEASE);
+}
+
+void rds_shm_add_group(struct v4l2_rds_shm *shm, const struct v4l2_rds_group *grp)
+{
+	struct rds_shm_header *hdr = shm->hdr;
+	uint32_t cnt = hdr->group_cnt;
+
+	shm->ring[cnt & shm->group_mask] = *grp;
+	__atomic_store_n(&hdr->group_cnt, cnt + 1, __ATOMIC_RELEASE);
+}
+
+const struct v4l2_rds *v4l2_rds_shm_state_begin(const struct v4l2_rds_shm *shm,
+		uint32_t *seq)
+{
+	*seq = __atomic_load_n(&shm->hdr->state_done, __ATOMIC_ACQUIRE);
+	return &shm->state[*seq & 1];
+}
+
+bool v4l2_rds_shm_state_retry(const struct v4l2_rds_shm *shm, uint32_t seq)
+{
+	/* the reads of the state must be complete before start is read */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&shm->hdr->state_start, __ATOMIC_RELAXED) - seq > 1;
+}
+
+uint32_t v4l2_rds_shm_get_state(const struct v4l2_rds_shm *shm,
+		struct v4l2_rds *state)
+{
+	const struct v4l2_rds *s;
+	uint32_t seq;
+
+	do {
+		s = v4l2_rds_shm_state_begin(shm, &seq);
+		memcpy(state, s, sizeof(*state));
+	} while (v4l2_rds_shm_state_retry(shm, seq));
+	return seq;
+}
+
+uint32_t v4l2_rds_shm_get_group_pos(const struct v4l2_rds_shm *shm)
+{
+	return __atomic_load_n(&shm->hdr->group_cnt, __ATOMIC_ACQUIRE);
+}
+
+unsigned v4l2_rds_shm_get_groups(const struct v4l2_rds_shm *shm, uint32_t *pos,
+		struct v4l2_rds_group *groups, unsigned n, uint32_t *lost)
+{
+	uint32_t slots = shm->group_mask + 1;
+	uint32_t cnt = __atomic_load_n(&shm->hdr->group_cnt, __ATOMIC_ACQUIRE);
+	uint32_t avail = cnt - *pos;
+	uint32_t overwritten;
+
+	if (avail > slots) {
+		*lost += avail - slots;
+		*pos = cnt - slots;
+		avail = slots;
+	}
+	if (avail > n)
+		avail = n;
+	for (uint32_t i = 0; i < avail; i++)
+		groups[i] = shm->ring[(*pos + i) & shm->group_mask];
+
+	/* group n + slots overwrites group n, and the publisher starts writing
+	 * it once group_cnt reached n + slots. Copies of the groups before
+	 * group_cnt + 1 - slots may be torn */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	cnt = __atomic_load_n(&shm->hdr->group_cnt, __ATOMIC_RELAXED);
+	overwritten = cnt + 1 - slots - *pos;
+	if ((int32_t)overwritten > 0) {
+		if (overwritten > avail)
+			overwritten = avail;
+		memmove(groups, groups + overwritten,
+			(avail - overwritten) * sizeof(*groups));
+		*lost += overwritten;
+		*pos += overwritten;
+		avail -= overwritten;
+	}
+	*pos += avail;
+	return avail;
+}
+
+bool v4l2_rds_shm_is_closed(const struct v4l2_rds_shm *shm)
+{
+	return __atomic_load_n(&shm->hdr->closed, __ATOMIC_ACQUIRE);
+}
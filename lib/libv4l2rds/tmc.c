@@ -0,0 +1,450 @@
+/*
+ * TMC (Traffic Message Channel) decoding and message store
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335  USA
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <config.h>
+
+#include "libv4l2rds-priv.h"
+
+/* one message of the store */
+struct rds_tmc_slot {
+	struct v4l2_rds_tmc_msg msg;
+	bool used;
+};
+
+/* the message store is a hash table with linear probing, indexed by
+ * location table, location, direction and event. It is kept at most half
+ * full, so storing a received message takes a few compares */
+struct v4l2_rds_tmc {
+	struct rds_tmc_slot *slots;
+	uint32_t slot_mask;
+	uint8_t hash_shift;
+	unsigned msg_cnt;
+	unsigned max_messages;
+	time_t *scratch;	/* max_messages entries, for rds_tmc_evict() */
+	uint32_t seq;		/* sequence number of the last change */
+	time_t now;		/* clock, see v4l2_rds_tmc_expire() */
+	time_t day_start;	/* the day of now, for messages */
+	time_t day_end;		/* lasting until the end of the day */
+};
+
+/* lifetime of messages in minutes, indexed by the duration code.
+ * Messages with code 7 last until the end of the day */
+static const uint16_t rds_tmc_duration[8] = {
+	15, 15, 30, 60, 120, 180, 240, 0
+};
+
+/* length in bits of the content of each label of the free format data
+ * of multi-group messages */
+static const uint8_t rds_tmc_label_bits[16] = {
+	3, 3, 5, 5, 5, 8, 8, 8, 8, 11, 16, 16, 16, 16, 0, 0
+};
+
+#define RDS_TMC_LABEL_DURATION	0
+#define RDS_TMC_LABEL_SEPARATOR	14
+
+static inline uint32_t rds_tmc_hash(const struct v4l2_rds_tmc *tmc,
+		const struct v4l2_rds_tmc_msg *msg)
+{
+	uint32_t key = msg->location ^ ((uint32_t)msg->event << 16) ^
+		((uint32_t)((msg->ltn << 1) | (msg->flags & V4L2_RDS_TMC_NEGATIVE)) << 27);
+
+	return (key * 2654435761u) >> tmc->hash_shift;
+}
+
+static inline bool rds_tmc_same_key(const struct v4l2_rds_tmc_msg *a,
+		const struct v4l2_rds_tmc_msg *b)
+{
+	return a->location == b->location && a->event == b->event &&
+		a->ltn == b->ltn && !((a->flags ^ b->flags) & V4L2_RDS_TMC_NEGATIVE);
+}
+
+static inline bool rds_tmc_same_content(const struct v4l2_rds_tmc_msg *a,
+		const struct v4l2_rds_tmc_msg *b)
+{
+	return a->extent == b->extent && a->flags == b->flags &&
+		a->duration == b->duration && a->data_bits == b->data_bits &&
+		!memcmp(a->data, b->data, (a->data_bits + 7) / 8);
+}
+
+/* removes the message in slot i, moving later messages of the same probe
+ * sequence back so that lookups don't stop early */
+static void rds_tmc_remove(struct v4l2_rds_tmc *tmc, uint32_t i)
+{
+	uint32_t j = i;
+
+	for (;;) {
+		uint32_t home;
+
+		j = (j + 1) & tmc->slot_mask;
+		if (!tmc->slots[j].used)
+			break;
+		home = rds_tmc_hash(tmc, &tmc->slots[j].msg);
+		/* the message in j can fill the gap in i if its home slot
+		 * is not cyclically in (i, j] */
+		if (((j - home) & tmc->slot_mask) < ((j - i) & tmc->slot_mask))
+			continue;
+		tmc->slots[i] = tmc->slots[j];
+		i = j;
+	}
+	tmc->slots[i].used = false;
+	tmc->msg_cnt--;
+}
+
+/* returns the k-th smallest (counting from 0) of the n times in t,
+ * reordering t */
+static time_t rds_tmc_select(time_t *t, unsigned n, unsigned k)
+{
+	unsigned lo = 0, hi = n - 1;
+
+	while (lo < hi) {
+		time_t pivot = t[lo + (hi - lo) / 2];
+		unsigned i = lo, j = hi;
+
+		while (i <= j) {
+			while (t[i] < pivot)
+				i++;
+			while (t[j] > pivot)
+				j--;
+			if (i <= j) {
+				time_t tmp = t[i];
+
+				t[i++] = t[j];
+				t[j--] = tmp;
+			}
+		}
+		if (k <= j)
+			hi = j;
+		else if (k >= i)
+			lo = i;
+		else
+			break;
+	}
+	return t[k];
+}
+
+/* makes room in a full store by dropping the messages that expire first.
+ * A sixteenth of the store is dropped at once, so that the scan of the
+ * whole store is spread over many received messages */
+static void rds_tmc_evict(struct v4l2_rds_tmc *tmc)
+{
+	unsigned cnt = tmc->max_messages / 16 + 1;
+	unsigned n = 0;
+	unsigned ties;
+	time_t cutoff;
+	uint32_t i = 0;
+
+	for (uint32_t j = 0; j <= tmc->slot_mask; j++)
+		if (tmc->slots[j].used)
+			tmc->scratch[n++] = tmc->slots[j].msg.expires;
+	if (cnt > n)
+		cnt = n;
+	cutoff = rds_tmc_select(tmc->scratch, n, cnt - 1);
+	/* drop all messages expiring before cutoff, and as many expiring
+	 * at cutoff as needed to drop cnt messages */
+	ties = cnt;
+	for (unsigned j = 0; j < n; j++)
+		if (tmc->scratch[j] < cutoff)
+			ties--;
+	while (i <= tmc->slot_mask) {
+		struct rds_tmc_slot *slot = &tmc->slots[i];
+
+		if (slot->used && (slot->msg.expires < cutoff ||
+		    (slot->msg.expires == cutoff && ties && ties--))) {
+			rds_tmc_remove(tmc, i);
+			continue;
+		}
+		i++;
+	}
+}
+
+/* returns the time a message received now with the given duration code
+ * expires */
+static time_t rds_tmc_expiry(struct v4l2_rds_tmc *tmc, uint8_t duration)
+{
+	if (rds_tmc_duration[duration])
+		return tmc->now + rds_tmc_duration[duration] * 60;
+
+	if (tmc->now < tmc->day_start || tmc->now >= tmc->day_end) {
+		struct tm tm;
+
+		localtime_r(&tmc->now, &tm);
+		tm.tm_sec = tm.tm_min = tm.tm_hour = 0;
+		tm.tm_isdst = -1;
+		tmc->day_start = mktime(&tm);
+		tm.tm_mday++;
+		tm.tm_isdst = -1;
+		tmc->day_end = mktime(&tm);
+	}
+	return tmc->day_end;
+}
+
+/* stores a received message
+ * @return:	sequence number of the message if it is new or changed,
+ *		0 for repetitions of a stored message */
+static uint32_t rds_tmc_store(struct v4l2_rds_tmc *tmc, struct v4l2_rds_tmc_msg *msg)
+{
+	struct rds_tmc_slot *slot;
+	uint32_t i;
+
+	msg->received = tmc->now;
+	msg->expires = rds_tmc_expiry(tmc, msg->duration);
+
+	for (i = rds_tmc_hash(tmc, msg); tmc->slots[i].used;
+			i = (i + 1) & tmc->slot_mask) {
+		slot = &tmc->slots[i];
+		if (!rds_tmc_same_key(&slot->msg, msg))
+			continue;
+		if (rds_tmc_same_content(&slot->msg, msg)) {
+			slot->msg.pi = msg->pi;
+			slot->msg.received = msg->received;
+			slot->msg.expires = msg->expires;
+			return 0;
+		}
+		msg->seq = ++tmc->seq;
+		slot->msg = *msg;
+		return msg->seq;
+	}
+
+	if (tmc->msg_cnt >= tmc->max_messages) {
+		rds_tmc_evict(tmc);
+		for (i = rds_tmc_hash(tmc, msg); tmc->slots[i].used;
+				i = (i + 1) & tmc->slot_mask)
+			;
+	}
+	msg->seq = ++tmc->seq;
+	tmc->slots[i].msg = *msg;
+	tmc->slots[i].used = true;
+	tmc->msg_cnt++;
+	return msg->seq;
+}
+
+/* fills in the fields of a message that are common to single groups and
+ * the first group of multi-group messages */
+static void rds_tmc_init_msg(const struct rds_tmc_decoder *dec,
+		struct v4l2_rds_tmc_msg *msg, uint16_t pi, uint16_t c, uint16_t d)
+{
+	memset(msg, 0, sizeof(*msg));
+	msg->pi = pi;
+	msg->ltn = dec->ltn;
+	/* block C: bit 14 direction, bits 11-13 extent, bits 0-10 event,
+	 * block D: location */
+	if (c & 0x4000)
+		msg->flags |= V4L2_RDS_TMC_NEGATIVE;
+	msg->extent = (c >> 11) & 0x07;
+	msg->event = c & 0x7ff;
+	msg->location = d;
+}
+
+/* appends bit_cnt bits (most significant bit first) to the free format
+ * data of a message */
+static void rds_tmc_add_bits(struct v4l2_rds_tmc_msg *msg, uint32_t bits,
+		uint8_t bit_cnt)
+{
+	while (bit_cnt--) {
+		uint8_t pos = msg->data_bits++;
+
+		if (bits & (1u << bit_cnt))
+			msg->data[pos >> 3] |= 0x80 >> (pos & 7);
+	}
+}
+
+static uint32_t rds_tmc_get_bits(const struct v4l2_rds_tmc_msg *msg,
+		uint8_t pos, uint8_t bit_cnt)
+{
+	uint32_t bits = 0;
+
+	for (; bit_cnt; bit_cnt--, pos++)
+		bits = (bits << 1) | ((msg->data[pos >> 3] >> (7 - (pos & 7))) & 1);
+	return bits;
+}
+
+/* looks for the duration of the (first) event of a multi-group message
+ * in its free format data, messages without it keep duration code 0 */
+static void rds_tmc_parse_free_format(struct v4l2_rds_tmc_msg *msg)
+{
+	uint8_t pos = 0;
+
+	while (pos + 4 <= msg->data_bits) {
+		uint8_t label = rds_tmc_get_bits(msg, pos, 4);
+		uint8_t len = rds_tmc_label_bits[label];
+
+		pos += 4;
+		if (label == RDS_TMC_LABEL_SEPARATOR || pos + len > msg->data_bits)
+			break;
+		if (label == RDS_TMC_LABEL_DURATION) {
+			msg->duration = rds_tmc_get_bits(msg, pos, len);
+			break;
+		}
+		pos += len;
+	}
+}
+
+void rds_tmc_decode_announcement(struct rds_tmc_decoder *dec, uint16_t msg)
+{
+	/* variant 0 carries the location table number in bits 6-11 */
+	if (!(msg >> 14))
+		dec->ltn = (msg >> 6) & 0x3f;
+}
+
+uint32_t rds_tmc_decode_group(struct rds_tmc_decoder *dec,
+		const struct v4l2_rds_group *grp)
+{
+	uint8_t b = grp->data_b_lsb & 0x1f;
+	uint16_t c = (grp->data_c_msb << 8) | grp->data_c_lsb;
+	uint16_t d = (grp->data_d_msb << 8) | grp->data_d_lsb;
+	struct rds_tmc_assembly *as;
+	struct v4l2_rds_tmc_msg msg;
+	uint8_t gsi;
+
+	if (!dec->store)
+		return 0;
+	if (dec->last_valid && dec->last_b == b && dec->last_c == c &&
+	    dec->last_d == d)
+		return 0;
+	dec->last_valid = true;
+	dec->last_b = b;
+	dec->last_c = c;
+	dec->last_d = d;
+
+	/* bit 4 of block B: tuning information, which is not decoded */
+	if (b & 0x10)
+		return 0;
+
+	/* bit 3 of block B: single group message, with the duration code
+	 * in bits 0-2 and the diversion advice in bit 15 of block C */
+	if (b & 0x08) {
+		rds_tmc_init_msg(dec, &msg, grp->pi, c, d);
+		msg.duration = b & 0x07;
+		if (c & 0x8000)
+			msg.flags |= V4L2_RDS_TMC_DIVERSION;
+		return rds_tmc_store(dec->store, &msg);
+	}
+
+	/* multi-group message, bits 0-2 of block B: continuity index */
+	as = &dec->assembly[b & 0x07];
+	if (c & 0x8000) {
+		/* first group, same layout as a single group */
+		rds_tmc_init_msg(dec, &as->msg, grp->pi, c, d);
+		as->msg.flags |= V4L2_RDS_TMC_MULTI_GROUP;
+		as->active = true;
+		as->second = true;
+		return 0;
+	}
+	if (!as->active)
+		return 0;
+
+	/* subsequent groups: bit 14 of block C marks the second group,
+	 * bits 12-13 count down the remaining groups, the other 28 bits
+	 * carry free format data */
+	gsi = (c >> 12) & 0x03;
+	if (!!(c & 0x4000) != as->second || (!as->second && gsi != as->next_gsi)) {
+		/* a group was lost */
+		as->active = false;
+		return 0;
+	}
+	rds_tmc_add_bits(&as->msg, ((uint32_t)(c & 0x0fff) << 16) | d, 28);
+	if (gsi) {
+		as->second = false;
+		as->next_gsi = gsi - 1;
+		return 0;
+	}
+	as->active = false;
+	msg = as->msg;
+	rds_tmc_parse_free_format(&msg);
+	return rds_tmc_store(dec->store, &msg);
+}
+
+struct v4l2_rds_tmc *v4l2_rds_tmc_create(unsigned max_messages)
+{
+	struct v4l2_rds_tmc *tmc;
+	uint32_t slot_cnt = 16;
+	uint8_t bits = 4;
+
+	if (!max_messages || max_messages > 65535) {
+		errno = EINVAL;
+		return NULL;
+	}
+	while (slot_cnt < 2 * max_messages) {
+		slot_cnt *= 2;
+		bits++;
+	}
+	tmc = calloc(1, sizeof(*tmc));
+	if (!tmc)
+		return NULL;
+	tmc->slots = calloc(slot_cnt, sizeof(*tmc->slots));
+	tmc->scratch = malloc(max_messages * sizeof(*tmc->scratch));
+	if (!tmc->slots || !tmc->scratch) {
+		free(tmc->slots);
+		free(tmc->scratch);
+		free(tmc);
+		return NULL;
+	}
+	tmc->hash_shift = 32 - bits;
+	tmc->slot_mask = slot_cnt - 1;
+	tmc->max_messages = max_messages;
+	tmc->now = time(NULL);
+	return tmc;
+}
+
+void v4l2_rds_tmc_destroy(struct v4l2_rds_tmc *tmc)
+{
+	if (tmc) {
+		free(tmc->slots);
+		free(tmc->scratch);
+		free(tmc);
+	}
+}
+
+unsigned v4l2_rds_tmc_expire(struct v4l2_rds_tmc *tmc, time_t now)
+{
+	unsigned removed = 0;
+	uint32_t i = 0;
+
+	tmc->now = now;
+	/* removing a message can move a later one into slot i,
+	 * so i is only advanced if slot i is kept */
+	while (i <= tmc->slot_mask) {
+		if (tmc->slots[i].used && tmc->slots[i].msg.expires <= now) {
+			rds_tmc_remove(tmc, i);
+			removed++;
+			continue;
+		}
+		i++;
+	}
+	return removed;
+}
+
+uint32_t v4l2_rds_tmc_get_seq(const struct v4l2_rds_tmc *tmc)
+{
+	return tmc->seq;
+}
+
+unsigned v4l2_rds_tmc_get_messages(const struct v4l2_rds_tmc *tmc,
+		uint32_t since, struct v4l2_rds_tmc_msg *msgs, unsigned max)
+{
+	unsigned cnt = 0;
+
+	for (uint32_t i = 0; i <= tmc->slot_mask && cnt < max; i++)
+		if (tmc->slots[i].used && tmc->slots[i].msg.seq > since)
+			msgs[cnt++] = tmc->slots[i].msg;
+	return cnt;
+}
@@ -164,16 +164,30 @@ static void v4lconvert_border_bayer_line_to_bgr24(
 
 /* From libdc1394, which on turn was based on OpenCV's Bayer decoding */
 static void bayer_to_rgbbgr24(const unsigned char *bayer,
-		unsigned char *bgr, int width, int height, const unsigned int stride, unsigned int pixfmt,
-		int start_with_green, int blue_line)
+		unsigned char *bgr, int width, int height, const unsigned int stride,
+		int dest_stride, unsigned int pixfmt,
+		int start_with_green, int blue_line, int first, int last)
 {
-	/* render the first line */
-	v4lconvert_border_bayer_line_to_bgr24(bayer, bayer + stride, bgr, width,
-			start_with_green, blue_line);
-	bgr += width * 3;
+	int y = first, end = last < height - 1 ? last : height - 1;
 
-	/* reduce height by 2 because of the special case top/bottom line */
-	for (height -= 2; height; height--) {
+	if (first == 0) {
+		/* render the first line */
+		v4lconvert_border_bayer_line_to_bgr24(bayer, bayer + stride, bgr, width,
+				start_with_green, blue_line);
+		y = 1;
+	}
+	bgr += y * dest_stride;
+
+	/* line y is interpolated from lines y - 1 to y + 1, the flags are as
+	   passed in for line 1 and swap every line */
+	bayer += (y - 1) * stride;
+	if ((y - 1) & 1) {
+		blue_line = !blue_line;
+		start_with_green = !start_with_green;
+	}
+
+	/* stop before the special case bottom line */
+	for (; y < end; y++) {
 		int t0, t1;
 		/* (width - 2) because of the border */
 		const unsigned char *bayer_end = bayer + (width - 2);
@@ -300,34 +314,52 @@ static void bayer_to_rgbbgr24(const unsigned char *bayer,
 
 		/* skip 2 border pixels and padding */
 		bayer += (stride - width) + 2;
+		bgr += dest_stride - width * 3;
 
 		blue_line = !blue_line;
 		start_with_green = !start_with_green;
 	}
 
 	/* render the last line */
-	v4lconvert_border_bayer_line_to_bgr24(bayer + stride, bayer, bgr, width,
-			!start_with_green, !blue_line);
+	if (last == height)
+		v4lconvert_border_bayer_line_to_bgr24(bayer + stride, bayer, bgr, width,
+				!start_with_green, !blue_line);
 }
 
-void v4lconvert_bayer_to_rgb24(const unsigned char *bayer,
-		unsigned char *bgr, int width, int height, const unsigned int stride, unsigned int pixfmt)
+void v4lconvert_bayer_rows_to_rgb24(const unsigned char *bayer,
+		unsigned char *bgr, int width, int height, const unsigned int stride,
+		int dest_stride, unsigned int pixfmt, int first, int last)
 {
-	bayer_to_rgbbgr24(bayer, bgr, width, height, stride, pixfmt,
+	bayer_to_rgbbgr24(bayer, bgr, width, height, stride, dest_stride, pixfmt,
 			pixfmt == V4L2_PIX_FMT_SGBRG8		/* start with green */
 			|| pixfmt == V4L2_PIX_FMT_SGRBG8,
 			pixfmt != V4L2_PIX_FMT_SBGGR8		/* blue line */
-			&& pixfmt != V4L2_PIX_FMT_SGBRG8);
+			&& pixfmt != V4L2_PIX_FMT_SGBRG8, first, last);
 }
 
-void v4lconvert_bayer_to_bgr24(const unsigned char *bayer,
-		unsigned char *bgr, int width, int height, const unsigned int stride, unsigned int pixfmt)
+void v4lconvert_bayer_rows_to_bgr24(const unsigned char *bayer,
+		unsigned char *bgr, int width, int height, const unsigned int stride,
+		int dest_stride, unsigned int pixfmt, int first, int last)
 {
-	bayer_to_rgbbgr24(bayer, bgr, width, height, stride, pixfmt,
+	bayer_to_rgbbgr24(bayer, bgr, width, height, stride, dest_stride, pixfmt,
 			pixfmt == V4L2_PIX_FMT_SGBRG8		/* start with green */
 			|| pixfmt == V4L2_PIX_FMT_SGRBG8,
 			pixfmt == V4L2_PIX_FMT_SBGGR8		/* blue line */
-			|| pixfmt == V4L2_PIX_FMT_SGBRG8);
+			|| pixfmt == V4L2_PIX_FMT_SGBRG8, first, last);
+}
+
+void v4lconvert_bayer_to_rgb24(const unsigned char *bayer,
+		unsigned char *bgr, int width, int height, const unsigned int stride, unsigned int pixfmt)
+{
+	v4lconvert_bayer_rows_to_rgb24(bayer, bgr, width, height, stride,
+			width * 3, pixfmt, 0, height);
+}
+
+void v4lconvert_bayer_to_bgr24(const unsigned char *bayer,
+		unsigned char *bgr, int width, int height, const unsigned int stride, unsigned int pixfmt)
+{
+	v4lconvert_bayer_rows_to_bgr24(bayer, bgr, width, height, stride,
+			width * 3, pixfmt, 0, height);
 }
 
 static void v4lconvert_border_bayer_line_to_y(
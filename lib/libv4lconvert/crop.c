@@ -43,6 +43,7 @@ static void v4lconvert_reduceandcrop_rgbbgr24(
 			mysrc += 3; /* skip one pixel */
 		}
 		src += 2 * src_fmt->fmt.pix.bytesperline; /* skip one line */
+		dest += dest_fmt->fmt.pix.bytesperline - 3 * dest_fmt->fmt.pix.width;
 	}
 }
 
@@ -82,6 +83,7 @@ static void v4lconvert_reduceandcrop_yuv420(
 			mysrc2 += 2; /* skip one pixel */
 		}
 		mysrc += 2 * src_fmt->fmt.pix.bytesperline; /* skip one line */
+		dest += dest_fmt->fmt.pix.bytesperline - dest_fmt->fmt.pix.width;
 	}
 
 	/* U */
@@ -94,6 +96,7 @@ static void v4lconvert_reduceandcrop_yuv420(
 			mysrc2 += 2; /* skip one pixel */
 		}
 		mysrc += src_fmt->fmt.pix.bytesperline ; /* skip one line */
+		dest += (dest_fmt->fmt.pix.bytesperline - dest_fmt->fmt.pix.width) / 2;
 	}
 
 	/* V */
@@ -106,6 +109,7 @@ static void v4lconvert_reduceandcrop_yuv420(
 			mysrc2 += 2; /* skip one pixel */
 		}
 		mysrc += src_fmt->fmt.pix.bytesperline ; /* skip one line */
+		dest += (dest_fmt->fmt.pix.bytesperline - dest_fmt->fmt.pix.width) / 2;
 	}
 }
 
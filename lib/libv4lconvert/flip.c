@@ -24,7 +24,7 @@
 #include "libv4lconvert-priv.h"
 
 static void v4lconvert_vflip_rgbbgr24(unsigned char *src, unsigned char *dest,
-		struct v4l2_format *fmt)
+		struct v4l2_format *fmt, int dest_stride)
 {
 	int y;
 
@@ -32,12 +32,12 @@ static void v4lconvert_vflip_rgbbgr24(unsigned char *src, unsigned char *dest,
 	for (y = 0; y < fmt->fmt.pix.height; y++) {
 		src -= fmt->fmt.pix.bytesperline;
 		memcpy(dest, src, fmt->fmt.pix.width * 3);
-		dest += fmt->fmt.pix.width * 3;
+		dest += dest_stride;
 	}
 }
 
 static void v4lconvert_vflip_yuv420(unsigned char *src, unsigned char *dest,
-		struct v4l2_format *fmt)
+		struct v4l2_format *fmt, int dest_stride)
 {
 	int y;
 
@@ -46,7 +46,7 @@ static void v4lconvert_vflip_yuv420(unsigned char *src, unsigned char *dest,
 	for (y = 0; y < fmt->fmt.pix.height; y++) {
 		src -= fmt->fmt.pix.bytesperline;
 		memcpy(dest, src, fmt->fmt.pix.width);
-		dest += fmt->fmt.pix.width;
+		dest += dest_stride;
 	}
 
 	/* Now flip the U plane */
@@ -54,7 +54,7 @@ static void v4lconvert_vflip_yuv420(unsigned char *src, unsigned char *dest,
 	for (y = 0; y < fmt->fmt.pix.height / 2; y++) {
 		src -= fmt->fmt.pix.bytesperline / 2;
 		memcpy(dest, src, fmt->fmt.pix.width / 2);
-		dest += fmt->fmt.pix.width / 2;
+		dest += dest_stride / 2;
 	}
 
 	/* Last flip the V plane */
@@ -62,12 +62,12 @@ static void v4lconvert_vflip_yuv420(unsigned char *src, unsigned char *dest,
 	for (y = 0; y < fmt->fmt.pix.height / 2; y++) {
 		src -= fmt->fmt.pix.bytesperline / 2;
 		memcpy(dest, src, fmt->fmt.pix.width / 2);
-		dest += fmt->fmt.pix.width / 2;
+		dest += dest_stride / 2;
 	}
 }
 
 static void v4lconvert_hflip_rgbbgr24(unsigned char *src, unsigned char *dest,
-		struct v4l2_format *fmt)
+		struct v4l2_format *fmt, int dest_stride)
 {
 	int x, y;
 
@@ -81,125 +81,149 @@ static void v4lconvert_hflip_rgbbgr24(unsigned char *src, unsigned char *dest,
 			dest += 3;
 		}
 		src += fmt->fmt.pix.bytesperline;
+		dest += dest_stride - fmt->fmt.pix.width * 3;
 	}
 }
 
-static void v4lconvert_hflip_yuv420(unsigned char *src, unsigned char *dest,
-		struct v4l2_format *fmt)
+/* Mirrors a plane of 1 byte per pixel around its vertical axis, when
+   src_stride is negative around its horizontal axis as well */
+static void v4lconvert_hflip_plane(const unsigned char *src,
+		unsigned char *dest, int width, int height, int src_stride,
+		int dest_stride)
 {
 	int x, y;
 
-	/* First flip the Y plane */
-	for (y = 0; y < fmt->fmt.pix.height; y++) {
-		src += fmt->fmt.pix.width;
-		for (x = 0; x < fmt->fmt.pix.width; x++)
+	for (y = 0; y < height; y++) {
+		src += width;
+		for (x = 0; x < width; x++)
 			*dest++ = *--src;
-		src += fmt->fmt.pix.bytesperline;
+		src += src_stride;
+		dest += dest_stride - width;
 	}
+}
+
+static void v4lconvert_hflip_yuv420(unsigned char *src, unsigned char *dest,
+		struct v4l2_format *fmt, int dest_stride)
+{
+	int width = fmt->fmt.pix.width;
+	int height = fmt->fmt.pix.height;
+	int stride = fmt->fmt.pix.bytesperline;
+
+	/* First flip the Y plane */
+	v4lconvert_hflip_plane(src, dest, width, height, stride, dest_stride);
 
 	/* Now flip the U plane */
-	for (y = 0; y < fmt->fmt.pix.height / 2; y++) {
-		src += fmt->fmt.pix.width / 2;
-		for (x = 0; x < fmt->fmt.pix.width / 2; x++)
-			*dest++ = *--src;
-		src += fmt->fmt.pix.bytesperline / 2;
-	}
+	v4lconvert_hflip_plane(src + height * stride,
+			dest + height * dest_stride,
+			width / 2, height / 2, stride / 2, dest_stride / 2);
 
 	/* Last flip the V plane */
-	for (y = 0; y < fmt->fmt.pix.height / 2; y++) {
-		src += fmt->fmt.pix.width / 2;
-		for (x = 0; x < fmt->fmt.pix.width / 2; x++)
-			*dest++ = *--src;
-		src += fmt->fmt.pix.bytesperline / 2;
-	}
+	v4lconvert_hflip_plane(src + height * stride * 5 / 4,
+			dest + height * dest_stride * 5 / 4,
+			width / 2, height / 2, stride / 2, dest_stride / 2);
 }
 
 static void v4lconvert_rotate180_rgbbgr24(const unsigned char *src,
-		unsigned char *dst, int width, int height)
+		unsigned char *dst, struct v4l2_format *fmt, int dest_stride)
 {
-	int i;
+	int x, y;
 
-	src += 3 * width * height - 3;
+	src += (fmt->fmt.pix.height - 1) * fmt->fmt.pix.bytesperline +
+		3 * fmt->fmt.pix.width - 3;
 
-	for (i = 0; i < width * height; i++) {
-		dst[0] = src[0];
-		dst[1] = src[1];
-		dst[2] = src[2];
-		dst += 3;
-		src -= 3;
+	for (y = 0; y < fmt->fmt.pix.height; y++) {
+		for (x = 0; x < fmt->fmt.pix.width; x++) {
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+			dst += 3;
+			src -= 3;
+		}
+		src -= fmt->fmt.pix.bytesperline - 3 * fmt->fmt.pix.width;
+		dst += dest_stride - 3 * fmt->fmt.pix.width;
 	}
 }
 
 static void v4lconvert_rotate180_yuv420(const unsigned char *src,
-		unsigned char *dst, int width, int height)
+		unsigned char *dst, struct v4l2_format *fmt, int dest_stride)
 {
-	int i;
+	int width = fmt->fmt.pix.width;
+	int height = fmt->fmt.pix.height;
+	int stride = fmt->fmt.pix.bytesperline;
 
 	/* First flip x and y of the Y plane */
-	src += width * height - 1;
-	for (i = 0; i < width * height; i++)
-		*dst++ = *src--;
+	v4lconvert_hflip_plane(src + (height - 1) * stride, dst,
+			width, height, -stride, dest_stride);
 
 	/* Now flip the U plane */
-	src += width * height * 5 / 4;
-	for (i = 0; i < width * height / 4; i++)
-		*dst++ = *src--;
+	v4lconvert_hflip_plane(src + height * stride +
+			(height / 2 - 1) * (stride / 2),
+			dst + height * dest_stride,
+			width / 2, height / 2, -(stride / 2), dest_stride / 2);
 
 	/* Last flip the V plane */
-	src += width * height / 2;
-	for (i = 0; i < width * height / 4; i++)
-		*dst++ = *src--;
+	v4lconvert_hflip_plane(src + height * stride * 5 / 4 +
+			(height / 2 - 1) * (stride / 2),
+			dst + height * dest_stride * 5 / 4,
+			width / 2, height / 2, -(stride / 2), dest_stride / 2);
 }
 
 static void v4lconvert_rotate90_rgbbgr24(const unsigned char *src,
-		unsigned char *dst, int destwidth, int destheight)
+		unsigned char *dst, int destwidth, int destheight,
+		int src_stride, int dest_stride)
 {
 	int x, y;
-#define srcwidth destheight
 #define srcheight destwidth
 
-	for (y = 0; y < destheight; y++)
+	for (y = 0; y < destheight; y++) {
 		for (x = 0; x < destwidth; x++) {
-			int offset = ((srcheight - x - 1) * srcwidth + y) * 3;
+			int offset = (srcheight - x - 1) * src_stride + y * 3;
 			*dst++ = src[offset++];
 			*dst++ = src[offset++];
 			*dst++ = src[offset];
 		}
+		dst += dest_stride - destwidth * 3;
+	}
 }
 
-static void v4lconvert_rotate90_yuv420(const unsigned char *src,
-		unsigned char *dst, int destwidth, int destheight)
+static void v4lconvert_rotate90_plane(const unsigned char *src,
+		unsigned char *dst, int destwidth, int destheight,
+		int src_stride, int dest_stride)
 {
 	int x, y;
 
-	/* Y-plane */
-	for (y = 0; y < destheight; y++)
+	for (y = 0; y < destheight; y++) {
 		for (x = 0; x < destwidth; x++) {
-			int offset = (srcheight - x - 1) * srcwidth + y;
+			int offset = (srcheight - x - 1) * src_stride + y;
 			*dst++ = src[offset];
 		}
+		dst += dest_stride - destwidth;
+	}
+}
+
+static void v4lconvert_rotate90_yuv420(const unsigned char *src,
+		unsigned char *dst, int destwidth, int destheight,
+		int src_stride, int dest_stride)
+{
+	/* Y-plane */
+	v4lconvert_rotate90_plane(src, dst, destwidth, destheight,
+			src_stride, dest_stride);
 
 	/* U-plane */
-	src += srcwidth * srcheight;
-	destwidth /= 2;
-	destheight /= 2;
-	for (y = 0; y < destheight; y++)
-		for (x = 0; x < destwidth; x++) {
-			int offset = (srcheight - x - 1) * srcwidth + y;
-			*dst++ = src[offset];
-		}
+	v4lconvert_rotate90_plane(src + src_stride * srcheight,
+			dst + dest_stride * destheight,
+			destwidth / 2, destheight / 2,
+			src_stride / 2, dest_stride / 2);
 
 	/* V-plane */
-	src += srcwidth * srcheight;
-	for (y = 0; y < destheight; y++)
-		for (x = 0; x < destwidth; x++) {
-			int offset = (srcheight - x - 1) * srcwidth + y;
-			*dst++ = src[offset];
-		}
+	v4lconvert_rotate90_plane(src + src_stride * srcheight * 5 / 4,
+			dst + dest_stride * destheight * 5 / 4,
+			destwidth / 2, destheight / 2,
+			src_stride / 2, dest_stride / 2);
 }
 
 void v4lconvert_rotate90(unsigned char *src, unsigned char *dest,
-		struct v4l2_format *fmt)
+		struct v4l2_format *fmt, int dest_stride)
 {
 	int tmp;
 
@@ -211,57 +235,57 @@ void v4lconvert_rotate90(unsigned char *src, unsigned char *dest,
 	case V4L2_PIX_FMT_RGB24:
 	case V4L2_PIX_FMT_BGR24:
 		v4lconvert_rotate90_rgbbgr24(src, dest, fmt->fmt.pix.width,
-				fmt->fmt.pix.height);
+				fmt->fmt.pix.height, fmt->fmt.pix.bytesperline,
+				dest_stride);
 		break;
 	case V4L2_PIX_FMT_YUV420:
 	case V4L2_PIX_FMT_YVU420:
 		v4lconvert_rotate90_yuv420(src, dest, fmt->fmt.pix.width,
-				fmt->fmt.pix.height);
+				fmt->fmt.pix.height, fmt->fmt.pix.bytesperline,
+				dest_stride);
 		break;
 	}
-	v4lconvert_fixup_fmt(fmt);
+	v4lconvert_set_bytesperline(fmt, dest_stride);
 }
 
 void v4lconvert_flip(unsigned char *src, unsigned char *dest,
-		struct v4l2_format *fmt, int hflip, int vflip)
+		struct v4l2_format *fmt, int hflip, int vflip, int dest_stride)
 {
 	if (vflip && hflip) {
 		switch (fmt->fmt.pix.pixelformat) {
 		case V4L2_PIX_FMT_RGB24:
 		case V4L2_PIX_FMT_BGR24:
-			v4lconvert_rotate180_rgbbgr24(src, dest, fmt->fmt.pix.width,
-					fmt->fmt.pix.height);
+			v4lconvert_rotate180_rgbbgr24(src, dest, fmt, dest_stride);
 			break;
 		case V4L2_PIX_FMT_YUV420:
 		case V4L2_PIX_FMT_YVU420:
-			v4lconvert_rotate180_yuv420(src, dest, fmt->fmt.pix.width,
-					fmt->fmt.pix.height);
+			v4lconvert_rotate180_yuv420(src, dest, fmt, dest_stride);
 			break;
 		}
 	} else if (hflip) {
 		switch (fmt->fmt.pix.pixelformat) {
 		case V4L2_PIX_FMT_RGB24:
 		case V4L2_PIX_FMT_BGR24:
-			v4lconvert_hflip_rgbbgr24(src, dest, fmt);
+			v4lconvert_hflip_rgbbgr24(src, dest, fmt, dest_stride);
 			break;
 		case V4L2_PIX_FMT_YUV420:
 		case V4L2_PIX_FMT_YVU420:
-			v4lconvert_hflip_yuv420(src, dest, fmt);
+			v4lconvert_hflip_yuv420(src, dest, fmt, dest_stride);
 			break;
 		}
 	} else if (vflip) {
 		switch (fmt->fmt.pix.pixelformat) {
 		case V4L2_PIX_FMT_RGB24:
 		case V4L2_PIX_FMT_BGR24:
-			v4lconvert_vflip_rgbbgr24(src, dest, fmt);
+			v4lconvert_vflip_rgbbgr24(src, dest, fmt, dest_stride);
 			break;
 		case V4L2_PIX_FMT_YUV420:
 		case V4L2_PIX_FMT_YVU420:
-			v4lconvert_vflip_yuv420(src, dest, fmt);
+			v4lconvert_vflip_yuv420(src, dest, fmt, dest_stride);
 			break;
 		}
 	}
 
-	/* Our newly written data has no padding */
-	v4lconvert_fixup_fmt(fmt);
+	/* Our newly written data has dest_stride bytes per line */
+	v4lconvert_set_bytesperline(fmt, dest_stride);
 }
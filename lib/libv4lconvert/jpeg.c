@@ -322,7 +322,8 @@ int v4lconvert_decode_jpeg_libjpeg(struct v4lconvert_data *data,
 		jpeg_finish_decompress(&data->cinfo);
 #ifndef JCS_EXTENSIONS
 		if (dest_pix_fmt == V4L2_PIX_FMT_BGR24)
-			v4lconvert_swap_rgb(dest, dest, width, height);
+			v4lconvert_swap_rgb(dest, dest, width, height,
+					width * 3, width * 3);
 #endif
 	} else {
 		int h_samp, v_samp;
@@ -37,6 +37,7 @@
 
 #define V4LCONVERT_ERROR_MSG_SIZE 256
 #define V4LCONVERT_MAX_FRAMESIZES 256
+#define V4LCONVERT_MAX_THREADS 64
 
 #define V4LCONVERT_ERR(...) \
 	snprintf(data->error_msg, V4LCONVERT_ERROR_MSG_SIZE, \
@@ -70,11 +71,13 @@ struct v4lconvert_data {
 	int rotate90_buf_size;
 	int flip_buf_size;
 	int convert_pixfmt_buf_size;
+	int stride_buf_size;
 	unsigned char *convert1_buf;
 	unsigned char *convert2_buf;
 	unsigned char *rotate90_buf;
 	unsigned char *flip_buf;
 	unsigned char *convert_pixfmt_buf;
+	unsigned char *stride_buf;
 	struct v4lcontrol_data *control;
 	struct v4lprocessing_data *processing;
 	void *dev_ops_priv;
@@ -90,6 +93,10 @@ struct v4lconvert_data {
 
 	/* For cpia1 decoder */
 	unsigned char *previous_frame;
+
+	/* Extra threads for converting large frames, NULL if only the calling
+	   thread is used */
+	struct v4lconvert_threads *threads;
 };
 
 struct v4lconvert_pixfmt {
@@ -102,49 +109,107 @@ struct v4lconvert_pixfmt {
 
 void v4lconvert_fixup_fmt(struct v4l2_format *fmt);
 
+/* Sets bytesperline and sizeimage of an rgb24 / yuv420 fmt for data with
+   bytesperline bytes per line */
+void v4lconvert_set_bytesperline(struct v4l2_format *fmt,
+		unsigned int bytesperline);
+
 unsigned char *v4lconvert_alloc_buffer(int needed,
 		unsigned char **buf, int *buf_size);
 
 int v4lconvert_oom_error(struct v4lconvert_data *data);
 
+/* byte order of the packed 4:2:2 formats, for the SIMD row kernels */
+enum v4lconvert_yuv422_layout {
+	V4LCONVERT_YUYV,
+	V4LCONVERT_YVYU,
+	V4LCONVERT_UYVY,
+};
+
+/* SIMD row kernels, selected once by v4lconvert_simd_init() depending on
+   the cpu. Each one converts the longest part of a row it can handle and
+   returns the number of pixels it converted, the scalar code in rgbyuv.c
+   converts the rest of the row and is the reference for the results.
+   Unset kernels are done by the scalar code only. */
+struct v4lconvert_simd_ops {
+	int (*yuv422_to_rgb24)(const unsigned char *src, unsigned char *dest,
+			int width, enum v4lconvert_yuv422_layout layout, int bgr);
+	int (*yuv420_to_rgb24)(const unsigned char *ysrc,
+			const unsigned char *usrc, const unsigned char *vsrc,
+			unsigned char *dest, int width, int bgr);
+	/* the Y values and the U and V values averaged over two rows of a
+	   4:2:2 row, for the conversion to 4:2:0 */
+	int (*yuv422_to_y)(const unsigned char *src, unsigned char *dest,
+			int width, enum v4lconvert_yuv422_layout layout);
+	int (*yuv422_to_uv)(const unsigned char *src, const unsigned char *src1,
+			unsigned char *udest, unsigned char *vdest, int width,
+			enum v4lconvert_yuv422_layout layout);
+	int (*rgb24_to_y)(const unsigned char *src, unsigned char *dest,
+			int width, int bgr);
+};
+
+extern struct v4lconvert_simd_ops v4lconvert_simd;
+
+#define V4LCONVERT_SIMD(op, ...) \
+	(v4lconvert_simd.op ? v4lconvert_simd.op(__VA_ARGS__) : 0)
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define V4LCONVERT_SIMD_X86
+extern const struct v4lconvert_simd_ops v4lconvert_simd_sse2;
+extern const struct v4lconvert_simd_ops v4lconvert_simd_avx2;
+#endif
+
+void v4lconvert_simd_init(void);
+
+/* Worker threads, v4lconvert_threads_run() calls func once for each band
+   0 - bands-1 (at most v4lconvert_threads_max_bands()) and returns when all
+   are done, the calling thread does some of the bands itself */
+struct v4lconvert_threads;
+
+struct v4lconvert_threads *v4lconvert_threads_create(int count);
+void v4lconvert_threads_destroy(struct v4lconvert_threads *threads);
+int v4lconvert_threads_max_bands(struct v4lconvert_threads *threads);
+void v4lconvert_threads_run(struct v4lconvert_threads *threads, int bands,
+		void (*func)(void *arg, int band, int bands), void *arg);
+
 void v4lconvert_rgb24_to_yuv420(const unsigned char *src, unsigned char *dest,
-		const struct v4l2_format *src_fmt, int bgr, int yvu);
+		const struct v4l2_format *src_fmt, int dest_stride, int bgr, int yvu);
 
 void v4lconvert_yuv420_to_rgb24(const unsigned char *src, unsigned char *dst,
-		int width, int height, int yvu);
+		int width, int height, int src_stride, int dest_stride, int yvu);
 
 void v4lconvert_yuv420_to_bgr24(const unsigned char *src, unsigned char *dst,
-		int width, int height, int yvu);
+		int width, int height, int src_stride, int dest_stride, int yvu);
 
 void v4lconvert_yuyv_to_rgb24(const unsigned char *src, unsigned char *dst,
-		int width, int height, int stride);
+		int width, int height, int src_stride, int dest_stride);
 
 void v4lconvert_yuyv_to_bgr24(const unsigned char *src, unsigned char *dst,
-		int width, int height, int stride);
+		int width, int height, int src_stride, int dest_stride);
 
 void v4lconvert_yuyv_to_yuv420(const unsigned char *src, unsigned char *dst,
-		int width, int height, int stride, int yvu);
+		int width, int height, int src_stride, int dest_stride, int yvu);
 
 void v4lconvert_yvyu_to_rgb24(const unsigned char *src, unsigned char *dst,
-		int width, int height, int stride);
+		int width, int height, int src_stride, int dest_stride);
 
 void v4lconvert_yvyu_to_bgr24(const unsigned char *src, unsigned char *dst,
-		int width, int height, int stride);
+		int width, int height, int src_stride, int dest_stride);
 
 void v4lconvert_uyvy_to_rgb24(const unsigned char *src, unsigned char *dst,
-		int width, int height, int stride);
+		int width, int height, int src_stride, int dest_stride);
 
 void v4lconvert_uyvy_to_bgr24(const unsigned char *src, unsigned char *dst,
-		int width, int height, int stride);
+		int width, int height, int src_stride, int dest_stride);
 
 void v4lconvert_uyvy_to_yuv420(const unsigned char *src, unsigned char *dst,
-		int width, int height, int stride, int yvu);
+		int width, int height, int src_stride, int dest_stride, int yvu);
 
 void v4lconvert_swap_rgb(const unsigned char *src, unsigned char *dst,
-		int width, int height);
+		int width, int height, int src_stride, int dest_stride);
 
 void v4lconvert_swap_uv(const unsigned char *src, unsigned char *dst,
-		const struct v4l2_format *src_fmt);
+		const struct v4l2_format *src_fmt, int dest_stride);
 
 void v4lconvert_grey_to_rgb24(const unsigned char *src, unsigned char *dest,
 		int width, int height);
@@ -246,6 +311,15 @@ void v4lconvert_bayer_to_bgr24(const unsigned char *bayer,
 void v4lconvert_bayer_to_yuv420(const unsigned char *bayer, unsigned char *yuv,
 		int width, int height, const unsigned int stride, unsigned int src_pixfmt, int yvu);
 
+/* Render only rows first - last-1 of the frame, rgb points to the frame */
+void v4lconvert_bayer_rows_to_rgb24(const unsigned char *bayer,
+		unsigned char *rgb, int width, int height, const unsigned int stride,
+		int dest_stride, unsigned int pixfmt, int first, int last);
+
+void v4lconvert_bayer_rows_to_bgr24(const unsigned char *bayer,
+		unsigned char *rgb, int width, int height, const unsigned int stride,
+		int dest_stride, unsigned int pixfmt, int first, int last);
+
 void v4lconvert_hm12_to_rgb24(const unsigned char *src,
 		unsigned char *dst, int width, int height);
 
@@ -256,10 +330,10 @@ void v4lconvert_hm12_to_yuv420(const unsigned char *src,
 		unsigned char *dst, int width, int height, int yvu);
 
 void v4lconvert_rotate90(unsigned char *src, unsigned char *dest,
-		struct v4l2_format *fmt);
+		struct v4l2_format *fmt, int dest_stride);
 
 void v4lconvert_flip(unsigned char *src, unsigned char *dest,
-		struct v4l2_format *fmt, int hflip, int vflip);
+		struct v4l2_format *fmt, int hflip, int vflip, int dest_stride);
 
 void v4lconvert_crop(unsigned char *src, unsigned char *dest,
 		const struct v4l2_format *src_fmt, const struct v4l2_format *dest_fmt);
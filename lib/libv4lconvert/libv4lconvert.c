@@ -158,6 +158,7 @@ struct v4lconvert_data *v4lconvert_create_with_dev_ops(int fd, void *dev_ops_pri
 	int i, j;
 	struct v4lconvert_data *data = calloc(1, sizeof(struct v4lconvert_data));
 	struct v4l2_capability cap;
+	const char *env;
 	/* This keeps tracks of devices which have only formats for which apps
 	   most likely will need conversion and we can thus safely add software
 	   processing controls without a performance impact. */
@@ -174,6 +175,8 @@ struct v4lconvert_data *v4lconvert_create_with_dev_ops(int fd, void *dev_ops_pri
 	data->decompress_pid = -1;
 	data->fps = 30;
 
+	v4lconvert_simd_init();
+
 	/* Check supported formats */
 	for (i = 0; ; i++) {
 		struct v4l2_fmtdesc fmt = { .type = V4L2_BUF_TYPE_VIDEO_CAPTURE };
@@ -229,6 +232,11 @@ struct v4lconvert_data *v4lconvert_create_with_dev_ops(int fd, void *dev_ops_pri
 		return NULL;
 	}
 
+	/* Using more threads is opt-in, by the app or the user */
+	env = getenv("LIBV4LCONVERT_THREADS");
+	if (env && atoi(env) > 1)
+		v4lconvert_set_threads(data, atoi(env));
+
 	return data;
 }
 
@@ -237,6 +245,7 @@ void v4lconvert_destroy(struct v4lconvert_data *data)
 	if (!data)
 		return;
 
+	v4lconvert_threads_destroy(data->threads);
 	v4lprocessing_destroy(data->processing);
 	v4lcontrol_destroy(data->control);
 	if (data->tinyjpeg) {
@@ -255,6 +264,7 @@ void v4lconvert_destroy(struct v4lconvert_data *data)
 	free(data->rotate90_buf);
 	free(data->flip_buf);
 	free(data->convert_pixfmt_buf);
+	free(data->stride_buf);
 	free(data->previous_frame);
 	free(data);
 }
@@ -505,6 +515,35 @@ void v4lconvert_fixup_fmt(struct v4l2_format *fmt)
 	}
 }
 
+void v4lconvert_set_bytesperline(struct v4l2_format *fmt,
+		unsigned int bytesperline)
+{
+	switch (fmt->fmt.pix.pixelformat) {
+	case V4L2_PIX_FMT_RGB24:
+	case V4L2_PIX_FMT_BGR24:
+		fmt->fmt.pix.bytesperline = bytesperline;
+		fmt->fmt.pix.sizeimage = bytesperline * fmt->fmt.pix.height;
+		break;
+	case V4L2_PIX_FMT_YUV420:
+	case V4L2_PIX_FMT_YVU420:
+		fmt->fmt.pix.bytesperline = bytesperline;
+		fmt->fmt.pix.sizeimage = bytesperline * fmt->fmt.pix.height * 3 / 2;
+		break;
+	}
+}
+
+/* bytesperline of the rgb24 / yuv420 formats without any padding */
+static unsigned int v4lconvert_packed_bytesperline(unsigned int pixelformat,
+		unsigned int width)
+{
+	switch (pixelformat) {
+	case V4L2_PIX_FMT_RGB24:
+	case V4L2_PIX_FMT_BGR24:
+		return width * 3;
+	}
+	return width;
+}
+
 /* See libv4lconvert.h for description of in / out parameters */
 int v4lconvert_try_format(struct v4lconvert_data *data,
 		struct v4l2_format *dest_fmt, struct v4l2_format *src_fmt)
@@ -634,6 +673,43 @@ int v4lconvert_needs_conversion(struct v4lconvert_data *data,
 	return 0;
 }
 
+/* Can src be used as is for this frame? processing is the return value of
+   v4lprocessing_pre_processing() for the frame */
+static int v4lconvert_pass_through(struct v4lconvert_data *data,
+		const struct v4l2_format *src_fmt,
+		const struct v4l2_format *dest_fmt, int processing)
+{
+	unsigned int dest_stride;
+
+	/* If we should do processing/rotating/flipping but the app tries to use
+	   the native cam format, we just return an unprocessed frame */
+	if (!v4lconvert_supported_dst_format(dest_fmt->fmt.pix.pixelformat))
+		return 1;
+
+	dest_stride = v4lconvert_packed_bytesperline(
+			dest_fmt->fmt.pix.pixelformat, dest_fmt->fmt.pix.width);
+	if (dest_fmt->fmt.pix.bytesperline > dest_stride)
+		dest_stride = dest_fmt->fmt.pix.bytesperline;
+
+	return src_fmt->fmt.pix.pixelformat == dest_fmt->fmt.pix.pixelformat &&
+		src_fmt->fmt.pix.width == dest_fmt->fmt.pix.width &&
+		src_fmt->fmt.pix.height == dest_fmt->fmt.pix.height &&
+		src_fmt->fmt.pix.bytesperline == dest_stride &&
+		!processing &&
+		!(data->control_flags & V4LCONTROL_ROTATED_90_JPEG) &&
+		!v4lcontrol_get_ctrl(data->control, V4LCONTROL_HFLIP) &&
+		!v4lcontrol_get_ctrl(data->control, V4LCONTROL_VFLIP);
+}
+
+/* See libv4lconvert.h for description of in / out parameters */
+int v4lconvert_can_pass_through(struct v4lconvert_data *data,
+		const struct v4l2_format *src_fmt,
+		const struct v4l2_format *dest_fmt)
+{
+	return v4lconvert_pass_through(data, src_fmt, dest_fmt,
+			v4lprocessing_pre_processing(data->processing));
+}
+
 static int v4lconvert_processing_needs_double_conversion(
 		unsigned int src_pix_fmt, unsigned int dest_pix_fmt)
 {
@@ -687,15 +763,227 @@ int v4lconvert_oom_error(struct v4lconvert_data *data)
 	return -1;
 }
 
+/* Frames are only split into bands of at least this many bytes, for smaller
+   bands waking up the threads costs more than it gains */
+#define V4LCONVERT_BAND_SIZE 262144
+
+/* Number of bands to split rows of row_size bytes into for the threads */
+static int v4lconvert_bands(struct v4lconvert_data *data, int rows,
+		int row_size)
+{
+	int bands = v4lconvert_threads_max_bands(data->threads);
+	int max = rows * row_size / V4LCONVERT_BAND_SIZE;
+
+	if (bands > max)
+		bands = max;
+
+	return bands > 1 ? bands : 1;
+}
+
+struct v4lconvert_processing_job {
+	struct v4lconvert_data *data;
+	unsigned char *buf;
+	const struct v4l2_format *fmt;
+	int lines; /* lines processed together */
+};
+
+static void v4lconvert_processing_band(void *arg, int band, int bands)
+{
+	struct v4lconvert_processing_job *job = arg;
+	struct v4l2_format fmt = *job->fmt;
+	int units = fmt.fmt.pix.height / job->lines;
+	int first = units * band / bands * job->lines;
+	int last = units * (band + 1) / bands * job->lines;
+
+	fmt.fmt.pix.height = last - first;
+	v4lprocessing_processing_rows(job->data->processing,
+			job->buf + first * fmt.fmt.pix.bytesperline, &fmt);
+}
+
+/* v4lprocessing_processing(), which processes large frames in bands on the
+   threads, except when it must update its lookup tables */
+static void v4lconvert_processing(struct v4lconvert_data *data,
+		unsigned char *buf, const struct v4l2_format *fmt)
+{
+	struct v4lconvert_processing_job job = {
+		.data = data, .buf = buf, .fmt = fmt, .lines = 1
+	};
+	int bands;
+
+	switch (fmt->fmt.pix.pixelformat) {
+	case V4L2_PIX_FMT_SGBRG8:
+	case V4L2_PIX_FMT_SGRBG8:
+	case V4L2_PIX_FMT_SBGGR8:
+	case V4L2_PIX_FMT_SRGGB8:
+		/* Bayer is processed 2 lines at a time */
+		job.lines = 2;
+		break;
+	case V4L2_PIX_FMT_RGB24:
+	case V4L2_PIX_FMT_BGR24:
+		break;
+	default:
+		return; /* v4lprocessing leaves these alone */
+	}
+
+	bands = v4lconvert_bands(data, fmt->fmt.pix.height / job.lines,
+			job.lines * fmt->fmt.pix.bytesperline);
+	if (bands == 1) {
+		v4lprocessing_processing(data->processing, buf, fmt);
+		return;
+	}
+
+	switch (v4lprocessing_begin_rows(data->processing)) {
+	case -1:
+		v4lprocessing_processing(data->processing, buf, fmt);
+		break;
+	case 1:
+		v4lconvert_threads_run(data->threads, bands,
+				v4lconvert_processing_band, &job);
+		break;
+	}
+}
+
+struct v4lconvert_bayer_job {
+	const unsigned char *src;
+	unsigned char *dest;
+	int width, height, stride, dest_stride;
+	unsigned int src_pix_fmt, dest_pix_fmt;
+};
+
+static void v4lconvert_bayer_band(void *arg, int band, int bands)
+{
+	struct v4lconvert_bayer_job *job = arg;
+	int first = job->height * band / bands;
+	int last = job->height * (band + 1) / bands;
+
+	if (job->dest_pix_fmt == V4L2_PIX_FMT_BGR24)
+		v4lconvert_bayer_rows_to_bgr24(job->src, job->dest, job->width,
+				job->height, job->stride, job->dest_stride,
+				job->src_pix_fmt, first, last);
+	else
+		v4lconvert_bayer_rows_to_rgb24(job->src, job->dest, job->width,
+				job->height, job->stride, job->dest_stride,
+				job->src_pix_fmt, first, last);
+}
+
+/* Copies a rgb24 / yuv420 frame to dest with dest_stride bytes per line */
+static void v4lconvert_copy_frame(const unsigned char *src,
+		unsigned char *dest, const struct v4l2_format *fmt, int dest_stride)
+{
+	int width = fmt->fmt.pix.width;
+	int height = fmt->fmt.pix.height;
+	int stride = fmt->fmt.pix.bytesperline;
+	int packed = v4lconvert_packed_bytesperline(fmt->fmt.pix.pixelformat,
+			width);
+	int y;
+
+	switch (fmt->fmt.pix.pixelformat) {
+	case V4L2_PIX_FMT_RGB24:
+	case V4L2_PIX_FMT_BGR24:
+		if (stride == packed && dest_stride == packed) {
+			memcpy(dest, src, packed * height);
+			break;
+		}
+		for (y = 0; y < height; y++)
+			memcpy(dest + y * dest_stride, src + y * stride, width * 3);
+		break;
+	case V4L2_PIX_FMT_YUV420:
+	case V4L2_PIX_FMT_YVU420:
+		if (stride == packed && dest_stride == packed) {
+			memcpy(dest, src, packed * height * 3 / 2);
+			break;
+		}
+		for (y = 0; y < height; y++)
+			memcpy(dest + y * dest_stride, src + y * stride, width);
+		/* The U and V plane rows, which have half the width */
+		src += height * stride;
+		dest += height * dest_stride;
+		for (y = 0; y < height / 2 * 2; y++)
+			memcpy(dest + y * (dest_stride / 2), src + y * (stride / 2),
+					width / 2);
+		break;
+	}
+}
+
+/* Whether v4lconvert_convert_pixfmt() writes lines of dest_stride bytes
+   itself, for the other formats it converts to a packed buffer first */
+static int v4lconvert_pixfmt_has_stride(unsigned int src_pix_fmt,
+		unsigned int dest_pix_fmt)
+{
+	switch (src_pix_fmt) {
+	case V4L2_PIX_FMT_RGB24:
+	case V4L2_PIX_FMT_BGR24:
+	case V4L2_PIX_FMT_YUV420:
+	case V4L2_PIX_FMT_YVU420:
+	case V4L2_PIX_FMT_YUYV:
+	case V4L2_PIX_FMT_YVYU:
+	case V4L2_PIX_FMT_UYVY:
+		return 1;
+
+	/* These are converted from a packed yuv420 or bayer frame, to rgb
+	   with the dest_stride */
+	case V4L2_PIX_FMT_SPCA501:
+	case V4L2_PIX_FMT_SPCA505:
+	case V4L2_PIX_FMT_SPCA508:
+	case V4L2_PIX_FMT_CIT_YYVYUY:
+	case V4L2_PIX_FMT_KONICA420:
+	case V4L2_PIX_FMT_M420:
+	case V4L2_PIX_FMT_SN9C20X_I420:
+	case V4L2_PIX_FMT_CPIA1:
+	case V4L2_PIX_FMT_OV511:
+	case V4L2_PIX_FMT_OV518:
+	case V4L2_PIX_FMT_SPCA561:
+	case V4L2_PIX_FMT_SN9C10X:
+	case V4L2_PIX_FMT_PAC207:
+	case V4L2_PIX_FMT_MR97310A:
+	case V4L2_PIX_FMT_JL2005BCD:
+	case V4L2_PIX_FMT_SN9C2028:
+	case V4L2_PIX_FMT_SQ905C:
+	case V4L2_PIX_FMT_STV0680:
+	case V4L2_PIX_FMT_SBGGR8:
+	case V4L2_PIX_FMT_SGBRG8:
+	case V4L2_PIX_FMT_SGRBG8:
+	case V4L2_PIX_FMT_SRGGB8:
+		return dest_pix_fmt == V4L2_PIX_FMT_RGB24 ||
+			dest_pix_fmt == V4L2_PIX_FMT_BGR24;
+	}
+	return 0;
+}
+
+/* Converts src to dest_pix_fmt, with lines of dest_stride bytes in dest or
+   without padding if dest_stride is 0, fmt is updated to describe dest */
 static int v4lconvert_convert_pixfmt(struct v4lconvert_data *data,
 	unsigned char *src, int src_size, unsigned char *dest, int dest_size,
-	struct v4l2_format *fmt, unsigned int dest_pix_fmt)
+	struct v4l2_format *fmt, unsigned int dest_pix_fmt, int dest_stride)
 {
 	int result = 0;
 	unsigned int src_pix_fmt = fmt->fmt.pix.pixelformat;
 	unsigned int width  = fmt->fmt.pix.width;
 	unsigned int height = fmt->fmt.pix.height;
 	unsigned int bytesperline = fmt->fmt.pix.bytesperline;
+	int padded = dest_stride != 0;
+
+	if (!padded)
+		dest_stride = v4lconvert_packed_bytesperline(dest_pix_fmt, width);
+	else if (dest_stride != v4lconvert_packed_bytesperline(dest_pix_fmt, width) &&
+			!v4lconvert_pixfmt_has_stride(src_pix_fmt, dest_pix_fmt)) {
+		struct v4l2_format packed_fmt = *fmt;
+		unsigned char *d;
+
+		packed_fmt.fmt.pix.pixelformat = dest_pix_fmt;
+		v4lconvert_fixup_fmt(&packed_fmt);
+		d = v4lconvert_alloc_buffer(packed_fmt.fmt.pix.sizeimage,
+				&data->stride_buf, &data->stride_buf_size);
+		if (!d)
+			return v4lconvert_oom_error(data);
+
+		result = v4lconvert_convert_pixfmt(data, src, src_size, d,
+				packed_fmt.fmt.pix.sizeimage, fmt, dest_pix_fmt, 0);
+		/* Short frames still get used, so copy those too */
+		v4lconvert_copy_frame(d, dest, fmt, dest_stride);
+		v4lconvert_set_bytesperline(fmt, dest_stride);
+		return result;
+	}
 
 	switch (src_pix_fmt) {
 	/* JPG and variants */
@@ -815,11 +1103,11 @@ static int v4lconvert_convert_pixfmt(struct v4lconvert_data *data,
 		switch (dest_pix_fmt) {
 		case V4L2_PIX_FMT_RGB24:
 			v4lconvert_yuv420_to_rgb24(data->convert_pixfmt_buf, dest, width,
-					height, yvu);
+					height, width, dest_stride, yvu);
 			break;
 		case V4L2_PIX_FMT_BGR24:
 			v4lconvert_yuv420_to_bgr24(data->convert_pixfmt_buf, dest, width,
-					height, yvu);
+					height, width, dest_stride, yvu);
 			break;
 		}
 		break;
@@ -918,7 +1206,7 @@ static int v4lconvert_convert_pixfmt(struct v4lconvert_data *data,
 		   cheaper, and bayer == rgb and our dest_fmt may be yuv */
 		tmpfmt.fmt.pix.bytesperline = width;
 		tmpfmt.fmt.pix.sizeimage = width * height;
-		v4lprocessing_processing(data->processing, tmpbuf, &tmpfmt);
+		v4lconvert_processing(data, tmpbuf, &tmpfmt);
 		/* Deliberate fall through to raw bayer fmt code! */
 		src_pix_fmt = tmpfmt.fmt.pix.pixelformat;
 		src = tmpbuf;
@@ -933,11 +1221,19 @@ static int v4lconvert_convert_pixfmt(struct v4lconvert_data *data,
 	case V4L2_PIX_FMT_SRGGB8:
 		switch (dest_pix_fmt) {
 		case V4L2_PIX_FMT_RGB24:
-			v4lconvert_bayer_to_rgb24(src, dest, width, height, bytesperline, src_pix_fmt);
-			break;
-		case V4L2_PIX_FMT_BGR24:
-			v4lconvert_bayer_to_bgr24(src, dest, width, height, bytesperline, src_pix_fmt);
+		case V4L2_PIX_FMT_BGR24: {
+			struct v4lconvert_bayer_job job = {
+				.src = src, .dest = dest, .width = width,
+				.height = height, .stride = bytesperline,
+				.dest_stride = dest_stride,
+				.src_pix_fmt = src_pix_fmt, .dest_pix_fmt = dest_pix_fmt
+			};
+
+			v4lconvert_threads_run(data->threads,
+					v4lconvert_bands(data, height, width * 3),
+					v4lconvert_bayer_band, &job);
 			break;
+		}
 		case V4L2_PIX_FMT_YUV420:
 			v4lconvert_bayer_to_yuv420(src, dest, width, height, bytesperline, src_pix_fmt, 0);
 			break;
@@ -977,13 +1273,14 @@ static int v4lconvert_convert_pixfmt(struct v4lconvert_data *data,
 						   width, height);
 		switch (dest_pix_fmt) {
 		case V4L2_PIX_FMT_BGR24:
-			v4lconvert_swap_rgb(d, dest, width, height);
+			v4lconvert_swap_rgb(d, dest, width, height, width * 3,
+					dest_stride);
 			break;
 		case V4L2_PIX_FMT_YUV420:
-			v4lconvert_rgb24_to_yuv420(d, dest, fmt, 0, 0);
+			v4lconvert_rgb24_to_yuv420(d, dest, fmt, dest_stride, 0, 0);
 			break;
 		case V4L2_PIX_FMT_YVU420:
-			v4lconvert_rgb24_to_yuv420(d, dest, fmt, 0, 1);
+			v4lconvert_rgb24_to_yuv420(d, dest, fmt, dest_stride, 0, 1);
 			break;
 		}
 		break;
@@ -1054,16 +1351,17 @@ static int v4lconvert_convert_pixfmt(struct v4lconvert_data *data,
 	case V4L2_PIX_FMT_RGB24:
 		switch (dest_pix_fmt) {
 		case V4L2_PIX_FMT_RGB24:
-			memcpy(dest, src, width * height * 3);
+			v4lconvert_copy_frame(src, dest, fmt, dest_stride);
 			break;
 		case V4L2_PIX_FMT_BGR24:
-			v4lconvert_swap_rgb(src, dest, width, height);
+			v4lconvert_swap_rgb(src, dest, width, height, bytesperline,
+					dest_stride);
 			break;
 		case V4L2_PIX_FMT_YUV420:
-			v4lconvert_rgb24_to_yuv420(src, dest, fmt, 0, 0);
+			v4lconvert_rgb24_to_yuv420(src, dest, fmt, dest_stride, 0, 0);
 			break;
 		case V4L2_PIX_FMT_YVU420:
-			v4lconvert_rgb24_to_yuv420(src, dest, fmt, 0, 1);
+			v4lconvert_rgb24_to_yuv420(src, dest, fmt, dest_stride, 0, 1);
 			break;
 		}
 		if (src_size < (width * height * 3)) {
@@ -1076,16 +1374,17 @@ static int v4lconvert_convert_pixfmt(struct v4lconvert_data *data,
 	case V4L2_PIX_FMT_BGR24:
 		switch (dest_pix_fmt) {
 		case V4L2_PIX_FMT_RGB24:
-			v4lconvert_swap_rgb(src, dest, width, height);
+			v4lconvert_swap_rgb(src, dest, width, height, bytesperline,
+					dest_stride);
 			break;
 		case V4L2_PIX_FMT_BGR24:
-			memcpy(dest, src, width * height * 3);
+			v4lconvert_copy_frame(src, dest, fmt, dest_stride);
 			break;
 		case V4L2_PIX_FMT_YUV420:
-			v4lconvert_rgb24_to_yuv420(src, dest, fmt, 1, 0);
+			v4lconvert_rgb24_to_yuv420(src, dest, fmt, dest_stride, 1, 0);
 			break;
 		case V4L2_PIX_FMT_YVU420:
-			v4lconvert_rgb24_to_yuv420(src, dest, fmt, 1, 1);
+			v4lconvert_rgb24_to_yuv420(src, dest, fmt, dest_stride, 1, 1);
 			break;
 		}
 		if (src_size < (width * height * 3)) {
@@ -1099,17 +1398,17 @@ static int v4lconvert_convert_pixfmt(struct v4lconvert_data *data,
 		switch (dest_pix_fmt) {
 		case V4L2_PIX_FMT_RGB24:
 			v4lconvert_yuv420_to_rgb24(src, dest, width,
-					height, 0);
+					height, bytesperline, dest_stride, 0);
 			break;
 		case V4L2_PIX_FMT_BGR24:
 			v4lconvert_yuv420_to_bgr24(src, dest, width,
-					height, 0);
+					height, bytesperline, dest_stride, 0);
 			break;
 		case V4L2_PIX_FMT_YUV420:
-			memcpy(dest, src, width * height * 3 / 2);
+			v4lconvert_copy_frame(src, dest, fmt, dest_stride);
 			break;
 		case V4L2_PIX_FMT_YVU420:
-			v4lconvert_swap_uv(src, dest, fmt);
+			v4lconvert_swap_uv(src, dest, fmt, dest_stride);
 			break;
 		}
 		if (src_size < (width * height * 3 / 2)) {
@@ -1123,17 +1422,17 @@ static int v4lconvert_convert_pixfmt(struct v4lconvert_data *data,
 		switch (dest_pix_fmt) {
 		case V4L2_PIX_FMT_RGB24:
 			v4lconvert_yuv420_to_rgb24(src, dest, width,
-					height, 1);
+					height, bytesperline, dest_stride, 1);
 			break;
 		case V4L2_PIX_FMT_BGR24:
 			v4lconvert_yuv420_to_bgr24(src, dest, width,
-					height, 1);
+					height, bytesperline, dest_stride, 1);
 			break;
 		case V4L2_PIX_FMT_YUV420:
-			v4lconvert_swap_uv(src, dest, fmt);
+			v4lconvert_swap_uv(src, dest, fmt, dest_stride);
 			break;
 		case V4L2_PIX_FMT_YVU420:
-			memcpy(dest, src, width * height * 3 / 2);
+			v4lconvert_copy_frame(src, dest, fmt, dest_stride);
 			break;
 		}
 		if (src_size < (width * height * 3 / 2)) {
@@ -1146,16 +1445,20 @@ static int v4lconvert_convert_pixfmt(struct v4lconvert_data *data,
 	case V4L2_PIX_FMT_YUYV:
 		switch (dest_pix_fmt) {
 		case V4L2_PIX_FMT_RGB24:
-			v4lconvert_yuyv_to_rgb24(src, dest, width, height, bytesperline);
+			v4lconvert_yuyv_to_rgb24(src, dest, width, height,
+					bytesperline, dest_stride);
 			break;
 		case V4L2_PIX_FMT_BGR24:
-			v4lconvert_yuyv_to_bgr24(src, dest, width, height, bytesperline);
+			v4lconvert_yuyv_to_bgr24(src, dest, width, height,
+					bytesperline, dest_stride);
 			break;
 		case V4L2_PIX_FMT_YUV420:
-			v4lconvert_yuyv_to_yuv420(src, dest, width, height, bytesperline, 0);
+			v4lconvert_yuyv_to_yuv420(src, dest, width, height,
+					bytesperline, dest_stride, 0);
 			break;
 		case V4L2_PIX_FMT_YVU420:
-			v4lconvert_yuyv_to_yuv420(src, dest, width, height, bytesperline, 1);
+			v4lconvert_yuyv_to_yuv420(src, dest, width, height,
+					bytesperline, dest_stride, 1);
 			break;
 		}
 		if (src_size < (width * height * 2)) {
@@ -1168,18 +1471,22 @@ static int v4lconvert_convert_pixfmt(struct v4lconvert_data *data,
 	case V4L2_PIX_FMT_YVYU:
 		switch (dest_pix_fmt) {
 		case V4L2_PIX_FMT_RGB24:
-			v4lconvert_yvyu_to_rgb24(src, dest, width, height, bytesperline);
+			v4lconvert_yvyu_to_rgb24(src, dest, width, height,
+					bytesperline, dest_stride);
 			break;
 		case V4L2_PIX_FMT_BGR24:
-			v4lconvert_yvyu_to_bgr24(src, dest, width, height, bytesperline);
+			v4lconvert_yvyu_to_bgr24(src, dest, width, height,
+					bytesperline, dest_stride);
 			break;
 		case V4L2_PIX_FMT_YUV420:
 			/* Note we use yuyv_to_yuv420 not v4lconvert_yvyu_to_yuv420,
 			   with the last argument reversed to make it have as we want */
-			v4lconvert_yuyv_to_yuv420(src, dest, width, height, bytesperline, 1);
+			v4lconvert_yuyv_to_yuv420(src, dest, width, height,
+					bytesperline, dest_stride, 1);
 			break;
 		case V4L2_PIX_FMT_YVU420:
-			v4lconvert_yuyv_to_yuv420(src, dest, width, height, bytesperline, 0);
+			v4lconvert_yuyv_to_yuv420(src, dest, width, height,
+					bytesperline, dest_stride, 0);
 			break;
 		}
 		if (src_size < (width * height * 2)) {
@@ -1192,16 +1499,20 @@ static int v4lconvert_convert_pixfmt(struct v4lconvert_data *data,
 	case V4L2_PIX_FMT_UYVY:
 		switch (dest_pix_fmt) {
 		case V4L2_PIX_FMT_RGB24:
-			v4lconvert_uyvy_to_rgb24(src, dest, width, height, bytesperline);
+			v4lconvert_uyvy_to_rgb24(src, dest, width, height,
+					bytesperline, dest_stride);
 			break;
 		case V4L2_PIX_FMT_BGR24:
-			v4lconvert_uyvy_to_bgr24(src, dest, width, height, bytesperline);
+			v4lconvert_uyvy_to_bgr24(src, dest, width, height,
+					bytesperline, dest_stride);
 			break;
 		case V4L2_PIX_FMT_YUV420:
-			v4lconvert_uyvy_to_yuv420(src, dest, width, height, bytesperline, 0);
+			v4lconvert_uyvy_to_yuv420(src, dest, width, height,
+					bytesperline, dest_stride, 0);
 			break;
 		case V4L2_PIX_FMT_YVU420:
-			v4lconvert_uyvy_to_yuv420(src, dest, width, height, bytesperline, 1);
+			v4lconvert_uyvy_to_yuv420(src, dest, width, height,
+					bytesperline, dest_stride, 1);
 			break;
 		}
 		if (src_size < (width * height * 2)) {
@@ -1219,17 +1530,269 @@ static int v4lconvert_convert_pixfmt(struct v4lconvert_data *data,
 
 	fmt->fmt.pix.pixelformat = dest_pix_fmt;
 	v4lconvert_fixup_fmt(fmt);
+	if (padded)
+		v4lconvert_set_bytesperline(fmt, dest_stride);
 
 	return result;
 }
 
+/* Size of the strips of rgb24 rows v4lconvert_convert_strips() works on, so
+   that a strip stays in the cache while it goes through all steps */
+#define V4LCONVERT_STRIP_SIZE 65536
+
+static void v4lconvert_yuv422_rows(const unsigned char *src,
+		unsigned char *dest, int width, int height, int stride,
+		int dest_stride, unsigned int src_pix_fmt, unsigned int dest_pix_fmt)
+{
+	int bgr = dest_pix_fmt == V4L2_PIX_FMT_BGR24;
+
+	switch (src_pix_fmt) {
+	case V4L2_PIX_FMT_YUYV:
+		if (bgr)
+			v4lconvert_yuyv_to_bgr24(src, dest, width, height, stride,
+					dest_stride);
+		else
+			v4lconvert_yuyv_to_rgb24(src, dest, width, height, stride,
+					dest_stride);
+		break;
+	case V4L2_PIX_FMT_YVYU:
+		if (bgr)
+			v4lconvert_yvyu_to_bgr24(src, dest, width, height, stride,
+					dest_stride);
+		else
+			v4lconvert_yvyu_to_rgb24(src, dest, width, height, stride,
+					dest_stride);
+		break;
+	case V4L2_PIX_FMT_UYVY:
+		if (bgr)
+			v4lconvert_uyvy_to_bgr24(src, dest, width, height, stride,
+					dest_stride);
+		else
+			v4lconvert_uyvy_to_rgb24(src, dest, width, height, stride,
+					dest_stride);
+		break;
+	}
+}
+
+static void v4lconvert_copy_row_rgbbgr24(const unsigned char *src,
+		unsigned char *dest, int width, int hflip)
+{
+	if (!hflip) {
+		memcpy(dest, src, width * 3);
+		return;
+	}
+
+	src += width * 3;
+	while (width--) {
+		src -= 3;
+		dest[0] = src[0];
+		dest[1] = src[1];
+		dest[2] = src[2];
+		dest += 3;
+	}
+}
+
+struct v4lconvert_strips_job {
+	struct v4lconvert_data *data;
+	const unsigned char *src;
+	unsigned char *frame;  /* converted frame, NULL when converting strips */
+	unsigned char *strips; /* a strip buffer per band, unless direct */
+	unsigned char *dest;
+	struct v4l2_format rows_fmt;
+	unsigned int src_pix_fmt;
+	int src_stride, stride, dest_stride, strip_height;
+	int height, starty, firstx, firsty, dest_width, dest_height;
+	int hflip, vflip, direct, process_rows;
+};
+
+/* Does a band of the rows of dest, one strip at a time */
+static void v4lconvert_strips_band(void *arg, int band, int bands)
+{
+	struct v4lconvert_strips_job *job = arg;
+	struct v4l2_format rows_fmt = job->rows_fmt;
+	int first = job->firsty + job->dest_height * band / bands;
+	int last = job->firsty + job->dest_height * (band + 1) / bands;
+	int stride = job->stride;
+	unsigned char *strip;
+	int y, y0, n;
+
+	for (y0 = first; y0 < last; y0 += n) {
+		n = MIN(job->strip_height, last - y0);
+		if (job->frame)
+			strip = job->frame + y0 * stride;
+		else if (job->direct)
+			strip = job->dest + (y0 - job->starty) * stride;
+		else
+			strip = job->strips + band * job->strip_height * stride;
+		if (!job->frame)
+			v4lconvert_yuv422_rows(job->src + y0 * job->src_stride,
+					strip, rows_fmt.fmt.pix.width, n,
+					job->src_stride, stride, job->src_pix_fmt,
+					rows_fmt.fmt.pix.pixelformat);
+
+		if (job->process_rows) {
+			rows_fmt.fmt.pix.height = n;
+			v4lprocessing_processing_rows(job->data->processing,
+					strip, &rows_fmt);
+		}
+
+		for (y = y0; y < y0 + n && !job->direct; y++) {
+			int dest_y = job->vflip ? job->height - 1 - job->starty - y :
+				y - job->starty;
+
+			v4lconvert_copy_row_rgbbgr24(strip + (y - y0) * stride +
+					job->firstx * 3,
+					job->dest + dest_y * job->dest_stride,
+					job->dest_width, job->hflip);
+		}
+	}
+}
+
+/* Does the convert_pixfmt -> processing -> flip -> crop chain of
+   v4lconvert_convert() strip by strip for rgb24 / bgr24 destinations,
+   so that each pixel is read from and written to memory once, instead of
+   once per step. Packed yuv 4:2:2 is converted strip by strip as well,
+   other formats are converted to a whole frame first.
+   Returns 1 if the frame must go through the normal chain, else 0, or -1
+   on errors like v4lconvert_convert_pixfmt(). */
+static int v4lconvert_convert_strips(struct v4lconvert_data *data,
+		struct v4l2_format *src_fmt, const struct v4l2_format *dest_fmt,
+		unsigned char *src, int src_size, unsigned char *dest,
+		int processing, int hflip, int vflip)
+{
+	unsigned int src_pix_fmt = src_fmt->fmt.pix.pixelformat;
+	unsigned int dest_pix_fmt = dest_fmt->fmt.pix.pixelformat;
+	int width = src_fmt->fmt.pix.width;
+	int height = src_fmt->fmt.pix.height;
+	int dest_width = dest_fmt->fmt.pix.width;
+	int dest_height = dest_fmt->fmt.pix.height;
+	int startx, stride, bands, process_rows = 0;
+	unsigned char *frame = NULL;
+	struct v4l2_format rows_fmt;
+	struct v4lconvert_strips_job job;
+
+	if (dest_pix_fmt != V4L2_PIX_FMT_RGB24 &&
+			dest_pix_fmt != V4L2_PIX_FMT_BGR24)
+		return 1;
+
+	/* Only plain cropping, scaling down and adding borders are left to
+	   v4lconvert_crop() */
+	if (dest_width > width || dest_height > height ||
+			(width >= 2 * dest_width && height >= 2 * dest_height))
+		return 1;
+
+	if (src_pix_fmt == V4L2_PIX_FMT_YUYV ||
+			src_pix_fmt == V4L2_PIX_FMT_YVYU ||
+			src_pix_fmt == V4L2_PIX_FMT_UYVY) {
+		/* Let the normal chain report short frames */
+		if (src_size < width * height * 2)
+			return 1;
+		if (processing) {
+			process_rows = v4lprocessing_begin_rows(data->processing);
+			if (process_rows < 0)
+				return 1;
+		}
+	} else if ((processing && v4lconvert_processing_needs_double_conversion(
+				src_pix_fmt, dest_pix_fmt)) ||
+			/* nothing to gain over converting straight into dest */
+			(!hflip && !vflip && dest_width == width &&
+			 dest_height == height)) {
+		return 1;
+	} else {
+		/* Same order as the normal chain, processing of the source
+		   format is done on the source */
+		if (processing)
+			v4lconvert_processing(data, src, src_fmt);
+
+		if (src_pix_fmt == dest_pix_fmt) {
+			frame = src;
+			stride = src_fmt->fmt.pix.bytesperline;
+		} else {
+			struct v4l2_format frame_fmt = *src_fmt;
+			int res;
+
+			frame = v4lconvert_alloc_buffer(width * height * 3,
+					&data->convert2_buf, &data->convert2_buf_size);
+			if (!frame)
+				return v4lconvert_oom_error(data);
+
+			res = v4lconvert_convert_pixfmt(data, src, src_size, frame,
+					width * height * 3, &frame_fmt, dest_pix_fmt, 0);
+			if (res)
+				return res;
+			stride = frame_fmt.fmt.pix.bytesperline;
+		}
+
+		if (processing) {
+			process_rows = v4lprocessing_begin_rows(data->processing);
+			if (process_rows < 0) {
+				rows_fmt = *dest_fmt;
+				rows_fmt.fmt.pix.width = width;
+				rows_fmt.fmt.pix.height = height;
+				rows_fmt.fmt.pix.bytesperline = stride;
+				v4lprocessing_processing(data->processing, frame,
+						&rows_fmt);
+				process_rows = 0;
+			}
+		}
+	}
+
+	/* The window of the source which ends up in dest, v4lconvert_crop()
+	   takes the center of the flipped frame */
+	startx = (width - dest_width) / 2;
+	job.starty = (height - dest_height) / 2;
+	job.firstx = hflip ? width - startx - dest_width : startx;
+	job.firsty = vflip ? height - job.starty - dest_height : job.starty;
+
+	job.strip_height = V4LCONVERT_STRIP_SIZE / (width * 3);
+	if (job.strip_height < 1)
+		job.strip_height = 1;
+	bands = v4lconvert_bands(data, dest_height, width * 3);
+	/* Without flipping or cropping columns the rows can be converted
+	   straight into dest */
+	job.direct = !frame && !hflip && !vflip && dest_width == width;
+	job.strips = NULL;
+	if (job.direct) {
+		stride = dest_fmt->fmt.pix.bytesperline;
+	} else if (!frame) {
+		stride = width * 3;
+		job.strips = v4lconvert_alloc_buffer(
+				bands * job.strip_height * stride,
+				&data->convert2_buf, &data->convert2_buf_size);
+		if (!job.strips)
+			return v4lconvert_oom_error(data);
+	}
+
+	job.data = data;
+	job.src = src;
+	job.frame = frame;
+	job.dest = dest;
+	job.rows_fmt = *dest_fmt;
+	job.rows_fmt.fmt.pix.width = width;
+	job.rows_fmt.fmt.pix.bytesperline = stride;
+	job.src_pix_fmt = src_pix_fmt;
+	job.src_stride = src_fmt->fmt.pix.bytesperline;
+	job.stride = stride;
+	job.dest_stride = dest_fmt->fmt.pix.bytesperline;
+	job.height = height;
+	job.dest_width = dest_width;
+	job.dest_height = dest_height;
+	job.hflip = hflip;
+	job.vflip = vflip;
+	job.process_rows = process_rows;
+	v4lconvert_threads_run(data->threads, bands, v4lconvert_strips_band,
+			&job);
+
+	return 0;
+}
+
 int v4lconvert_convert(struct v4lconvert_data *data,
 		const struct v4l2_format *src_fmt,  /* in */
 		const struct v4l2_format *dest_fmt, /* in */
 		unsigned char *src, int src_size, unsigned char *dest, int dest_size)
 {
 	int res, dest_needed, temp_needed, processing, convert = 0;
-	int rotate90, vflip, hflip, crop;
+	int rotate90, vflip, hflip, crop, dest_stride;
 	unsigned char *convert1_dest = dest;
 	int convert1_dest_size = dest_size;
 	unsigned char *convert2_src = src, *convert2_dest = dest;
@@ -1247,14 +1810,20 @@ int v4lconvert_convert(struct v4lconvert_data *data,
 	crop = my_dest_fmt.fmt.pix.width != my_src_fmt.fmt.pix.width ||
 		my_dest_fmt.fmt.pix.height != my_src_fmt.fmt.pix.height;
 
-	if (/* If no conversion/processing is needed */
-			(src_fmt->fmt.pix.pixelformat == dest_fmt->fmt.pix.pixelformat &&
-			 !processing && !rotate90 && !hflip && !vflip && !crop) ||
-			/* or if we should do processing/rotating/flipping but the app tries to
-			   use the native cam format, we just return an unprocessed frame copy */
-			!v4lconvert_supported_dst_format(dest_fmt->fmt.pix.pixelformat)) {
+	/* dest lines are padded to the bytesperline of dest_fmt, a too small
+	   bytesperline (apps which leave it 0) means no padding */
+	dest_stride = v4lconvert_packed_bytesperline(
+			my_dest_fmt.fmt.pix.pixelformat, my_dest_fmt.fmt.pix.width);
+	if (my_dest_fmt.fmt.pix.bytesperline < dest_stride)
+		my_dest_fmt.fmt.pix.bytesperline = dest_stride;
+	dest_stride = my_dest_fmt.fmt.pix.bytesperline;
+
+	if (v4lconvert_pass_through(data, src_fmt, dest_fmt, processing)) {
 		int to_copy = MIN(dest_size, src_size);
-		memcpy(dest, src, to_copy);
+
+		/* dest == src means the caller hands out src as is */
+		if (dest != src)
+			memcpy(dest, src, to_copy);
 		return to_copy;
 	}
 
@@ -1269,13 +1838,12 @@ int v4lconvert_convert(struct v4lconvert_data *data,
 	switch (my_dest_fmt.fmt.pix.pixelformat) {
 	case V4L2_PIX_FMT_RGB24:
 	case V4L2_PIX_FMT_BGR24:
-		dest_needed = my_dest_fmt.fmt.pix.width * my_dest_fmt.fmt.pix.height * 3;
+		dest_needed = dest_stride * my_dest_fmt.fmt.pix.height;
 		temp_needed = my_src_fmt.fmt.pix.width * my_src_fmt.fmt.pix.height * 3;
 		break;
 	case V4L2_PIX_FMT_YUV420:
 	case V4L2_PIX_FMT_YVU420:
-		dest_needed =
-			my_dest_fmt.fmt.pix.width * my_dest_fmt.fmt.pix.height * 3 / 2;
+		dest_needed = dest_stride * my_dest_fmt.fmt.pix.height * 3 / 2;
 		temp_needed =
 			my_src_fmt.fmt.pix.width * my_src_fmt.fmt.pix.height * 3 / 2;
 		break;
@@ -1292,6 +1860,13 @@ int v4lconvert_convert(struct v4lconvert_data *data,
 		return -1;
 	}
 
+	if (!rotate90 && (processing || hflip || vflip || crop)) {
+		res = v4lconvert_convert_strips(data, &my_src_fmt, &my_dest_fmt,
+				src, src_size, dest, processing, hflip, vflip);
+		if (res <= 0)
+			return res ? res : dest_needed;
+	}
+
 
 	/* Sometimes we need foo -> rgb -> bar as video processing (whitebalance,
 	   etc.) can only be done on rgb data */
@@ -1356,7 +1931,7 @@ int v4lconvert_convert(struct v4lconvert_data *data,
 		res = v4lconvert_convert_pixfmt(data, src, src_size,
 				convert1_dest, convert1_dest_size,
 				&my_src_fmt,
-				V4L2_PIX_FMT_RGB24);
+				V4L2_PIX_FMT_RGB24, 0);
 		if (res)
 			return res;
 
@@ -1364,13 +1939,14 @@ int v4lconvert_convert(struct v4lconvert_data *data,
 	}
 
 	if (processing)
-		v4lprocessing_processing(data->processing, convert2_src, &my_src_fmt);
+		v4lconvert_processing(data, convert2_src, &my_src_fmt);
 
 	if (convert) {
 		res = v4lconvert_convert_pixfmt(data, convert2_src, src_size,
 				convert2_dest, convert2_dest_size,
 				&my_src_fmt,
-				my_dest_fmt.fmt.pix.pixelformat);
+				my_dest_fmt.fmt.pix.pixelformat,
+				convert2_dest == dest ? dest_stride : 0);
 		if (res)
 			return res;
 
@@ -1380,14 +1956,24 @@ int v4lconvert_convert(struct v4lconvert_data *data,
 		   rgb, but the dest is. v4lprocessing checks it self it only actually
 		   does the processing once per frame. */
 		if (processing)
-			v4lprocessing_processing(data->processing, convert2_dest, &my_src_fmt);
+			v4lconvert_processing(data, convert2_dest, &my_src_fmt);
 	}
 
+	/* Only the last step writes to dest, the temporary buffers between
+	   the steps have no padding */
 	if (rotate90)
-		v4lconvert_rotate90(rotate90_src, rotate90_dest, &my_src_fmt);
+		v4lconvert_rotate90(rotate90_src, rotate90_dest, &my_src_fmt,
+				rotate90_dest == dest ? dest_stride :
+				v4lconvert_packed_bytesperline(
+					my_src_fmt.fmt.pix.pixelformat,
+					my_src_fmt.fmt.pix.height));
 
 	if (hflip || vflip)
-		v4lconvert_flip(flip_src, flip_dest, &my_src_fmt, hflip, vflip);
+		v4lconvert_flip(flip_src, flip_dest, &my_src_fmt, hflip, vflip,
+				flip_dest == dest ? dest_stride :
+				v4lconvert_packed_bytesperline(
+					my_src_fmt.fmt.pix.pixelformat,
+					my_src_fmt.fmt.pix.width));
 
 	if (crop)
 		v4lconvert_crop(crop_src, dest, &my_src_fmt, &my_dest_fmt);
@@ -1605,3 +2191,35 @@ void v4lconvert_set_fps(struct v4lconvert_data *data, int fps)
 {
 	data->fps = fps;
 }
+
+int v4lconvert_get_threads(struct v4lconvert_data *data)
+{
+	return v4lconvert_threads_max_bands(data->threads);
+}
+
+int v4lconvert_set_threads(struct v4lconvert_data *data, int threads)
+{
+	if (threads < 1) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (threads > V4LCONVERT_MAX_THREADS)
+		threads = V4LCONVERT_MAX_THREADS;
+	if (threads == v4lconvert_get_threads(data))
+		return 0;
+
+	v4lconvert_threads_destroy(data->threads);
+	data->threads = NULL;
+	if (threads == 1)
+		return 0;
+
+	/* The calling thread is one of them */
+	data->threads = v4lconvert_threads_create(threads - 1);
+	if (!data->threads) {
+		V4LCONVERT_ERR("could not create conversion threads\n");
+		errno = EAGAIN;
+		return -1;
+	}
+
+	return 0;
+}
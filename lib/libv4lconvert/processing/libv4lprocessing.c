@@ -186,3 +186,24 @@ void v4lprocessing_processing(struct v4lprocessing_data *data,
 
 	data->do_process = 0;
 }
+
+int v4lprocessing_begin_rows(struct v4lprocessing_data *data)
+{
+	if (!data->do_process)
+		return 0;
+
+	if (data->controls_changed ||
+			data->lookup_table_update_counter == V4L2PROCESSING_UPDATE_RATE)
+		return -1;
+
+	data->lookup_table_update_counter++;
+	data->do_process = 0;
+
+	return data->lookup_table_active;
+}
+
+void v4lprocessing_processing_rows(struct v4lprocessing_data *data,
+		unsigned char *buf, const struct v4l2_format *fmt)
+{
+	v4lprocessing_do_processing(data, buf, fmt);
+}
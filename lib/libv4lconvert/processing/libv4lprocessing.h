@@ -40,4 +40,14 @@ int v4lprocessing_pre_processing(struct v4lprocessing_data *data);
 void v4lprocessing_processing(struct v4lprocessing_data *data,
   unsigned char *buf, const struct v4l2_format *fmt);
 
+/* Processing of an rgb24 / bgr24 frame a few rows at a time, instead of
+   v4lprocessing_processing(). Returns -1 if the lookup tables get updated
+   from this frame, it must then go to v4lprocessing_processing() as a
+   whole. Otherwise the frame counts as processed, and if 1 is returned
+   all its rows must be passed to v4lprocessing_processing_rows(), with
+   fmt describing the rows. */
+int v4lprocessing_begin_rows(struct v4lprocessing_data *data);
+void v4lprocessing_processing_rows(struct v4lprocessing_data *data,
+  unsigned char *buf, const struct v4l2_format *fmt);
+
 #endif
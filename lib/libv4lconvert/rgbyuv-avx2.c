@@ -0,0 +1,247 @@
+/*
+
+# AVX2 versions of the RGB <-> YUV conversion routines
+
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation; either version 2.1 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335  USA
+
+ */
+
+#include "libv4lconvert-priv.h"
+
+#ifdef V4LCONVERT_SIMD_X86
+
+#include <immintrin.h>
+
+/* only called once v4lconvert_simd_init() found avx2, the rest of the
+   library is built for the baseline cpu */
+#define AVX2 __attribute__((target("avx2")))
+
+/* u1, rg and v1 of the scalar code, for 16 U and V values in 16 bit */
+static inline AVX2 void avx2_chroma(__m256i u, __m256i v,
+		__m256i *u1, __m256i *rg, __m256i *v1)
+{
+	const __m256i c128 = _mm256_set1_epi16(128);
+
+	u = _mm256_sub_epi16(u, c128);
+	v = _mm256_sub_epi16(v, c128);
+	*u1 = _mm256_srai_epi16(_mm256_add_epi16(_mm256_slli_epi16(u, 7), u), 6);
+	*rg = _mm256_srai_epi16(_mm256_add_epi16(
+			_mm256_add_epi16(_mm256_slli_epi16(u, 1), u),
+			_mm256_add_epi16(_mm256_slli_epi16(v, 2),
+					 _mm256_slli_epi16(v, 1))), 3);
+	*v1 = _mm256_srai_epi16(_mm256_add_epi16(_mm256_slli_epi16(v, 1), v), 1);
+}
+
+/* adds the chroma term of 16 pixel pairs to 32 Y values and clips them.
+   Both work in 128 bit lanes, so c must have its 64 bit quarters in the
+   order 0 2 1 3, y0 pixels 0-7 | 8-15 and y1 pixels 16-23 | 24-31. The
+   result is in pixel order. */
+static inline AVX2 __m256i avx2_add_chroma(__m256i y0, __m256i y1, __m256i c)
+{
+	__m256i p = _mm256_packus_epi16(
+			_mm256_add_epi16(y0, _mm256_unpacklo_epi16(c, c)),
+			_mm256_add_epi16(y1, _mm256_unpackhi_epi16(c, c)));
+
+	return _mm256_permute4x64_epi64(p, 0xd8);
+}
+
+/* stores 16 pixels of 3 bytes, given the first, second and third bytes */
+static inline AVX2 void avx2_store_rgb24(unsigned char *dest,
+		__m128i c0, __m128i c1, __m128i c2)
+{
+	__m128i out;
+
+	out = _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(c0, _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1,
+						   -1, 3, -1, -1, 4, -1, -1, 5)),
+		_mm_shuffle_epi8(c1, _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2,
+						   -1, -1, 3, -1, -1, 4, -1, -1))),
+		_mm_shuffle_epi8(c2, _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1,
+						   2, -1, -1, 3, -1, -1, 4, -1)));
+	_mm_storeu_si128((__m128i *)dest, out);
+	out = _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(c0, _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1,
+						   8, -1, -1, 9, -1, -1, 10, -1)),
+		_mm_shuffle_epi8(c1, _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1,
+						   -1, 8, -1, -1, 9, -1, -1, 10))),
+		_mm_shuffle_epi8(c2, _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7,
+						   -1, -1, 8, -1, -1, 9, -1, -1)));
+	_mm_storeu_si128((__m128i *)(dest + 16), out);
+	out = _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(c0, _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13,
+						   -1, -1, 14, -1, -1, 15, -1, -1)),
+		_mm_shuffle_epi8(c1, _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1,
+						   13, -1, -1, 14, -1, -1, 15, -1))),
+		_mm_shuffle_epi8(c2, _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1,
+						   -1, 13, -1, -1, 14, -1, -1, 15)));
+	_mm_storeu_si128((__m128i *)(dest + 32), out);
+}
+
+/* gets the first, second and third bytes of 16 pixels of 3 bytes */
+static inline AVX2 void avx2_load_rgb24(const unsigned char *src,
+		__m128i *c0, __m128i *c1, __m128i *c2)
+{
+	__m128i in0 = _mm_loadu_si128((const __m128i *)src);
+	__m128i in1 = _mm_loadu_si128((const __m128i *)(src + 16));
+	__m128i in2 = _mm_loadu_si128((const __m128i *)(src + 32));
+
+	*c0 = _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(in0, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1,
+						    -1, -1, -1, -1, -1, -1, -1, -1)),
+		_mm_shuffle_epi8(in1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5,
+						    8, 11, 14, -1, -1, -1, -1, -1))),
+		_mm_shuffle_epi8(in2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,
+						    -1, -1, -1, 1, 4, 7, 10, 13)));
+	*c1 = _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(in0, _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1,
+						    -1, -1, -1, -1, -1, -1, -1, -1)),
+		_mm_shuffle_epi8(in1, _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6,
+						    9, 12, 15, -1, -1, -1, -1, -1))),
+		_mm_shuffle_epi8(in2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,
+						    -1, -1, -1, 2, 5, 8, 11, 14)));
+	*c2 = _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(in0, _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1,
+						    -1, -1, -1, -1, -1, -1, -1, -1)),
+		_mm_shuffle_epi8(in1, _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7,
+						    10, 13, -1, -1, -1, -1, -1, -1))),
+		_mm_shuffle_epi8(in2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,
+						    -1, -1, 0, 3, 6, 9, 12, 15)));
+}
+
+static inline AVX2 void avx2_store_pixels(unsigned char *dest,
+		__m256i y0, __m256i y1, __m256i u, __m256i v, int bgr)
+{
+	__m256i u1, rg, v1, r, g, b;
+
+	avx2_chroma(u, v, &u1, &rg, &v1);
+	r = avx2_add_chroma(y0, y1, v1);
+	g = avx2_add_chroma(y0, y1, _mm256_sub_epi16(_mm256_setzero_si256(), rg));
+	b = avx2_add_chroma(y0, y1, u1);
+	if (bgr) {
+		__m256i t = r;
+
+		r = b;
+		b = t;
+	}
+	avx2_store_rgb24(dest, _mm256_castsi256_si128(r),
+			_mm256_castsi256_si128(g), _mm256_castsi256_si128(b));
+	avx2_store_rgb24(dest + 48, _mm256_extracti128_si256(r, 1),
+			_mm256_extracti128_si256(g, 1),
+			_mm256_extracti128_si256(b, 1));
+}
+
+static AVX2 int avx2_yuv422_to_rgb24(const unsigned char *src,
+		unsigned char *dest, int width,
+		enum v4lconvert_yuv422_layout layout, int bgr)
+{
+	const __m256i lo8 = _mm256_set1_epi16(0x00ff);
+	const __m256i lo16 = _mm256_set1_epi32(0xffff);
+	__m256i in0, in1, y0, y1, c0, c1, first, second;
+	int x;
+
+	for (x = 0; x + 32 <= width; x += 32) {
+		in0 = _mm256_loadu_si256((const __m256i *)src);
+		in1 = _mm256_loadu_si256((const __m256i *)(src + 32));
+		if (layout == V4LCONVERT_UYVY) {
+			y0 = _mm256_srli_epi16(in0, 8);
+			y1 = _mm256_srli_epi16(in1, 8);
+			c0 = _mm256_and_si256(in0, lo8);
+			c1 = _mm256_and_si256(in1, lo8);
+		} else {
+			y0 = _mm256_and_si256(in0, lo8);
+			y1 = _mm256_and_si256(in1, lo8);
+			c0 = _mm256_srli_epi16(in0, 8);
+			c1 = _mm256_srli_epi16(in1, 8);
+		}
+		/* packing in lanes gives the pixel pairs in the order
+		   avx2_add_chroma() wants */
+		first = _mm256_packs_epi32(_mm256_and_si256(c0, lo16),
+					   _mm256_and_si256(c1, lo16));
+		second = _mm256_packs_epi32(_mm256_srli_epi32(c0, 16),
+					    _mm256_srli_epi32(c1, 16));
+		if (layout == V4LCONVERT_YVYU)
+			avx2_store_pixels(dest, y0, y1, second, first, bgr);
+		else
+			avx2_store_pixels(dest, y0, y1, first, second, bgr);
+		src += 64;
+		dest += 96;
+	}
+	return x;
+}
+
+static AVX2 int avx2_yuv420_to_rgb24(const unsigned char *ysrc,
+		const unsigned char *usrc, const unsigned char *vsrc,
+		unsigned char *dest, int width, int bgr)
+{
+	__m256i y0, y1, u, v;
+	int x;
+
+	for (x = 0; x + 32 <= width; x += 32) {
+		y0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)ysrc));
+		y1 = _mm256_cvtepu8_epi16(
+				_mm_loadu_si128((const __m128i *)(ysrc + 16)));
+		u = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)usrc));
+		v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)vsrc));
+		avx2_store_pixels(dest, y0, y1,
+				_mm256_permute4x64_epi64(u, 0xd8),
+				_mm256_permute4x64_epi64(v, 0xd8), bgr);
+		ysrc += 32;
+		usrc += 16;
+		vsrc += 16;
+		dest += 96;
+	}
+	return x;
+}
+
+static AVX2 int avx2_rgb24_to_y(const unsigned char *src, unsigned char *dest,
+		int width, int bgr)
+{
+	/* RGB2Y with pmaddwd, 524288 is added as 32 * 16384 */
+	const __m256i coef_rg = _mm256_set1_epi32((16594 << 16) | 8453);
+	const __m256i coef_b = _mm256_set1_epi32((16384 << 16) | 3223);
+	const __m256i c32 = _mm256_set1_epi16(32);
+	__m128i c0, c1, c2;
+	__m256i r, g, b, lo, hi, y;
+	int x;
+
+	for (x = 0; x + 16 <= width; x += 16) {
+		avx2_load_rgb24(src, &c0, &c1, &c2);
+		r = _mm256_cvtepu8_epi16(bgr ? c2 : c0);
+		g = _mm256_cvtepu8_epi16(c1);
+		b = _mm256_cvtepu8_epi16(bgr ? c0 : c2);
+		lo = _mm256_add_epi32(
+			_mm256_madd_epi16(_mm256_unpacklo_epi16(r, g), coef_rg),
+			_mm256_madd_epi16(_mm256_unpacklo_epi16(b, c32), coef_b));
+		hi = _mm256_add_epi32(
+			_mm256_madd_epi16(_mm256_unpackhi_epi16(r, g), coef_rg),
+			_mm256_madd_epi16(_mm256_unpackhi_epi16(b, c32), coef_b));
+		y = _mm256_packs_epi32(_mm256_srli_epi32(lo, 15),
+				       _mm256_srli_epi32(hi, 15));
+		y = _mm256_permute4x64_epi64(_mm256_packus_epi16(y, y), 0x08);
+		_mm_storeu_si128((__m128i *)dest, _mm256_castsi256_si128(y));
+		src += 48;
+		dest += 16;
+	}
+	return x;
+}
+
+/* the 4:2:2 to 4:2:0 kernels are memory bound, sse2 is as fast */
+const struct v4lconvert_simd_ops v4lconvert_simd_avx2 = {
+	.yuv422_to_rgb24 = avx2_yuv422_to_rgb24,
+	.yuv420_to_rgb24 = avx2_yuv420_to_rgb24,
+	.rgb24_to_y = avx2_rgb24_to_y,
+};
+
+#endif
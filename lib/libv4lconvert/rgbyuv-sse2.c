@@ -0,0 +1,231 @@
+/*
+
+# SSE2 versions of the RGB <-> YUV conversion routines
+
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation; either version 2.1 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335  USA
+
+ */
+
+#include "libv4lconvert-priv.h"
+
+#ifdef V4LCONVERT_SIMD_X86
+
+#include <string.h>
+#include <emmintrin.h>
+
+/* sse2 is not part of the i386 baseline, the code is only called once
+   v4lconvert_simd_init() found it */
+#define SSE2 __attribute__((target("sse2")))
+
+/* u1, rg and v1 of the scalar code, for 8 U and V values in 16 bit */
+static inline SSE2 void sse2_chroma(__m128i u, __m128i v,
+		__m128i *u1, __m128i *rg, __m128i *v1)
+{
+	const __m128i c128 = _mm_set1_epi16(128);
+
+	u = _mm_sub_epi16(u, c128);
+	v = _mm_sub_epi16(v, c128);
+	*u1 = _mm_srai_epi16(_mm_add_epi16(_mm_slli_epi16(u, 7), u), 6);
+	*rg = _mm_srai_epi16(_mm_add_epi16(
+			_mm_add_epi16(_mm_slli_epi16(u, 1), u),
+			_mm_add_epi16(_mm_slli_epi16(v, 2), _mm_slli_epi16(v, 1))), 3);
+	*v1 = _mm_srai_epi16(_mm_add_epi16(_mm_slli_epi16(v, 1), v), 1);
+}
+
+/* adds the chroma term of 8 pixel pairs to 16 Y values and clips them */
+static inline SSE2 __m128i sse2_add_chroma(__m128i y0, __m128i y1, __m128i c)
+{
+	return _mm_packus_epi16(_mm_add_epi16(y0, _mm_unpacklo_epi16(c, c)),
+				_mm_add_epi16(y1, _mm_unpackhi_epi16(c, c)));
+}
+
+/* stores 16 pixels of 3 bytes, given the first, second and third bytes */
+static inline SSE2 void sse2_store_rgb24(unsigned char *dest,
+		__m128i c0, __m128i c1, __m128i c2)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i even = _mm_set_epi32(0, -1, 0, -1);
+	__m128i c01[2], c2z[2], px;
+	uint32_t tail;
+	int i;
+
+	c01[0] = _mm_unpacklo_epi8(c0, c1);
+	c01[1] = _mm_unpackhi_epi8(c0, c1);
+	c2z[0] = _mm_unpacklo_epi8(c2, zero);
+	c2z[1] = _mm_unpackhi_epi8(c2, zero);
+	for (i = 0; i < 4; i++) {
+		/* 4 pixels of 4 bytes, the last one 0 */
+		if (i & 1)
+			px = _mm_unpackhi_epi16(c01[i / 2], c2z[i / 2]);
+		else
+			px = _mm_unpacklo_epi16(c01[i / 2], c2z[i / 2]);
+		/* move the odd pixels next to the even ones, then the
+		   upper 6 bytes next to the lower 6 */
+		px = _mm_or_si128(_mm_and_si128(px, even),
+				_mm_srli_epi64(_mm_andnot_si128(even, px), 8));
+		px = _mm_or_si128(_mm_move_epi64(px),
+				_mm_slli_si128(_mm_srli_si128(px, 8), 6));
+		_mm_storel_epi64((__m128i *)dest, px);
+		tail = _mm_cvtsi128_si32(_mm_srli_si128(px, 8));
+		memcpy(dest + 8, &tail, 4);
+		dest += 12;
+	}
+}
+
+static inline SSE2 void sse2_store_pixels(unsigned char *dest,
+		__m128i y0, __m128i y1, __m128i u, __m128i v, int bgr)
+{
+	__m128i u1, rg, v1, r, g, b;
+
+	sse2_chroma(u, v, &u1, &rg, &v1);
+	r = sse2_add_chroma(y0, y1, v1);
+	g = sse2_add_chroma(y0, y1, _mm_sub_epi16(_mm_setzero_si128(), rg));
+	b = sse2_add_chroma(y0, y1, u1);
+	if (bgr)
+		sse2_store_rgb24(dest, b, g, r);
+	else
+		sse2_store_rgb24(dest, r, g, b);
+}
+
+/* splits 16 pixels of packed 4:2:2 into Y and the U and V of each pixel
+   pair, all in 16 bit */
+static inline SSE2 void sse2_split_yuv422(__m128i in0, __m128i in1,
+		enum v4lconvert_yuv422_layout layout,
+		__m128i *y0, __m128i *y1, __m128i *u, __m128i *v)
+{
+	const __m128i lo8 = _mm_set1_epi16(0x00ff);
+	const __m128i lo16 = _mm_set1_epi32(0xffff);
+	__m128i c0, c1, first, second;
+
+	if (layout == V4LCONVERT_UYVY) {
+		*y0 = _mm_srli_epi16(in0, 8);
+		*y1 = _mm_srli_epi16(in1, 8);
+		c0 = _mm_and_si128(in0, lo8);
+		c1 = _mm_and_si128(in1, lo8);
+	} else {
+		*y0 = _mm_and_si128(in0, lo8);
+		*y1 = _mm_and_si128(in1, lo8);
+		c0 = _mm_srli_epi16(in0, 8);
+		c1 = _mm_srli_epi16(in1, 8);
+	}
+	first = _mm_packs_epi32(_mm_and_si128(c0, lo16), _mm_and_si128(c1, lo16));
+	second = _mm_packs_epi32(_mm_srli_epi32(c0, 16), _mm_srli_epi32(c1, 16));
+	if (layout == V4LCONVERT_YVYU) {
+		*u = second;
+		*v = first;
+	} else {
+		*u = first;
+		*v = second;
+	}
+}
+
+static SSE2 int sse2_yuv422_to_rgb24(const unsigned char *src,
+		unsigned char *dest, int width,
+		enum v4lconvert_yuv422_layout layout, int bgr)
+{
+	__m128i y0, y1, u, v;
+	int x;
+
+	for (x = 0; x + 16 <= width; x += 16) {
+		sse2_split_yuv422(_mm_loadu_si128((const __m128i *)src),
+				_mm_loadu_si128((const __m128i *)(src + 16)),
+				layout, &y0, &y1, &u, &v);
+		sse2_store_pixels(dest, y0, y1, u, v, bgr);
+		src += 32;
+		dest += 48;
+	}
+	return x;
+}
+
+static SSE2 int sse2_yuv420_to_rgb24(const unsigned char *ysrc,
+		const unsigned char *usrc, const unsigned char *vsrc,
+		unsigned char *dest, int width, int bgr)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i y, u, v;
+	int x;
+
+	for (x = 0; x + 16 <= width; x += 16) {
+		y = _mm_loadu_si128((const __m128i *)ysrc);
+		u = _mm_loadl_epi64((const __m128i *)usrc);
+		v = _mm_loadl_epi64((const __m128i *)vsrc);
+		sse2_store_pixels(dest, _mm_unpacklo_epi8(y, zero),
+				_mm_unpackhi_epi8(y, zero),
+				_mm_unpacklo_epi8(u, zero),
+				_mm_unpacklo_epi8(v, zero), bgr);
+		ysrc += 16;
+		usrc += 8;
+		vsrc += 8;
+		dest += 48;
+	}
+	return x;
+}
+
+static SSE2 int sse2_yuv422_to_y(const unsigned char *src, unsigned char *dest,
+		int width, enum v4lconvert_yuv422_layout layout)
+{
+	__m128i y0, y1, u, v;
+	int x;
+
+	for (x = 0; x + 16 <= width; x += 16) {
+		sse2_split_yuv422(_mm_loadu_si128((const __m128i *)src),
+				_mm_loadu_si128((const __m128i *)(src + 16)),
+				layout, &y0, &y1, &u, &v);
+		_mm_storeu_si128((__m128i *)dest, _mm_packus_epi16(y0, y1));
+		src += 32;
+		dest += 16;
+	}
+	return x;
+}
+
+/* (a + b) / 2 rounded down like the scalar code, pavgb rounds up */
+static inline SSE2 __m128i sse2_avg_down(__m128i a, __m128i b)
+{
+	return _mm_sub_epi8(_mm_avg_epu8(a, b),
+			_mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+}
+
+static SSE2 int sse2_yuv422_to_uv(const unsigned char *src,
+		const unsigned char *src1, unsigned char *udest,
+		unsigned char *vdest, int width,
+		enum v4lconvert_yuv422_layout layout)
+{
+	__m128i avg0, avg1, y0, y1, u, v;
+	int x;
+
+	for (x = 0; x + 16 <= width; x += 16) {
+		avg0 = sse2_avg_down(_mm_loadu_si128((const __m128i *)src),
+				_mm_loadu_si128((const __m128i *)src1));
+		avg1 = sse2_avg_down(_mm_loadu_si128((const __m128i *)(src + 16)),
+				_mm_loadu_si128((const __m128i *)(src1 + 16)));
+		sse2_split_yuv422(avg0, avg1, layout, &y0, &y1, &u, &v);
+		_mm_storel_epi64((__m128i *)udest, _mm_packus_epi16(u, u));
+		_mm_storel_epi64((__m128i *)vdest, _mm_packus_epi16(v, v));
+		src += 32;
+		src1 += 32;
+		udest += 8;
+		vdest += 8;
+	}
+	return x;
+}
+
+const struct v4lconvert_simd_ops v4lconvert_simd_sse2 = {
+	.yuv422_to_rgb24 = sse2_yuv422_to_rgb24,
+	.yuv420_to_rgb24 = sse2_yuv420_to_rgb24,
+	.yuv422_to_y = sse2_yuv422_to_y,
+	.yuv422_to_uv = sse2_yuv422_to_uv,
+};
+
+#endif
@@ -22,9 +22,47 @@
 
  */
 
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include "libv4lconvert-priv.h"
 
+struct v4lconvert_simd_ops v4lconvert_simd;
+
+static pthread_once_t v4lconvert_simd_once = PTHREAD_ONCE_INIT;
+
+static void v4lconvert_simd_select(void)
+{
+	/* LIBV4LCONVERT_NO_SIMD=1 forces the scalar code, to compare results */
+	if (getenv("LIBV4LCONVERT_NO_SIMD"))
+		return;
+#ifdef V4LCONVERT_SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		v4lconvert_simd = v4lconvert_simd_sse2;
+	if (__builtin_cpu_supports("avx2")) {
+		/* the avx2 code only has the kernels which gain from it */
+		const struct v4lconvert_simd_ops *avx2 = &v4lconvert_simd_avx2;
+
+		if (avx2->yuv422_to_rgb24)
+			v4lconvert_simd.yuv422_to_rgb24 = avx2->yuv422_to_rgb24;
+		if (avx2->yuv420_to_rgb24)
+			v4lconvert_simd.yuv420_to_rgb24 = avx2->yuv420_to_rgb24;
+		if (avx2->yuv422_to_y)
+			v4lconvert_simd.yuv422_to_y = avx2->yuv422_to_y;
+		if (avx2->yuv422_to_uv)
+			v4lconvert_simd.yuv422_to_uv = avx2->yuv422_to_uv;
+		if (avx2->rgb24_to_y)
+			v4lconvert_simd.rgb24_to_y = avx2->rgb24_to_y;
+	}
+#endif
+}
+
+void v4lconvert_simd_init(void)
+{
+	pthread_once(&v4lconvert_simd_once, v4lconvert_simd_select);
+}
+
 #define RGB2Y(r, g, b, y) \
 	(y) = ((8453 * (r) + 16594 * (g) + 3223 * (b) + 524288) >> 15)
 
@@ -35,14 +73,17 @@
 	} while (0)
 
 void v4lconvert_rgb24_to_yuv420(const unsigned char *src, unsigned char *dest,
-		const struct v4l2_format *src_fmt, int bgr, int yvu)
+		const struct v4l2_format *src_fmt, int dest_stride, int bgr, int yvu)
 {
 	int x, y;
 	unsigned char *udest, *vdest;
 
 	/* Y */
 	for (y = 0; y < src_fmt->fmt.pix.height; y++) {
-		for (x = 0; x < src_fmt->fmt.pix.width; x++) {
+		x = V4LCONVERT_SIMD(rgb24_to_y, src, dest, src_fmt->fmt.pix.width, bgr);
+		src += 3 * x;
+		dest += x;
+		for (; x < src_fmt->fmt.pix.width; x++) {
 			if (bgr)
 				RGB2Y(src[2], src[1], src[0], *dest++);
 			else
@@ -50,16 +91,17 @@ void v4lconvert_rgb24_to_yuv420(const unsigned char *src, unsigned char *dest,
 			src += 3;
 		}
 		src += src_fmt->fmt.pix.bytesperline - 3 * src_fmt->fmt.pix.width;
+		dest += dest_stride - src_fmt->fmt.pix.width;
 	}
 	src -= src_fmt->fmt.pix.height * src_fmt->fmt.pix.bytesperline;
 
 	/* U + V */
 	if (yvu) {
 		vdest = dest;
-		udest = dest + src_fmt->fmt.pix.width * src_fmt->fmt.pix.height / 4;
+		udest = dest + dest_stride * src_fmt->fmt.pix.height / 4;
 	} else {
 		udest = dest;
-		vdest = dest + src_fmt->fmt.pix.width * src_fmt->fmt.pix.height / 4;
+		vdest = dest + dest_stride * src_fmt->fmt.pix.height / 4;
 	}
 
 	for (y = 0; y < src_fmt->fmt.pix.height / 2; y++) {
@@ -79,6 +121,8 @@ void v4lconvert_rgb24_to_yuv420(const unsigned char *src, unsigned char *dest,
 			src += 6;
 		}
 		src += 2 * src_fmt->fmt.pix.bytesperline - 3 * src_fmt->fmt.pix.width;
+		udest += dest_stride / 2 - src_fmt->fmt.pix.width / 2;
+		vdest += dest_stride / 2 - src_fmt->fmt.pix.width / 2;
 	}
 }
 
@@ -92,7 +136,7 @@ void v4lconvert_rgb24_to_yuv420(const unsigned char *src, unsigned char *dest,
 #define CLIP(color) (unsigned char)(((color) > 0xFF) ? 0xff : (((color) < 0) ? 0 : (color)))
 
 void v4lconvert_yuv420_to_bgr24(const unsigned char *src, unsigned char *dest,
-		int width, int height, int yvu)
+		int width, int height, int src_stride, int dest_stride, int yvu)
 {
 	int i, j;
 
@@ -100,15 +144,21 @@ void v4lconvert_yuv420_to_bgr24(const unsigned char *src, unsigned char *dest,
 	const unsigned char *usrc, *vsrc;
 
 	if (yvu) {
-		vsrc = src + width * height;
-		usrc = vsrc + (width * height) / 4;
+		vsrc = src + src_stride * height;
+		usrc = vsrc + (src_stride * height) / 4;
 	} else {
-		usrc = src + width * height;
-		vsrc = usrc + (width * height) / 4;
+		usrc = src + src_stride * height;
+		vsrc = usrc + (src_stride * height) / 4;
 	}
 
 	for (i = 0; i < height; i++) {
-		for (j = 0; j < width; j += 2) {
+		j = V4LCONVERT_SIMD(yuv420_to_rgb24, ysrc, usrc, vsrc, dest,
+				width, 1);
+		ysrc += j;
+		usrc += j / 2;
+		vsrc += j / 2;
+		dest += 3 * j;
+		for (; j < width; j += 2) {
 #if 1 /* fast slightly less accurate multiplication free code */
 			int u1 = (((*usrc - 128) << 7) +  (*usrc - 128)) >> 6;
 			int rg = (((*usrc - 128) << 1) +  (*usrc - 128) +
@@ -137,16 +187,21 @@ void v4lconvert_yuv420_to_bgr24(const unsigned char *src, unsigned char *dest,
 			usrc++;
 			vsrc++;
 		}
+		ysrc += src_stride - width;
+		dest += dest_stride - width * 3;
 		/* Rewind u and v for next line */
 		if (!(i & 1)) {
 			usrc -= width / 2;
 			vsrc -= width / 2;
+		} else {
+			usrc += src_stride / 2 - width / 2;
+			vsrc += src_stride / 2 - width / 2;
 		}
 	}
 }
 
 void v4lconvert_yuv420_to_rgb24(const unsigned char *src, unsigned char *dest,
-		int width, int height, int yvu)
+		int width, int height, int src_stride, int dest_stride, int yvu)
 {
 	int i, j;
 
@@ -154,15 +209,21 @@ void v4lconvert_yuv420_to_rgb24(const unsigned char *src, unsigned char *dest,
 	const unsigned char *usrc, *vsrc;
 
 	if (yvu) {
-		vsrc = src + width * height;
-		usrc = vsrc + (width * height) / 4;
+		vsrc = src + src_stride * height;
+		usrc = vsrc + (src_stride * height) / 4;
 	} else {
-		usrc = src + width * height;
-		vsrc = usrc + (width * height) / 4;
+		usrc = src + src_stride * height;
+		vsrc = usrc + (src_stride * height) / 4;
 	}
 
 	for (i = 0; i < height; i++) {
-		for (j = 0; j < width; j += 2) {
+		j = V4LCONVERT_SIMD(yuv420_to_rgb24, ysrc, usrc, vsrc, dest,
+				width, 0);
+		ysrc += j;
+		usrc += j / 2;
+		vsrc += j / 2;
+		dest += 3 * j;
+		for (; j < width; j += 2) {
 #if 1 /* fast slightly less accurate multiplication free code */
 			int u1 = (((*usrc - 128) << 7) +  (*usrc - 128)) >> 6;
 			int rg = (((*usrc - 128) << 1) +  (*usrc - 128) +
@@ -191,21 +252,30 @@ void v4lconvert_yuv420_to_rgb24(const unsigned char *src, unsigned char *dest,
 			usrc++;
 			vsrc++;
 		}
+		ysrc += src_stride - width;
+		dest += dest_stride - width * 3;
 		/* Rewind u and v for next line */
 		if (!(i&1)) {
 			usrc -= width / 2;
 			vsrc -= width / 2;
+		} else {
+			usrc += src_stride / 2 - width / 2;
+			vsrc += src_stride / 2 - width / 2;
 		}
 	}
 }
 
 void v4lconvert_yuyv_to_bgr24(const unsigned char *src, unsigned char *dest,
-		int width, int height, int stride)
+		int width, int height, int src_stride, int dest_stride)
 {
 	int j;
 
 	while (--height >= 0) {
-		for (j = 0; j + 1 < width; j += 2) {
+		j = V4LCONVERT_SIMD(yuv422_to_rgb24, src, dest, width,
+				V4LCONVERT_YUYV, 1);
+		src += 2 * j;
+		dest += 3 * j;
+		for (; j + 1 < width; j += 2) {
 			int u = src[1];
 			int v = src[3];
 			int u1 = (((u - 128) << 7) +  (u - 128)) >> 6;
@@ -222,17 +292,22 @@ void v4lconvert_yuyv_to_bgr24(const unsigned char *src, unsigned char *dest,
 			*dest++ = CLIP(src[2] + v1);
 			src += 4;
 		}
-		src += stride - width * 2;
+		src += src_stride - width * 2;
+		dest += dest_stride - width * 3;
 	}
 }
 
 void v4lconvert_yuyv_to_rgb24(const unsigned char *src, unsigned char *dest,
-		int width, int height, int stride)
+		int width, int height, int src_stride, int dest_stride)
 {
 	int j;
 
 	while (--height >= 0) {
-		for (j = 0; j + 1 < width; j += 2) {
+		j = V4LCONVERT_SIMD(yuv422_to_rgb24, src, dest, width,
+				V4LCONVERT_YUYV, 0);
+		src += 2 * j;
+		dest += 3 * j;
+		for (; j + 1 < width; j += 2) {
 			int u = src[1];
 			int v = src[3];
 			int u1 = (((u - 128) << 7) +  (u - 128)) >> 6;
@@ -249,12 +324,13 @@ void v4lconvert_yuyv_to_rgb24(const unsigned char *src, unsigned char *dest,
 			*dest++ = CLIP(src[2] + u1);
 			src += 4;
 		}
-		src += stride - (width * 2);
+		src += src_stride - width * 2;
+		dest += dest_stride - width * 3;
 	}
 }
 
 void v4lconvert_yuyv_to_yuv420(const unsigned char *src, unsigned char *dest,
-		int width, int height, int stride, int yvu)
+		int width, int height, int src_stride, int dest_stride, int yvu)
 {
 	int i, j;
 	const unsigned char *src1;
@@ -263,44 +339,61 @@ void v4lconvert_yuyv_to_yuv420(const unsigned char *src, unsigned char *dest,
 	/* copy the Y values */
 	src1 = src;
 	for (i = 0; i < height; i++) {
-		for (j = 0; j + 1 < width; j += 2) {
+		j = V4LCONVERT_SIMD(yuv422_to_y, src1, dest, width,
+				V4LCONVERT_YUYV);
+		src1 += 2 * j;
+		dest += j;
+		for (; j + 1 < width; j += 2) {
 			*dest++ = src1[0];
 			*dest++ = src1[2];
 			src1 += 4;
 		}
-		src1 += stride - width * 2;
+		src1 += src_stride - width * 2;
+		dest += dest_stride - width;
 	}
 
 	/* copy the U and V values */
 	src++;				/* point to V */
-	src1 = src + stride;		/* next line */
+	src1 = src + src_stride;	/* next line */
 	if (yvu) {
 		vdest = dest;
-		udest = dest + width * height / 4;
+		udest = dest + dest_stride * height / 4;
 	} else {
 		udest = dest;
-		vdest = dest + width * height / 4;
+		vdest = dest + dest_stride * height / 4;
 	}
 	for (i = 0; i < height; i += 2) {
-		for (j = 0; j + 1 < width; j += 2) {
+		j = V4LCONVERT_SIMD(yuv422_to_uv, src - 1, src1 - 1, udest, vdest,
+				width, V4LCONVERT_YUYV);
+		src += 2 * j;
+		src1 += 2 * j;
+		udest += j / 2;
+		vdest += j / 2;
+		for (; j + 1 < width; j += 2) {
 			*udest++ = ((int) src[0] + src1[0]) / 2;	/* U */
 			*vdest++ = ((int) src[2] + src1[2]) / 2;	/* V */
 			src += 4;
 			src1 += 4;
 		}
-		src1 += stride - width * 2;
+		src1 += src_stride - width * 2;
 		src = src1;
-		src1 += stride;
+		src1 += src_stride;
+		udest += dest_stride / 2 - width / 2;
+		vdest += dest_stride / 2 - width / 2;
 	}
 }
 
 void v4lconvert_yvyu_to_bgr24(const unsigned char *src, unsigned char *dest,
-		int width, int height, int stride)
+		int width, int height, int src_stride, int dest_stride)
 {
 	int j;
 
 	while (--height >= 0) {
-		for (j = 0; j + 1 < width; j += 2) {
+		j = V4LCONVERT_SIMD(yuv422_to_rgb24, src, dest, width,
+				V4LCONVERT_YVYU, 1);
+		src += 2 * j;
+		dest += 3 * j;
+		for (; j + 1 < width; j += 2) {
 			int u = src[3];
 			int v = src[1];
 			int u1 = (((u - 128) << 7) +  (u - 128)) >> 6;
@@ -317,17 +410,22 @@ void v4lconvert_yvyu_to_bgr24(const unsigned char *src, unsigned char *dest,
 			*dest++ = CLIP(src[2] + v1);
 			src += 4;
 		}
-		src += stride - (width * 2);
+		src += src_stride - width * 2;
+		dest += dest_stride - width * 3;
 	}
 }
 
 void v4lconvert_yvyu_to_rgb24(const unsigned char *src, unsigned char *dest,
-		int width, int height, int stride)
+		int width, int height, int src_stride, int dest_stride)
 {
 	int j;
 
 	while (--height >= 0) {
-		for (j = 0; j + 1 < width; j += 2) {
+		j = V4LCONVERT_SIMD(yuv422_to_rgb24, src, dest, width,
+				V4LCONVERT_YVYU, 0);
+		src += 2 * j;
+		dest += 3 * j;
+		for (; j + 1 < width; j += 2) {
 			int u = src[3];
 			int v = src[1];
 			int u1 = (((u - 128) << 7) +  (u - 128)) >> 6;
@@ -344,17 +442,22 @@ void v4lconvert_yvyu_to_rgb24(const unsigned char *src, unsigned char *dest,
 			*dest++ = CLIP(src[2] + u1);
 			src += 4;
 		}
-		src += stride - (width * 2);
+		src += src_stride - width * 2;
+		dest += dest_stride - width * 3;
 	}
 }
 
 void v4lconvert_uyvy_to_bgr24(const unsigned char *src, unsigned char *dest,
-		int width, int height, int stride)
+		int width, int height, int src_stride, int dest_stride)
 {
 	int j;
 
 	while (--height >= 0) {
-		for (j = 0; j + 1 < width; j += 2) {
+		j = V4LCONVERT_SIMD(yuv422_to_rgb24, src, dest, width,
+				V4LCONVERT_UYVY, 1);
+		src += 2 * j;
+		dest += 3 * j;
+		for (; j + 1 < width; j += 2) {
 			int u = src[0];
 			int v = src[2];
 			int u1 = (((u - 128) << 7) +  (u - 128)) >> 6;
@@ -371,17 +474,22 @@ void v4lconvert_uyvy_to_bgr24(const unsigned char *src, unsigned char *dest,
 			*dest++ = CLIP(src[3] + v1);
 			src += 4;
 		}
-		src += stride - width * 2;
+		src += src_stride - width * 2;
+		dest += dest_stride - width * 3;
 	}
 }
 
 void v4lconvert_uyvy_to_rgb24(const unsigned char *src, unsigned char *dest,
-		int width, int height, int stride)
+		int width, int height, int src_stride, int dest_stride)
 {
 	int j;
 
 	while (--height >= 0) {
-		for (j = 0; j + 1 < width; j += 2) {
+		j = V4LCONVERT_SIMD(yuv422_to_rgb24, src, dest, width,
+				V4LCONVERT_UYVY, 0);
+		src += 2 * j;
+		dest += 3 * j;
+		for (; j + 1 < width; j += 2) {
 			int u = src[0];
 			int v = src[2];
 			int u1 = (((u - 128) << 7) +  (u - 128)) >> 6;
@@ -398,12 +506,13 @@ void v4lconvert_uyvy_to_rgb24(const unsigned char *src, unsigned char *dest,
 			*dest++ = CLIP(src[3] + u1);
 			src += 4;
 		}
-		src += stride - width * 2;
+		src += src_stride - width * 2;
+		dest += dest_stride - width * 3;
 	}
 }
 
 void v4lconvert_uyvy_to_yuv420(const unsigned char *src, unsigned char *dest,
-		int width, int height, int stride, int yvu)
+		int width, int height, int src_stride, int dest_stride, int yvu)
 {
 	int i, j;
 	const unsigned char *src1;
@@ -412,60 +521,77 @@ void v4lconvert_uyvy_to_yuv420(const unsigned char *src, unsigned char *dest,
 	/* copy the Y values */
 	src1 = src;
 	for (i = 0; i < height; i++) {
-		for (j = 0; j + 1 < width; j += 2) {
+		j = V4LCONVERT_SIMD(yuv422_to_y, src1, dest, width,
+				V4LCONVERT_UYVY);
+		src1 += 2 * j;
+		dest += j;
+		for (; j + 1 < width; j += 2) {
 			*dest++ = src1[1];
 			*dest++ = src1[3];
 			src1 += 4;
 		}
-		src1 += stride - width * 2;
+		src1 += src_stride - width * 2;
+		dest += dest_stride - width;
 	}
 
 	/* copy the U and V values */
-	src1 = src + stride;		/* next line */
+	src1 = src + src_stride;	/* next line */
 	if (yvu) {
 		vdest = dest;
-		udest = dest + width * height / 4;
+		udest = dest + dest_stride * height / 4;
 	} else {
 		udest = dest;
-		vdest = dest + width * height / 4;
+		vdest = dest + dest_stride * height / 4;
 	}
 	for (i = 0; i < height; i += 2) {
-		for (j = 0; j + 1 < width; j += 2) {
+		j = V4LCONVERT_SIMD(yuv422_to_uv, src, src1, udest, vdest,
+				width, V4LCONVERT_UYVY);
+		src += 2 * j;
+		src1 += 2 * j;
+		udest += j / 2;
+		vdest += j / 2;
+		for (; j + 1 < width; j += 2) {
 			*udest++ = ((int) src[0] + src1[0]) / 2;	/* U */
 			*vdest++ = ((int) src[2] + src1[2]) / 2;	/* V */
 			src += 4;
 			src1 += 4;
 		}
-		src1 += stride - width * 2;
+		src1 += src_stride - width * 2;
 		src = src1;
-		src1 += stride;
+		src1 += src_stride;
+		udest += dest_stride / 2 - width / 2;
+		vdest += dest_stride / 2 - width / 2;
 	}
 }
 
 void v4lconvert_swap_rgb(const unsigned char *src, unsigned char *dst,
-		int width, int height)
+		int width, int height, int src_stride, int dest_stride)
 {
-	int i;
+	int i, j;
 
-	for (i = 0; i < (width * height); i++) {
-		unsigned char tmp0, tmp1;
-		tmp0 = *src++;
-		tmp1 = *src++;
-		*dst++ = *src++;
-		*dst++ = tmp1;
-		*dst++ = tmp0;
+	for (j = 0; j < height; j++) {
+		for (i = 0; i < width; i++) {
+			unsigned char tmp0, tmp1;
+			tmp0 = *src++;
+			tmp1 = *src++;
+			*dst++ = *src++;
+			*dst++ = tmp1;
+			*dst++ = tmp0;
+		}
+		src += src_stride - width * 3;
+		dst += dest_stride - width * 3;
 	}
 }
 
 void v4lconvert_swap_uv(const unsigned char *src, unsigned char *dest,
-		const struct v4l2_format *src_fmt)
+		const struct v4l2_format *src_fmt, int dest_stride)
 {
 	int y;
 
 	/* Copy Y */
 	for (y = 0; y < src_fmt->fmt.pix.height; y++) {
 		memcpy(dest, src, src_fmt->fmt.pix.width);
-		dest += src_fmt->fmt.pix.width;
+		dest += dest_stride;
 		src += src_fmt->fmt.pix.bytesperline;
 	}
 
@@ -473,7 +599,7 @@ void v4lconvert_swap_uv(const unsigned char *src, unsigned char *dest,
 	src += src_fmt->fmt.pix.height * src_fmt->fmt.pix.bytesperline / 4;
 	for (y = 0; y < src_fmt->fmt.pix.height / 2; y++) {
 		memcpy(dest, src, src_fmt->fmt.pix.width / 2);
-		dest += src_fmt->fmt.pix.width / 2;
+		dest += dest_stride / 2;
 		src += src_fmt->fmt.pix.bytesperline / 2;
 	}
 
@@ -481,7 +607,7 @@ void v4lconvert_swap_uv(const unsigned char *src, unsigned char *dest,
 	src -= src_fmt->fmt.pix.height * src_fmt->fmt.pix.bytesperline / 2;
 	for (y = 0; y < src_fmt->fmt.pix.height / 2; y++) {
 		memcpy(dest, src, src_fmt->fmt.pix.width / 2);
-		dest += src_fmt->fmt.pix.width / 2;
+		dest += dest_stride / 2;
 		src += src_fmt->fmt.pix.bytesperline / 2;
 	}
 }
@@ -0,0 +1,147 @@
+/*
+
+# Worker threads for converting a frame in horizontal bands
+
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation; either version 2.1 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA  02110-1335  USA
+
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "libv4lconvert-priv.h"
+
+struct v4lconvert_threads {
+	pthread_mutex_t lock;
+	pthread_cond_t work_cond; /* signalled when there are bands to do */
+	pthread_cond_t done_cond; /* signalled when the last band is done */
+	pthread_t *threads;
+	int count;
+	int quit;
+	/* The current job */
+	void (*func)(void *arg, int band, int bands);
+	void *arg;
+	int bands;
+	int next_band;
+	int pending;
+};
+
+/* Takes bands until none are left, called with the lock held */
+static void v4lconvert_threads_work(struct v4lconvert_threads *threads)
+{
+	while (threads->next_band < threads->bands) {
+		int band = threads->next_band++;
+
+		pthread_mutex_unlock(&threads->lock);
+		threads->func(threads->arg, band, threads->bands);
+		pthread_mutex_lock(&threads->lock);
+		if (--threads->pending == 0)
+			pthread_cond_signal(&threads->done_cond);
+	}
+}
+
+static void *v4lconvert_threads_main(void *arg)
+{
+	struct v4lconvert_threads *threads = arg;
+
+	pthread_mutex_lock(&threads->lock);
+	while (!threads->quit) {
+		v4lconvert_threads_work(threads);
+		pthread_cond_wait(&threads->work_cond, &threads->lock);
+	}
+	pthread_mutex_unlock(&threads->lock);
+
+	return NULL;
+}
+
+struct v4lconvert_threads *v4lconvert_threads_create(int count)
+{
+	struct v4lconvert_threads *threads;
+
+	threads = calloc(1, sizeof(*threads));
+	if (!threads)
+		return NULL;
+
+	threads->threads = calloc(count, sizeof(pthread_t));
+	if (!threads->threads) {
+		free(threads);
+		return NULL;
+	}
+
+	pthread_mutex_init(&threads->lock, NULL);
+	pthread_cond_init(&threads->work_cond, NULL);
+	pthread_cond_init(&threads->done_cond, NULL);
+
+	for (; threads->count < count; threads->count++)
+		if (pthread_create(&threads->threads[threads->count], NULL,
+				v4lconvert_threads_main, threads))
+			break;
+
+	if (threads->count == 0) {
+		v4lconvert_threads_destroy(threads);
+		return NULL;
+	}
+
+	return threads;
+}
+
+void v4lconvert_threads_destroy(struct v4lconvert_threads *threads)
+{
+	int i;
+
+	if (!threads)
+		return;
+
+	pthread_mutex_lock(&threads->lock);
+	threads->quit = 1;
+	pthread_cond_broadcast(&threads->work_cond);
+	pthread_mutex_unlock(&threads->lock);
+
+	for (i = 0; i < threads->count; i++)
+		pthread_join(threads->threads[i], NULL);
+
+	pthread_cond_destroy(&threads->done_cond);
+	pthread_cond_destroy(&threads->work_cond);
+	pthread_mutex_destroy(&threads->lock);
+	free(threads->threads);
+	free(threads);
+}
+
+/* The calling thread counts as one of the workers */
+int v4lconvert_threads_max_bands(struct v4lconvert_threads *threads)
+{
+	return threads ? threads->count + 1 : 1;
+}
+
+void v4lconvert_threads_run(struct v4lconvert_threads *threads, int bands,
+		void (*func)(void *arg, int band, int bands), void *arg)
+{
+	if (!threads || bands <= 1) {
+		func(arg, 0, 1);
+		return;
+	}
+
+	pthread_mutex_lock(&threads->lock);
+	threads->func = func;
+	threads->arg = arg;
+	threads->bands = bands;
+	threads->next_band = 0;
+	threads->pending = bands;
+	pthread_cond_broadcast(&threads->work_cond);
+
+	v4lconvert_threads_work(threads);
+	while (threads->pending)
+		pthread_cond_wait(&threads->done_cond, &threads->lock);
+	pthread_mutex_unlock(&threads->lock);
+}
@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <wchar.h>
 #include <locale.h>
 #include <inttypes.h>
@@ -31,7 +32,9 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
 #include <sys/ioctl.h>
+#include <sys/epoll.h>
 #include <sys/time.h>
 #include <dirent.h>
 #include <config.h>
@@ -49,6 +52,25 @@
 
 #define ARRAY_SIZE(arr) ((int)(sizeof(arr) / sizeof((arr)[0])))
 
+/* maximum number of RDS blocks fetched by one read() call */
+#define RDS_READ_BLOCKS 64
+
+/* size of the TMC message store of --print-tmc */
+#define RDS_TMC_MESSAGES 1000
+
+/* number of groups kept in the ring of --publish, 30s of RDS */
+#define RDS_SHM_GROUPS 512
+/* --subscribe: interval between two reads of the published state, in ms */
+#define RDS_SHM_POLL_MS 100
+
+/* --scan: time to wait for a PI code on a frequency, in ms */
+#define RDS_SCAN_PI_WAIT 1000
+/* --scan: time to wait for the AFs once PS was received, in ms */
+#define RDS_SCAN_AF_WAIT 1000
+
+/* duration of a group in ms, 104 bits at 1187.5 bit/s */
+#define RDS_GROUP_MS (104 * 1000 / 1187.5)
+
 typedef std::vector<std::string> dev_vec;
 typedef std::map<std::string, std::string> dev_map;
 
@@ -70,12 +92,21 @@ enum Option {
 	OptSetTuner = 't',
 	OptUseWrapper = 'w',
 	OptAll = 128,
+	OptCapture,
 	OptFreqSeek,
+	OptJson,
 	OptListDevices,
 	OptListFreqBands,
 	OptOpenFile,
 	OptPrintBlock,
+	OptPrintMetrics,
+	OptPrintTmc,
+	OptPublish,
+	OptReadRdsAll,
+	OptScan,
+	OptSeek,
 	OptSilent,
+	OptSubscribe,
 	OptTunerIndex,
 	OptVerbose,
 	OptWaitLimit,
@@ -91,6 +122,21 @@ struct ctl_parameters {
 	uint32_t wait_limit;
 	uint8_t tuner_index;
 	struct v4l2_hw_freq_seek freq_seek;
+	const char *capture_name;
+	struct v4l2_rds_capture *capture;	/* capture file being written */
+	uint32_t capture_freq;		/* tuner frequency in Hz */
+	uint32_t seek;			/* replay start, seconds into a capture */
+	struct v4l2_rds_tmc *tmc;	/* TMC message store for --print-tmc */
+	uint32_t tmc_seq;		/* last printed change of the store */
+	time_t tmc_time;		/* last expiry run */
+	uint32_t metrics_blocks;	/* --print-metrics interval in blocks */
+	const char *scan_name;		/* --scan station database */
+	uint32_t scan_step;		/* --scan step in Hz */
+	int scan_hwseek;		/* --scan uses hardware seek, -1 = if
+					 * the tuner supports it */
+	uint32_t scan_timeout;		/* --scan maximum time per frequency in ms */
+	const char *shm_name;		/* --publish / --subscribe segment */
+	struct v4l2_rds_shm *shm;	/* segment the decoder publishes in */
 };
 
 static struct ctl_parameters params;
@@ -98,6 +144,7 @@ static int app_result;
 
 static struct option long_options[] = {
 	{"all", no_argument, 0, OptAll},
+	{"capture", required_argument, 0, OptCapture},
 	{"device", required_argument, 0, OptSetDevice},
 	{"file", required_argument, 0, OptOpenFile},
 	{"freq-seek", required_argument, 0, OptFreqSeek},
@@ -105,11 +152,19 @@ static struct option long_options[] = {
 	{"get-tuner", no_argument, 0, OptGetTuner},
 	{"help", no_argument, 0, OptHelp},
 	{"info", no_argument, 0, OptGetDriverInfo},
+	{"json", no_argument, 0, OptJson},
 	{"list-devices", no_argument, 0, OptListDevices},
 	{"list-freq-bands", no_argument, 0, OptListFreqBands},
 	{"print-block", no_argument, 0, OptPrintBlock},
+	{"print-metrics", required_argument, 0, OptPrintMetrics},
+	{"print-tmc", no_argument, 0, OptPrintTmc},
+	{"publish", required_argument, 0, OptPublish},
 	{"read-rds", no_argument, 0, OptReadRds},
+	{"read-rds-all", no_argument, 0, OptReadRdsAll},
+	{"scan", required_argument, 0, OptScan},
+	{"seek", required_argument, 0, OptSeek},
 	{"set-freq", required_argument, 0, OptSetFreq},
+	{"subscribe", required_argument, 0, OptSubscribe},
 	{"tuner-index", required_argument, 0, OptTunerIndex},
 	{"verbose", no_argument, 0, OptVerbose},
 	{"wait-limit", required_argument, 0, OptWaitLimit},
@@ -160,16 +215,55 @@ static void usage_rds(void)
 	printf("\nRDS options: \n"
 	       "  -R, --read-rds\n"
 	       "                     enable reading of RDS data from device\n"
+	       "  --read-rds-all\n"
+	       "                     read and decode RDS data from all RDS-capable devices\n"
+	       "                     at once, the output is tagged with the device name\n"
 	       "  --file=<path>\n"
 	       "                     open a RDS stream file dump instead of a device\n"
 	       "                     all General and Tuner Options are disabled in this mode\n"
+	       "                     capture files written with --capture are detected\n"
+	       "  --capture=<path>\n"
+	       "                     record the received RDS blocks with their reception time\n"
+	       "                     and the tuner frequency into a capture file\n"
+	       "  --seek=<s>\n"
+	       "                     start the replay of a capture file <s> seconds after\n"
+	       "                     the start of the capture\n"
+	       "  --scan=file=<path>[,step=<khz>][,hwseek=<0/1>][,timeout=<ms>]\n"
+	       "                     scan the FM band and write the PI, PS, PTY and AFs of\n"
+	       "                     the found stations into the station database <path>,\n"
+	       "                     one JSON object per line. Each frequency is left after\n"
+	       "                     1s without PI, once PS and the AFs were received, or\n"
+	       "                     after <timeout> ms (default: 3000ms).\n"
+	       "                     hwseek=1 steps from station to station with a hardware\n"
+	       "                     seek, hwseek=0 steps by <khz> (default: 100kHz).\n"
+	       "                     default: hardware seek if the tuner supports it\n"
+	       "  --publish=<name>\n"
+	       "                     publish the decoded RDS data and the recently decoded\n"
+	       "                     groups in the POSIX shared memory segment <name>\n"
+	       "                     (e.g. /rds0), for other processes to read\n"
+	       "  --subscribe=<name>\n"
+	       "                     print the RDS data published by another rds-ctl in the\n"
+	       "                     shared memory segment <name>, instead of reading a device.\n"
+	       "                     Can't be combined with --json\n"
 	       "  --wait-limit=<ms>\n"
 	       "                     defines the maximum wait duration for avaibility of new\n"
-	       "                     RDS data\n"
+	       "                     RDS data. All blocks buffered by the driver are read\n"
+	       "                     and decoded as soon as data is available\n"
 	       "                     <default>: 5000ms\n"
 	       "  --print-block\n"
 	       "                     prints all valid RDS fields, whenever a value is updated\n"
 	       "                     instead of printing only updated values\n"
+	       "  --json\n"
+	       "                     print one JSON object per line for each group that\n"
+	       "                     updated fields, holding the group type, the PI and the\n"
+	       "                     updated fields. With --print-block all valid fields are\n"
+	       "                     printed, with --verbose every group and its blocks\n"
+	       "  --print-metrics=<s>\n"
+	       "                     print reception quality metrics every <s> seconds of\n"
+	       "                     received RDS data\n"
+	       "  --print-tmc\n"
+	       "                     decode TMC traffic messages and print new and changed\n"
+	       "                     messages\n"
 	       "  --verbose\n"
 	       "                     turn on verbose mode - every received RDS group\n"
 	       "                     will be printed\n"
@@ -190,6 +284,13 @@ static void signal_handler_interrupt(int signum)
 	params.terminate_decoding = true;
 }
 
+/* informational messages go to stderr with --json, so that stdout only
+ * carries JSON lines */
+static FILE *info_file(void)
+{
+	return params.options[OptJson] ? stderr : stdout;
+}
+
 static int test_open(const char *file, int oflag)
 {
  	return params.options[OptUseWrapper] ? v4l2_open(file, oflag) : open(file, oflag);
@@ -379,24 +480,24 @@ static dev_vec list_devices(void)
 	/* Iterate through all devices, and remove all non-accessible devices
 	 * and all devices that don't offer the RDS_BLOCK_IO capability */
 	for (dev_vec::iterator iter = files.begin();
-			iter != files.end(); ++iter) {
+			iter != files.end(); ) {
 		int fd = open(iter->c_str(), O_RDONLY | O_NONBLOCK);
-		std::string bus_info;
+		int ret;
 
 		if (fd < 0) {
 			iter = files.erase(iter);
 			continue;
 		}
 		memset(&vt, 0, sizeof(vt));
-		if (doioctl(fd, VIDIOC_G_TUNER, &vt) != 0) {
-			close(fd);
-			iter = files.erase(iter);
-			continue;
-		}
+		ret = doioctl(fd, VIDIOC_G_TUNER, &vt);
+		close(fd);
 		/* remove device if it doesn't support rds block I/O */
-		if (!vt.capability & V4L2_TUNER_CAP_RDS_BLOCK_IO)
+		if (ret != 0 || !(vt.capability & V4L2_TUNER_CAP_RDS_BLOCK_IO))
 			iter = files.erase(iter);
+		else
+			++iter;
 	}
+	std::sort(files.begin(), files.end());
 	return files;
 }
 
@@ -446,6 +547,44 @@ static void parse_freq_seek(char *optarg, struct v4l2_hw_freq_seek &seek)
 	}
 }
 
+static void parse_scan(char *optarg)
+{
+	char *value;
+	char *subs = optarg;
+
+	while (*subs != '\0') {
+		static const char *const subopts[] = {
+			"file",
+			"step",
+			"hwseek",
+			"timeout",
+			NULL
+		};
+
+		switch (parse_subopt(&subs, subopts, &value)) {
+		case 0:
+			params.scan_name = value;
+			break;
+		case 1:
+			params.scan_step = strtoul(value, 0L, 0) * 1000;
+			break;
+		case 2:
+			params.scan_hwseek = strtol(value, 0L, 0);
+			break;
+		case 3:
+			params.scan_timeout = strtoul(value, 0L, 0);
+			break;
+		default:
+			usage_rds();
+			exit(1);
+		}
+	}
+	if (!params.scan_name || !params.scan_step) {
+		usage_rds();
+		exit(1);
+	}
+}
+
 static void print_byte(char byte, bool linebreak)
 {
 	int count = 8;
@@ -491,7 +630,77 @@ static void print_decoder_info(uint8_t di)
 		printf("Not Compressed");
 }
 
-static void print_rds_statistics(struct v4l2_rds_statistics *statistics)
+/* --json output: the lines are collected in json_out and written with a
+ * single call per batch of decoded blocks, see json_flush() */
+static std::string json_out;
+
+static void json_flush(void)
+{
+	if (json_out.empty())
+		return;
+	fwrite(json_out.data(), 1, json_out.size(), stdout);
+	fflush(stdout);
+	json_out.clear();
+}
+
+/* appends the key of a member, all but the first member of an object
+ * are preceded by a comma */
+static void json_key(const char *key, bool first = false)
+{
+	if (!first)
+		json_out += ',';
+	json_out += '"';
+	json_out += key;
+	json_out += "\":";
+}
+
+/* appends a string, bytes outside of printable ASCII are escaped as
+ * Latin-1 chars */
+static void json_str(const char *key, const char *str, bool first = false)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	json_key(key, first);
+	json_out += '"';
+	for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+		if (*p == '"' || *p == '\\') {
+			json_out += '\\';
+			json_out += *p;
+		} else if (*p < 0x20 || *p >= 0x7f) {
+			json_out += "\\u00";
+			json_out += hex[*p >> 4];
+			json_out += hex[*p & 0x0f];
+		} else {
+			json_out += *p;
+		}
+	}
+	json_out += '"';
+}
+
+static void json_uint(const char *key, unsigned long long val, bool first = false)
+{
+	char buf[24];
+
+	json_key(key, first);
+	snprintf(buf, sizeof(buf), "%llu", val);
+	json_out += buf;
+}
+
+static void json_bool(const char *key, bool val)
+{
+	json_key(key);
+	json_out += val ? "true" : "false";
+}
+
+static void json_hex(const char *key, unsigned val, bool first = false)
+{
+	char buf[8];
+
+	snprintf(buf, sizeof(buf), "%04x", val);
+	json_str(key, buf, first);
+}
+
+static void print_rds_statistics(const struct v4l2_rds_statistics *statistics)
 {
 	printf("\n\nRDS Statistics: \n");
 	printf("received blocks / received groups: %u / %u\n",
@@ -510,18 +719,201 @@ static void print_rds_statistics(struct v4l2_rds_statistics *statistics)
 		printf("Group %02d: %u\n", i, statistics->group_type_cnt[i]);
 }
 
-static void print_rds_af(const struct v4l2_rds_af_set *af_set)
+/* prints a time to a valid field, 0 = not valid yet */
+static void print_rds_metrics_time(uint32_t ms)
+{
+	if (ms)
+		printf("%.1fs", ms / 1000.0);
+	else
+		printf("-");
+}
+
+static void print_rds_metrics(const struct v4l2_rds *handle, const char *tag)
 {
+	struct v4l2_rds_metrics metrics;
+
+	if (!v4l2_rds_get_metrics(handle, &metrics))
+		return;
+	if (params.options[OptJson]) {
+		json_out += '{';
+		json_key("metrics", true);
+		json_out += '{';
+		json_uint("time", metrics.time, true);
+		json_uint("window", metrics.window);
+		json_uint("blocks", metrics.window_blocks);
+		json_uint("block_errors", metrics.window_block_errors);
+		json_uint("block_corrected", metrics.window_block_corrected);
+		json_uint("time_to_pi", metrics.time_to_pi);
+		json_uint("time_to_ps", metrics.time_to_ps);
+		json_uint("time_to_rt", metrics.time_to_rt);
+		json_key("group_rate");
+		json_out += '[';
+		for (int i = 0; i < 16; i++) {
+			char buf[16];
+
+			snprintf(buf, sizeof(buf), i ? ",%.2f" : "%.2f",
+				metrics.group_rate[i]);
+			json_out += buf;
+		}
+		json_out += ']';
+		json_key("gap_hist");
+		json_out += '[';
+		for (int i = 0; i < V4L2_RDS_METRICS_GAP_BINS; i++) {
+			char buf[16];
+
+			snprintf(buf, sizeof(buf), i ? ",%u" : "%u", metrics.gap_hist[i]);
+			json_out += buf;
+		}
+		json_out += "]}";
+		if (tag)
+			json_str("dev", tag);
+		json_out += "}\n";
+		return;
+	}
+	printf("\n");
+	if (tag)
+		printf("[%s] ", tag);
+	printf("RDS Metrics at %.1fs (window %.1fs):\n", metrics.time / 1000.0,
+		metrics.window / 1000.0);
+	printf("block errors: %u of %u (%3.2f%%), corrected blocks: %u\n",
+		metrics.window_block_errors, metrics.window_blocks,
+		metrics.block_error_rate * 100.0, metrics.window_block_corrected);
+	printf("time to PI / PS / RT: ");
+	print_rds_metrics_time(metrics.time_to_pi);
+	printf(" / ");
+	print_rds_metrics_time(metrics.time_to_ps);
+	printf(" / ");
+	print_rds_metrics_time(metrics.time_to_rt);
+	printf("\ngroups/s:");
+	for (int i = 0; i < 16; i++)
+		if (metrics.group_rate[i] > 0)
+			printf(" %d: %.2f", i, metrics.group_rate[i]);
+	printf("\ngaps between groups:");
+	for (int i = 0; i < V4L2_RDS_METRICS_GAP_BINS - 1; i++)
+		printf(" <=%.0fms: %u", (1 << i) * RDS_GROUP_MS, metrics.gap_hist[i]);
+	printf(" longer: %u\n", metrics.gap_hist[V4L2_RDS_METRICS_GAP_BINS - 1]);
+}
+
+static void print_rds_af(const struct v4l2_rds *handle)
+{
+	const struct v4l2_rds_af_set *af_set = &handle->rds_af;
+	const struct v4l2_rds_af_list *lists;
+	unsigned list_cnt;
 	int counter = 0;
 
 	printf("\nAnnounced AFs: %u", af_set->announced_af);
-	for (int i = 0; i < af_set->size && i < af_set->announced_af; i++, counter++) {
+	for (int i = 0; i < af_set->size; i++, counter++) {
 		if (af_set->af[i] >= 87500000 ) {
 			printf("\nAF%02d: %.1fMHz", counter, af_set->af[i] / 1000000.0);
 			continue;
 		}
 		printf("\nAF%02d: %.3fkHz", counter, af_set->af[i] / 1000.0);
 	}
+
+	/* AF Method B: one list per transmitter */
+	if (!(handle->decode_information & V4L2_RDS_AF_B))
+		return;
+	lists = v4l2_rds_get_af_lists(handle, &list_cnt);
+	for (unsigned i = 0; i < list_cnt; i++) {
+		printf("\nAFs for %.1fMHz (%u announced):",
+			lists[i].tuned_freq / 1000000.0, lists[i].announced_af);
+		for (int j = 0; j < lists[i].size; j++)
+			printf(" %.1fMHz%s", lists[i].af[j].freq / 1000000.0,
+				(lists[i].af[j].flags & V4L2_RDS_AF_REGIONAL) ?
+				" (regional)" : "");
+	}
+}
+
+static void print_rds_rtplus(const struct v4l2_rds *handle)
+{
+	static const char *types[] = {
+		"Dummy", "Title", "Album", "Track Number", "Artist", "Composition",
+		"Movement", "Conductor", "Composer", "Band", "Comment", "Genre",
+	};
+	const struct v4l2_rds_rtplus *rtplus = v4l2_rds_get_rtplus(handle);
+
+	for (int i = 0; i < rtplus->size; i++) {
+		const struct v4l2_rds_rtplus_tag *tag = &rtplus->tag[i];
+
+		if (tag->content_type < ARRAY_SIZE(types))
+			printf("\nRT+ %s: %s", types[tag->content_type], tag->text);
+		else
+			printf("\nRT+ type %u: %s", tag->content_type, tag->text);
+	}
+}
+
+static void print_freq(uint32_t freq)
+{
+	if (freq >= 87500000)
+		printf("%.1fMHz", freq / 1000000.0);
+	else
+		printf("%.0fkHz", freq / 1000.0);
+}
+
+static void print_rds_eon(const struct v4l2_rds *handle)
+{
+	unsigned eon_cnt;
+	const struct v4l2_rds_eon *eons = v4l2_rds_get_eons(handle, &eon_cnt);
+
+	for (unsigned i = 0; i < eon_cnt; i++) {
+		const struct v4l2_rds_eon *eon = &eons[i];
+
+		printf("\nOther Network %04x:", eon->pi);
+		if (eon->valid_fields & V4L2_RDS_PS)
+			printf(" PS: %s", eon->ps);
+		if (eon->valid_fields & V4L2_RDS_PTY)
+			printf(" PTY: %u", eon->pty);
+		if (eon->valid_fields & V4L2_RDS_TP)
+			printf(" TP: %s", eon->tp ? "yes" : "no");
+		if (eon->valid_fields & V4L2_RDS_TA)
+			printf(" TA: %s", eon->ta ? "yes" : "no");
+		for (int j = 0; j < eon->af.size; j++) {
+			printf(" AF: ");
+			print_freq(eon->af.af[j]);
+		}
+		for (int j = 0; j < eon->mapped_cnt; j++) {
+			printf(" ");
+			print_freq(eon->mapped[j].tuned_freq);
+			printf(" -> ");
+			print_freq(eon->mapped[j].other_freq);
+		}
+	}
+}
+
+/* fetches the traffic messages that are new or changed since the last call */
+static unsigned get_rds_tmc_updates(std::vector<struct v4l2_rds_tmc_msg> &msgs)
+{
+	uint32_t seq = v4l2_rds_tmc_get_seq(params.tmc);
+	unsigned cnt;
+
+	if (seq == params.tmc_seq)
+		return 0;
+	msgs.resize(RDS_TMC_MESSAGES);
+	cnt = v4l2_rds_tmc_get_messages(params.tmc, params.tmc_seq, &msgs[0], msgs.size());
+	params.tmc_seq = seq;
+	return cnt;
+}
+
+static void print_rds_tmc(void)
+{
+	std::vector<struct v4l2_rds_tmc_msg> msgs;
+	unsigned cnt = get_rds_tmc_updates(msgs);
+
+	for (unsigned i = 0; i < cnt; i++) {
+		const struct v4l2_rds_tmc_msg *msg = &msgs[i];
+
+		printf("\nTMC: location %u (table %u), event %u, extent %u%s%s, "
+			"duration %u, from PI %04x",
+			msg->location, msg->ltn, msg->event, msg->extent,
+			(msg->flags & V4L2_RDS_TMC_NEGATIVE) ? ", negative direction" : "",
+			(msg->flags & V4L2_RDS_TMC_DIVERSION) ? ", diversion advised" : "",
+			msg->duration, msg->pi);
+		if (msg->flags & V4L2_RDS_TMC_MULTI_GROUP) {
+			printf(", free format data:");
+			for (int j = 0; j < (msg->data_bits + 7) / 8; j++)
+				printf(" %02x", msg->data[j]);
+		}
+	}
 }
 
 static void print_rds_pi(const struct v4l2_rds *handle)
@@ -559,6 +951,9 @@ static void print_rds_data(const struct v4l2_rds *handle, uint32_t updated_field
 		printf("\nRT: %s", handle->rt);
 	}
 
+	if (updated_fields & V4L2_RDS_RTPLUS && handle->valid_fields & V4L2_RDS_RTPLUS)
+		print_rds_rtplus(handle);
+
 	if (updated_fields & V4L2_RDS_TP && handle->valid_fields & V4L2_RDS_TP)
 		printf("\nTP: %s  TA: %s", (handle->tp)? "yes":"no",
 			handle->ta? "yes":"no");
@@ -580,48 +975,369 @@ static void print_rds_data(const struct v4l2_rds *handle, uint32_t updated_field
 			handle->rds_oda.oda[i].group_version, handle->rds_oda.oda[i].aid);
 	}
 	if (updated_fields & V4L2_RDS_AF && handle->valid_fields & V4L2_RDS_AF)
-		print_rds_af(&handle->rds_af);
+		print_rds_af(handle);
+	if (updated_fields & V4L2_RDS_EON && handle->valid_fields & V4L2_RDS_EON)
+		print_rds_eon(handle);
+	if (updated_fields & V4L2_RDS_TMC && params.tmc)
+		print_rds_tmc();
 	if (params.options[OptPrintBlock])
 		printf("\n");
 }
 
+/* appends one line with the fields of updated_fields, in the same cases in
+ * which print_rds_data() prints them */
+static void print_rds_json(const struct v4l2_rds *handle, uint32_t updated_fields,
+		const char *tag)
+{
+	const struct v4l2_rds_group *grp = v4l2_rds_get_group(handle);
+	uint32_t valid = handle->valid_fields;
+	std::vector<struct v4l2_rds_tmc_msg> tmc_msgs;
+	unsigned tmc_cnt;
+	size_t line_start = json_out.size();
+	size_t fields_start;
+	char group[8];
+
+	if (params.options[OptPrintBlock])
+		updated_fields = 0xffffffff;
+
+	snprintf(group, sizeof(group), "%u%c", grp->group_id, grp->group_version);
+	json_out += '{';
+	json_str("group", group, true);
+	if (tag)
+		json_str("dev", tag);
+	if (valid & V4L2_RDS_PI)
+		json_hex("pi", handle->pi);
+	if (params.options[OptVerbose]) {
+		json_uint("b", grp->data_b_lsb);
+		json_uint("c", (grp->data_c_msb << 8) | grp->data_c_lsb);
+		json_uint("d", (grp->data_d_msb << 8) | grp->data_d_lsb);
+	}
+	fields_start = json_out.size();
+	if (updated_fields & valid & V4L2_RDS_PS)
+		json_str("ps", (const char *)handle->ps);
+	if (updated_fields & valid & V4L2_RDS_PTY)
+		json_uint("pty", handle->pty);
+	if (updated_fields & valid & V4L2_RDS_PTYN)
+		json_str("ptyn", (const char *)handle->ptyn);
+	if (updated_fields & V4L2_RDS_TIME)
+		json_uint("time", handle->time);
+	if (updated_fields & valid & V4L2_RDS_RT)
+		json_str("rt", (const char *)handle->rt);
+	if (updated_fields & valid & V4L2_RDS_RTPLUS) {
+		const struct v4l2_rds_rtplus *rtplus = v4l2_rds_get_rtplus(handle);
+
+		json_key("rtplus");
+		json_out += '[';
+		for (int i = 0; i < rtplus->size; i++) {
+			json_out += i ? ",{" : "{";
+			json_uint("type", rtplus->tag[i].content_type, true);
+			json_str("text", (const char *)rtplus->tag[i].text);
+			json_out += '}';
+		}
+		json_out += ']';
+	}
+	if (updated_fields & valid & V4L2_RDS_TP) {
+		json_bool("tp", handle->tp);
+		json_bool("ta", handle->ta);
+	}
+	if (updated_fields & valid & V4L2_RDS_MS)
+		json_bool("music", handle->ms);
+	if (updated_fields & valid & V4L2_RDS_ECC)
+		json_uint("ecc", handle->ecc);
+	if (updated_fields & valid & V4L2_RDS_LC)
+		json_uint("lc", handle->lc);
+	if (updated_fields & valid & V4L2_RDS_DI)
+		json_uint("di", handle->di);
+	if (updated_fields & V4L2_RDS_ODA &&
+			handle->decode_information & V4L2_RDS_ODA) {
+		json_key("oda");
+		json_out += '[';
+		for (int i = 0; i < handle->rds_oda.size; i++) {
+			const struct v4l2_rds_oda *oda = &handle->rds_oda.oda[i];
+
+			snprintf(group, sizeof(group), "%u%c", oda->group_id,
+				oda->group_version);
+			json_out += i ? ",{" : "{";
+			json_str("group", group, true);
+			json_hex("aid", oda->aid);
+			json_out += '}';
+		}
+		json_out += ']';
+	}
+	if (updated_fields & valid & V4L2_RDS_AF) {
+		const struct v4l2_rds_af_set *af_set = &handle->rds_af;
+
+		json_key("af");
+		json_out += '[';
+		for (int i = 0; i < af_set->size; i++) {
+			char buf[16];
+
+			snprintf(buf, sizeof(buf), i ? ",%u" : "%u", af_set->af[i]);
+			json_out += buf;
+		}
+		json_out += ']';
+	}
+	if (updated_fields & valid & V4L2_RDS_EON) {
+		unsigned eon_cnt;
+		const struct v4l2_rds_eon *eons = v4l2_rds_get_eons(handle, &eon_cnt);
+
+		json_key("eon");
+		json_out += '[';
+		for (unsigned i = 0; i < eon_cnt; i++) {
+			const struct v4l2_rds_eon *eon = &eons[i];
+
+			json_out += i ? ",{" : "{";
+			json_hex("pi", eon->pi, true);
+			if (eon->valid_fields & V4L2_RDS_PS)
+				json_str("ps", (const char *)eon->ps);
+			if (eon->valid_fields & V4L2_RDS_PTY)
+				json_uint("pty", eon->pty);
+			json_out += '}';
+		}
+		json_out += ']';
+	}
+	if (updated_fields & V4L2_RDS_TMC && params.tmc &&
+			(tmc_cnt = get_rds_tmc_updates(tmc_msgs))) {
+		json_key("tmc");
+		json_out += '[';
+		for (unsigned i = 0; i < tmc_cnt; i++) {
+			const struct v4l2_rds_tmc_msg *msg = &tmc_msgs[i];
+
+			json_out += i ? ",{" : "{";
+			json_uint("location", msg->location, true);
+			json_uint("table", msg->ltn);
+			json_uint("event", msg->event);
+			json_uint("extent", msg->extent);
+			json_uint("flags", msg->flags);
+			json_uint("duration", msg->duration);
+			json_hex("pi", msg->pi);
+			json_out += '}';
+		}
+		json_out += ']';
+	}
+	/* drop lines without updated fields, unless every group is printed */
+	if (json_out.size() == fields_start && !params.options[OptVerbose] &&
+	    !(updated_fields & valid & V4L2_RDS_PI)) {
+		json_out.resize(line_start);
+		return;
+	}
+	json_out += "}\n";
+}
+
+/* prints all valid fields and the statistics at the end of decoding */
+static void print_rds_summary(const struct v4l2_rds *handle, const char *tag)
+{
+	const struct v4l2_rds_statistics *stat = &handle->rds_statistics;
+
+	if (!params.options[OptJson]) {
+		if (tag)
+			printf("\n[%s] Summary of valid RDS-fields:", tag);
+		else
+			printf("\nSummary of valid RDS-fields:");
+		print_rds_data(handle, 0xFFFFFFFF);
+		print_rds_statistics(stat);
+		return;
+	}
+	json_out += '{';
+	json_key("statistics", true);
+	json_out += '{';
+	json_uint("blocks", stat->block_cnt, true);
+	json_uint("groups", stat->group_cnt);
+	json_uint("block_errors", stat->block_error_cnt);
+	json_uint("group_errors", stat->group_error_cnt);
+	json_uint("block_corrected", stat->block_corrected_cnt);
+	json_out += '}';
+	if (tag)
+		json_str("dev", tag);
+	json_out += "}\n";
+	json_flush();
+}
+
+/* create a decoder with the options given on the command line */
+static struct v4l2_rds *create_rds_handle(void)
+{
+	struct v4l2_rds *handle;
+
+	if (!(handle = v4l2_rds_create(true))) {
+		fprintf(stderr, "Failed to init RDS lib: %s\n", strerror(errno));
+		exit(1);
+	}
+	if (params.tmc)
+		v4l2_rds_set_tmc(handle, params.tmc);
+	if (params.metrics_blocks && v4l2_rds_enable_metrics(handle)) {
+		fprintf(stderr, "Failed to enable RDS metrics: %s\n", strerror(errno));
+		exit(1);
+	}
+	if (params.shm)
+		v4l2_rds_set_shm(handle, params.shm);
+	return handle;
+}
+
+/* feed a batch of blocks to the decoder and print the updated fields
+ * @tag:	if not NULL, printed in front of the updated fields to tell
+ *		the output of several devices apart */
+static void decode_rds_blocks(struct v4l2_rds *handle,
+		const struct v4l2_rds_data *rds_data, unsigned n, const char *tag)
+{
+	uint32_t updated[RDS_READ_BLOCKS];
+	uint32_t updated_fields = 0x00;
+	uint32_t block_cnt = handle->rds_statistics.block_cnt;
+	unsigned groups;
+
+	/* drop expired traffic messages once a second */
+	if (params.tmc && time(NULL) != params.tmc_time) {
+		params.tmc_time = time(NULL);
+		v4l2_rds_tmc_expire(params.tmc, params.tmc_time);
+	}
+
+	/* JSON output has one line per group, and verbose mode prints every
+	 * group, so the groups have to be decoded one by one */
+	if (params.options[OptJson]) {
+		for (unsigned i = 0; i < n; i++) {
+			struct v4l2_rds_data block = rds_data[i];
+			uint32_t groups = handle->rds_statistics.group_cnt;
+
+			updated_fields = v4l2_rds_add(handle, &block);
+			if (updated_fields || (params.options[OptVerbose] &&
+					handle->rds_statistics.group_cnt != groups))
+				print_rds_json(handle, updated_fields, tag);
+		}
+	} else if (params.options[OptVerbose]) {
+		for (unsigned i = 0; i < n; i++) {
+			struct v4l2_rds_data block = rds_data[i];
+
+			if ((updated_fields = v4l2_rds_add(handle, &block))) {
+				if (tag)
+					printf("\n[%s]", tag);
+				print_rds_data(handle, updated_fields);
+				print_rds_group(v4l2_rds_get_group(handle));
+			}
+		}
+	} else {
+		groups = v4l2_rds_add_blocks(handle, rds_data, n, updated);
+		for (unsigned i = 0; i < groups; i++)
+			updated_fields |= updated[i];
+		if (updated_fields) {
+			if (tag)
+				printf("\n[%s]", tag);
+			print_rds_data(handle, updated_fields);
+		}
+	}
+
+	/* the metrics are printed in stream time, so that replayed streams
+	 * are printed like live reception */
+	if (params.metrics_blocks && block_cnt / params.metrics_blocks !=
+	    handle->rds_statistics.block_cnt / params.metrics_blocks)
+		print_rds_metrics(handle, tag);
+	json_flush();
+}
+
+/* read all blocks that are available on fd and decode them
+ * @rds_data:	read buffer of RDS_READ_BLOCKS blocks
+ * @buffered:	number of bytes of an incomplete block kept in rds_data
+ *		from the previous call, updated on return
+ * @return:	result of the read() call */
+static int read_rds_blocks(struct v4l2_rds *handle, const int fd,
+		struct v4l2_rds_data *rds_data, unsigned &buffered, const char *tag)
+{
+	const unsigned block_size = sizeof(rds_data[0]);
+	int byte_cnt;
+
+	byte_cnt = read(fd, (uint8_t *)rds_data + buffered,
+			RDS_READ_BLOCKS * block_size - buffered);
+	if (byte_cnt <= 0)
+		return byte_cnt;
+
+	buffered += byte_cnt;
+	if (params.capture) {
+		struct timeval tv;
+
+		gettimeofday(&tv, NULL);
+		if (v4l2_rds_capture_write(params.capture, rds_data, buffered / block_size,
+				tv.tv_sec * 1000ULL + tv.tv_usec / 1000, params.capture_freq)) {
+			fprintf(stderr, "\nError writing capture file: %s\n",
+				strerror(errno));
+			params.terminate_decoding = true;
+		}
+	}
+	decode_rds_blocks(handle, rds_data, buffered / block_size, tag);
+
+	/* keep a trailing partial block for the next read */
+	if (buffered % block_size)
+		memmove(rds_data, (uint8_t *)rds_data + buffered - buffered % block_size,
+			buffered % block_size);
+	buffered %= block_size;
+	return byte_cnt;
+}
+
 static void read_rds(struct v4l2_rds *handle, const int fd, const int wait_limit)
 {
 	int byte_cnt = 0;
 	int error_cnt = 0;
-	uint32_t updated_fields = 0x00;
-	struct v4l2_rds_data rds_data; /* read buffer for rds blocks */
+	unsigned buffered = 0;	/* bytes of an incomplete block kept from the last read */
+	struct v4l2_rds_data rds_data[RDS_READ_BLOCKS]; /* read buffer for rds blocks */
+	struct pollfd pfd;
 
+	pfd.fd = fd;
+	pfd.events = POLLIN;
 	while (!params.terminate_decoding) {
-		memset(&rds_data, 0, sizeof(rds_data));
-		if ((byte_cnt=read(fd, &rds_data, 3)) != 3) {  // 不足3字节丢弃，等待
-			if (byte_cnt == 0) {
-				printf("\nEnd of input file reached \n");
-				break;
-			} else if(++error_cnt > 2) {
+		/* wait for new data to arrive: transmission of 1
+		 * group takes ~88.7ms. Regular files are always readable */
+		int ret = poll(&pfd, 1, wait_limit);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("poll");
+			break;
+		}
+		if (ret == 0) {
+			if (++error_cnt > 2) {
 				fprintf(stderr, "\nError reading from "
 					"device (no RDS data available)\n");
 				break;
 			}
-			/* wait for new data to arrive: transmission of 1
-			 * group takes ~88.7ms */
-			usleep(wait_limit * 1000);
-		}
-		else if (byte_cnt == 3) {
-			error_cnt = 0;
-			/* true if a new group was decoded */
-			// 当有一个字段更新，就返回
-			// updated_fields 不为空，即有字段更新
-			if ((updated_fields = v4l2_rds_add(handle, &rds_data))) {
-				print_rds_data(handle, updated_fields);
-				if (params.options[OptVerbose])
-					 print_rds_group(v4l2_rds_get_group(handle));
+			continue;
+		}
+
+		/* read as many blocks as are available */
+		byte_cnt = read_rds_blocks(handle, fd, rds_data, buffered, NULL);
+		if (byte_cnt == 0) {
+			fprintf(info_file(), "\nEnd of input file reached \n");
+			break;
+		}
+		if (byte_cnt < 0) {
+			if (errno == EAGAIN || errno == EINTR)
+				continue;
+			if (++error_cnt > 2) {
+				fprintf(stderr, "\nError reading from "
+					"device: %s\n", strerror(errno));
+				break;
 			}
+			continue;
 		}
+		error_cnt = 0;
 	}
 	/* print a summary of all valid RDS-fields before exiting */
-	printf("\nSummary of valid RDS-fields:");
-	print_rds_data(handle, 0xFFFFFFFF);
+	print_rds_summary(handle, NULL);
+}
+
+/* returns the current frequency of the tuner in Hz, 0 if unknown */
+static uint32_t get_freq_hz(const int fd)
+{
+	struct v4l2_tuner tuner;
+	struct v4l2_frequency vf;
+	double fac = 16;		/* factor for frequency division */
+
+	memset(&tuner, 0, sizeof(tuner));
+	memset(&vf, 0, sizeof(vf));
+	tuner.index = params.tuner_index;
+	if (test_ioctl(fd, VIDIOC_G_TUNER, &tuner) == 0)
+		fac = (tuner.capability & V4L2_TUNER_CAP_LOW) ? 16000 : 16;
+	vf.tuner = params.tuner_index;
+	if (test_ioctl(fd, VIDIOC_G_FREQUENCY, &vf))
+		return 0;
+	return vf.frequency * 1000000.0 / fac + 0.5;
 }
 
 static void read_rds_from_fd(const int fd)
@@ -630,18 +1346,482 @@ static void read_rds_from_fd(const int fd)
 
 	/* create an rds handle for the current device */
 	// - 将 rds_private_state 指针转换为 v4l2_rds 指针返回
-	if (!(rds_handle = v4l2_rds_create(true))) {
-		fprintf(stderr, "Failed to init RDS lib: %s\n", strerror(errno));
-		exit(1);
+	rds_handle = create_rds_handle();
+
+	if (params.capture_name) {
+		struct timeval tv;
+
+		gettimeofday(&tv, NULL);
+		params.capture = v4l2_rds_capture_create(params.capture_name,
+				tv.tv_sec * 1000ULL + tv.tv_usec / 1000);
+		if (!params.capture) {
+			fprintf(stderr, "Failed to create %s: %s\n",
+				params.capture_name, strerror(errno));
+			exit(1);
+		}
+		if (!params.filemode_active)
+			params.capture_freq = get_freq_hz(fd);
 	}
 
 	/* try to receive and decode RDS data */
 	read_rds(rds_handle, fd, params.wait_limit);
-	print_rds_statistics(&rds_handle->rds_statistics);
 
+	if (params.capture && v4l2_rds_capture_close(params.capture)) {
+		fprintf(stderr, "Failed to write %s: %s\n", params.capture_name,
+			strerror(errno));
+		app_result = -1;
+	}
+	params.capture = NULL;
 	v4l2_rds_destroy(rds_handle);
 }
 
+/* replay a capture file from the position given by --seek. The decoder
+ * is reset whenever the capture continues on another frequency */
+static void read_rds_from_capture(struct v4l2_rds_capture *cap)
+{
+	struct v4l2_rds_data rds_data[RDS_READ_BLOCKS];
+	const struct v4l2_rds_capture_block *blocks;
+	const struct v4l2_rds_capture_segment *segs;
+	uint64_t start_time = v4l2_rds_capture_get_start_time(cap);
+	uint64_t block_cnt;
+	uint64_t i;
+	unsigned seg_cnt;
+	unsigned seg = 0;
+	int shown_seg = -1;
+	struct v4l2_rds *rds_handle;
+	time_t t = start_time / 1000;
+
+	rds_handle = create_rds_handle();
+	blocks = v4l2_rds_capture_get_blocks(cap, &block_cnt);
+	segs = v4l2_rds_capture_get_segments(cap, &seg_cnt);
+	fprintf(info_file(), "Capture started: %s", ctime(&t));
+	fprintf(info_file(), "Blocks: %" PRIu64 ", station segments: %u\n",
+		block_cnt, seg_cnt);
+
+	i = v4l2_rds_capture_seek(cap, start_time + params.seek * 1000ULL);
+	while (i < block_cnt && !params.terminate_decoding) {
+		unsigned n = 0;
+
+		/* decode up to the end of the current segment at once */
+		while (seg + 1 < seg_cnt && segs[seg + 1].first_block <= i)
+			seg++;
+		if (seg_cnt && (int)seg != shown_seg) {
+			t = (start_time + segs[seg].time_ms) / 1000;
+			fprintf(info_file(), "\n\nFrequency: %.3f MHz, PI: %04x, %s",
+				segs[seg].freq / 1000000.0, segs[seg].pi, ctime(&t));
+			if (shown_seg >= 0 && segs[seg].freq != segs[shown_seg].freq)
+				v4l2_rds_reset(rds_handle, false);
+			shown_seg = seg;
+		}
+		while (n < RDS_READ_BLOCKS && i < block_cnt &&
+		       (seg + 1 >= seg_cnt || i < segs[seg + 1].first_block))
+			rds_data[n++] = blocks[i++].data;
+		decode_rds_blocks(rds_handle, rds_data, n, NULL);
+	}
+	print_rds_summary(rds_handle, NULL);
+	v4l2_rds_destroy(rds_handle);
+}
+
+/* state of one device in --read-rds-all mode */
+struct rds_dev {
+	std::string name;
+	int fd;
+	struct v4l2_rds *handle;
+	unsigned buffered;
+	struct v4l2_rds_data rds_data[RDS_READ_BLOCKS];
+};
+
+/* open all RDS-capable devices and decode their RDS streams from a single
+ * epoll loop. Devices are only dropped on read errors, not on timeouts */
+static void read_rds_from_all_devices(void)
+{
+	dev_vec devices = list_devices();
+	std::vector<struct rds_dev *> devs;
+	struct epoll_event events[16];
+	unsigned active = 0;
+	int epfd;
+
+	if (devices.size() == 0) {
+		fprintf(stderr, "No RDS-capable device found\n");
+		exit(1);
+	}
+	if ((epfd = epoll_create1(0)) < 0) {
+		perror("epoll_create1");
+		exit(1);
+	}
+
+	for (dev_vec::iterator iter = devices.begin();
+			iter != devices.end(); ++iter) {
+		struct rds_dev *dev = new rds_dev;
+		struct epoll_event ev;
+
+		dev->name = *iter;
+		dev->buffered = 0;
+		if ((dev->fd = test_open(iter->c_str(), O_RDONLY | O_NONBLOCK)) < 0) {
+			fprintf(stderr, "Failed to open %s: %s\n", iter->c_str(),
+				strerror(errno));
+			delete dev;
+			continue;
+		}
+		dev->handle = create_rds_handle();
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.ptr = dev;
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, dev->fd, &ev) < 0) {
+			fprintf(stderr, "Failed to watch %s: %s\n", iter->c_str(),
+				strerror(errno));
+			test_close(dev->fd);
+			v4l2_rds_destroy(dev->handle);
+			delete dev;
+			continue;
+		}
+		fprintf(info_file(), "Using device: %s\n", iter->c_str());
+		devs.push_back(dev);
+		active++;
+	}
+
+	while (active && !params.terminate_decoding) {
+		int cnt = epoll_wait(epfd, events, ARRAY_SIZE(events), params.wait_limit);
+
+		if (cnt < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("epoll_wait");
+			break;
+		}
+		for (int i = 0; i < cnt; i++) {
+			struct rds_dev *dev = (struct rds_dev *)events[i].data.ptr;
+			int byte_cnt;
+
+			if (dev->fd < 0)
+				continue;
+			byte_cnt = read_rds_blocks(dev->handle, dev->fd,
+					dev->rds_data, dev->buffered, dev->name.c_str());
+			if (byte_cnt > 0 || (byte_cnt < 0 &&
+					(errno == EAGAIN || errno == EINTR)))
+				continue;
+			fprintf(stderr, "\n[%s] Error reading from device: %s\n",
+				dev->name.c_str(), byte_cnt ? strerror(errno) : "EOF");
+			epoll_ctl(epfd, EPOLL_CTL_DEL, dev->fd, NULL);
+			test_close(dev->fd);
+			dev->fd = -1;
+			active--;
+		}
+	}
+
+	for (std::vector<struct rds_dev *>::iterator iter = devs.begin();
+			iter != devs.end(); ++iter) {
+		struct rds_dev *dev = *iter;
+
+		print_rds_summary(dev->handle, dev->name.c_str());
+		if (dev->fd >= 0)
+			test_close(dev->fd);
+		v4l2_rds_destroy(dev->handle);
+		delete dev;
+	}
+	close(epfd);
+}
+
+/* milliseconds since start */
+static uint32_t elapsed_ms(const struct timespec &start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start.tv_sec) * 1000 +
+		(now.tv_nsec - start.tv_nsec) / 1000000;
+}
+
+/* tunes to freq (in Hz)
+ * @fac:	tuner units per MHz */
+static int set_freq_hz(const int fd, uint32_t freq, double fac)
+{
+	struct v4l2_frequency vf;
+
+	memset(&vf, 0, sizeof(vf));
+	vf.tuner = params.tuner_index;
+	vf.type = V4L2_TUNER_RADIO;
+	vf.frequency = freq / 1000000.0 * fac + 0.5;
+	return test_ioctl(fd, VIDIOC_S_FREQUENCY, &vf);
+}
+
+/* receives RDS on the current frequency until PS and the AFs are known,
+ * or until the time for the frequency is up
+ * @return:	true if a PI code was received */
+static bool scan_station(struct v4l2_rds *handle, const int fd)
+{
+	struct v4l2_rds_data rds_data[RDS_READ_BLOCKS];
+	const unsigned block_size = sizeof(rds_data[0]);
+	unsigned buffered = 0;
+	uint32_t ps_time = 0;
+	struct timespec start;
+	struct pollfd pfd;
+
+	/* blocks buffered by the driver belong to the previous frequency */
+	while (read(fd, rds_data, sizeof(rds_data)) > 0)
+		;
+	v4l2_rds_reset(handle, true);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while (!params.terminate_decoding) {
+		uint32_t valid = handle->valid_fields;
+		uint32_t t = elapsed_ms(start);
+		int byte_cnt;
+
+		if (t >= params.scan_timeout)
+			break;
+		if (!(valid & V4L2_RDS_PI) && t >= RDS_SCAN_PI_WAIT)
+			break;
+		if (valid & V4L2_RDS_PS) {
+			if (!ps_time)
+				ps_time = t;
+			if ((valid & V4L2_RDS_AF) || t - ps_time >= RDS_SCAN_AF_WAIT)
+				break;
+		}
+
+		if (poll(&pfd, 1, params.scan_timeout - t) <= 0)
+			continue;
+		byte_cnt = read(fd, (uint8_t *)rds_data + buffered,
+				sizeof(rds_data) - buffered);
+		if (byte_cnt <= 0)
+			continue;
+		buffered += byte_cnt;
+		v4l2_rds_add_blocks(handle, rds_data, buffered / block_size, NULL);
+		if (buffered % block_size)
+			memmove(rds_data, (uint8_t *)rds_data + buffered - buffered % block_size,
+				buffered % block_size);
+		buffered %= block_size;
+	}
+	return handle->valid_fields & V4L2_RDS_PI;
+}
+
+/* appends the station received on freq to the station database */
+static void scan_write_station(FILE *db, const struct v4l2_rds *handle, uint32_t freq)
+{
+	uint32_t valid = handle->valid_fields;
+
+	json_out += '{';
+	json_uint("freq", freq, true);
+	json_hex("pi", handle->pi);
+	if (valid & V4L2_RDS_PS)
+		json_str("ps", (const char *)handle->ps);
+	if (valid & V4L2_RDS_PTY)
+		json_uint("pty", handle->pty);
+	if (valid & V4L2_RDS_AF) {
+		json_key("af");
+		json_out += '[';
+		for (int i = 0; i < handle->rds_af.size; i++) {
+			char buf[16];
+
+			snprintf(buf, sizeof(buf), i ? ",%u" : "%u", handle->rds_af.af[i]);
+			json_out += buf;
+		}
+		json_out += ']';
+	}
+	json_out += "}\n";
+	fwrite(json_out.data(), 1, json_out.size(), db);
+	json_out.clear();
+}
+
+/* walks the FM band and writes the stations that send RDS into the
+ * station database. Each frequency is left as soon as it is clear that
+ * there is no RDS, or once the station is known, so the scan takes at
+ * most params.scan_timeout per step */
+static void scan_band(const int fd)
+{
+	struct v4l2_tuner tuner;
+	struct v4l2_rds *handle;
+	struct timespec start;
+	double fac = 16;		/* tuner units per MHz */
+	uint32_t low = 87500000, high = 108000000;
+	uint32_t freq;
+	unsigned found = 0;
+	bool hwseek;
+	FILE *db;
+
+	memset(&tuner, 0, sizeof(tuner));
+	tuner.index = params.tuner_index;
+	if (doioctl(fd, VIDIOC_G_TUNER, &tuner))
+		return;
+	if (tuner.capability & V4L2_TUNER_CAP_LOW)
+		fac = 16000;
+	/* the FM band, as far as the tuner covers it */
+	if (tuner.rangelow / fac * 1000000 > low)
+		low = tuner.rangelow / fac * 1000000;
+	if (tuner.rangehigh / fac * 1000000 < high)
+		high = tuner.rangehigh / fac * 1000000;
+	if (low > high) {
+		fprintf(stderr, "The tuner doesn't cover the FM band\n");
+		app_result = -1;
+		return;
+	}
+	hwseek = params.scan_hwseek < 0 ?
+		(tuner.capability & V4L2_TUNER_CAP_HWSEEK_BOUNDED) : params.scan_hwseek;
+
+	if (!(db = fopen(params.scan_name, "w"))) {
+		fprintf(stderr, "Failed to create %s: %s\n", params.scan_name,
+			strerror(errno));
+		app_result = -1;
+		return;
+	}
+	handle = create_rds_handle();
+	fprintf(info_file(), "Scanning %.1f - %.1f MHz using %s\n",
+		low / 1000000.0, high / 1000000.0,
+		hwseek ? "hardware seek" : "fixed steps");
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	freq = low;
+	/* hardware seeks start at the lower band edge */
+	if (hwseek && set_freq_hz(fd, freq, fac))
+		hwseek = false;
+	while (!params.terminate_decoding) {
+		if (hwseek) {
+			struct v4l2_hw_freq_seek seek;
+			uint32_t next;
+
+			memset(&seek, 0, sizeof(seek));
+			seek.tuner = params.tuner_index;
+			seek.type = V4L2_TUNER_RADIO;
+			seek.seek_upward = 1;
+			seek.spacing = params.scan_step;
+			if (tuner.capability & V4L2_TUNER_CAP_HWSEEK_PROG_LIM) {
+				seek.rangelow = low / 1000000.0 * fac + 0.5;
+				seek.rangehigh = high / 1000000.0 * fac + 0.5;
+			}
+			/* fails with ENODATA if no further station is found */
+			if (test_ioctl(fd, VIDIOC_S_HW_FREQ_SEEK, &seek))
+				break;
+			next = get_freq_hz(fd);
+			if (next <= freq || next > high)
+				break;
+			freq = next;
+		} else if (set_freq_hz(fd, freq, fac)) {
+			fprintf(stderr, "Failed to tune to %.1f MHz: %s\n",
+				freq / 1000000.0, strerror(errno));
+			app_result = -1;
+			break;
+		}
+
+		if (scan_station(handle, fd)) {
+			scan_write_station(db, handle, freq);
+			found++;
+			fprintf(info_file(), "%.1f MHz: PI %04x, PS %s, PTY %u\n",
+				freq / 1000000.0, handle->pi,
+				(handle->valid_fields & V4L2_RDS_PS) ?
+				(const char *)handle->ps : "-", handle->pty);
+		}
+
+		if (!hwseek) {
+			freq += params.scan_step;
+			if (freq > high)
+				break;
+		}
+	}
+	fprintf(info_file(), "%u stations written to %s, the scan took %.1fs\n",
+		found, params.scan_name, elapsed_ms(start) / 1000.0);
+	if (fclose(db)) {
+		fprintf(stderr, "Failed to write %s: %s\n", params.scan_name,
+			strerror(errno));
+		app_result = -1;
+	}
+	v4l2_rds_destroy(handle);
+}
+
+/* removes the segment of --publish, subscribers see it as closed */
+static void close_shm(void)
+{
+	v4l2_rds_shm_close(params.shm);
+	params.shm = NULL;
+}
+
+/* fields of the published state that changed, the published state holds
+ * no private decoder state, so RT+ tags and other networks can't be
+ * printed */
+static uint32_t rds_changed_fields(const struct v4l2_rds *old_state,
+		const struct v4l2_rds *state)
+{
+	uint32_t changed = (old_state->valid_fields ^ state->valid_fields) &
+		~(V4L2_RDS_RTPLUS | V4L2_RDS_EON);
+
+#define RDS_CHANGED(field, flag) \
+	if (memcmp(&old_state->field, &state->field, sizeof(state->field))) \
+		changed |= flag
+
+	RDS_CHANGED(pi, V4L2_RDS_PI);
+	RDS_CHANGED(ps, V4L2_RDS_PS);
+	RDS_CHANGED(pty, V4L2_RDS_PTY);
+	RDS_CHANGED(ptyn, V4L2_RDS_PTYN);
+	RDS_CHANGED(rt, V4L2_RDS_RT);
+	RDS_CHANGED(tp, V4L2_RDS_TP);
+	RDS_CHANGED(ta, V4L2_RDS_TP);
+	RDS_CHANGED(ms, V4L2_RDS_MS);
+	RDS_CHANGED(di, V4L2_RDS_DI);
+	RDS_CHANGED(ecc, V4L2_RDS_ECC);
+	RDS_CHANGED(lc, V4L2_RDS_LC);
+	RDS_CHANGED(time, V4L2_RDS_TIME);
+	RDS_CHANGED(rds_af, V4L2_RDS_AF);
+#undef RDS_CHANGED
+	return changed;
+}
+
+/* prints the RDS data published by another process in shared memory,
+ * until the publisher closes the segment */
+static void read_rds_from_shm(void)
+{
+	struct v4l2_rds_group groups[RDS_SHM_GROUPS];
+	struct v4l2_rds_shm *shm;
+	struct v4l2_rds state, old_state;
+	uint32_t seq, old_seq;
+	uint32_t pos, lost = 0;
+
+	if (!(shm = v4l2_rds_shm_open(params.shm_name))) {
+		fprintf(stderr, "Failed to open %s: %s\n", params.shm_name,
+			strerror(errno));
+		exit(1);
+	}
+	memset(&old_state, 0, sizeof(old_state));
+	old_seq = v4l2_rds_shm_get_state(shm, &state) - 1;
+	pos = v4l2_rds_shm_get_group_pos(shm);
+
+	while (!params.terminate_decoding) {
+		bool closed = v4l2_rds_shm_is_closed(shm);
+		uint32_t changed;
+		unsigned n;
+
+		if (params.options[OptVerbose]) {
+			n = v4l2_rds_shm_get_groups(shm, &pos, groups,
+					RDS_SHM_GROUPS, &lost);
+			for (unsigned i = 0; i < n; i++)
+				print_rds_group(&groups[i]);
+		}
+		seq = v4l2_rds_shm_get_state(shm, &state);
+		if (seq != old_seq) {
+			/* the private part of the decoder isn't published */
+			state.decode_information &= ~V4L2_RDS_AF_B;
+			state.valid_fields &= ~(V4L2_RDS_RTPLUS | V4L2_RDS_EON);
+			changed = rds_changed_fields(&old_state, &state);
+			if (changed)
+				print_rds_data(&state, changed);
+			old_state = state;
+			old_seq = seq;
+		}
+		if (closed) {
+			fprintf(info_file(), "\nThe publisher closed %s\n",
+				params.shm_name);
+			break;
+		}
+		usleep(RDS_SHM_POLL_MS * 1000);
+	}
+	if (lost)
+		fprintf(info_file(), "\n%u groups were lost\n", lost);
+	printf("\nSummary of valid RDS-fields:");
+	print_rds_data(&state, 0xFFFFFFFF & ~(V4L2_RDS_RTPLUS | V4L2_RDS_EON));
+	print_rds_statistics(&state.rds_statistics);
+	v4l2_rds_shm_close(shm);
+}
+
 static int parse_cl(int argc, char **argv)
 {
 	int i = 0;
@@ -691,6 +1871,9 @@ static int parse_cl(int argc, char **argv)
 		case OptFreqSeek:
 			parse_freq_seek(optarg, params.freq_seek);
 			break;
+		case OptScan:
+			parse_scan(optarg);
+			break;
 		case OptTunerIndex:
 			params.tuner_index = strtoul(optarg, NULL, 0);
 			break;
@@ -710,6 +1893,22 @@ static int parse_cl(int argc, char **argv)
 		case OptWaitLimit:
 			params.wait_limit = strtoul(optarg, NULL, 0);
 			break;
+		case OptCapture:
+			params.capture_name = optarg;
+			break;
+		case OptPublish:
+		case OptSubscribe:
+			params.shm_name = optarg;
+			break;
+		case OptSeek:
+			params.seek = strtoul(optarg, NULL, 0);
+			break;
+		case OptPrintMetrics:
+			/* 1187.5 / 26 blocks per second */
+			params.metrics_blocks = strtoul(optarg, NULL, 0) * 2375 / 52;
+			if (!params.metrics_blocks)
+				params.metrics_blocks = 1;
+			break;
 		case ':':
 			fprintf(stderr, "Option '%s' requires a value\n",
 				argv[optind]);
@@ -730,6 +1929,13 @@ static int parse_cl(int argc, char **argv)
 		usage_hint();
 		return 1;
 	}
+	/* the JSON lines are made per decoded group, the subscribers only
+	 * see the changes of the published state */
+	if (params.options[OptSubscribe] && params.options[OptJson]) {
+		fprintf(stderr, "--subscribe can't be combined with --json\n");
+		usage_hint();
+		exit(1);
+	}
 	if (params.options[OptAll]) {
 		params.options[OptGetDriverInfo] = 1;
 		params.options[OptGetFreq] = 1;
@@ -880,6 +2086,10 @@ int main(int argc, char **argv)
 	memset(&vcap, 0, sizeof(vcap));
 	memset(&vf, 0, sizeof(vf));
 	strcpy(params.fd_name, "/dev/radio0");  // 复制字符串 "/dev/radio0" 到 fd_name
+	params.wait_limit = 5000;
+	params.scan_step = 100000;
+	params.scan_hwseek = -1;
+	params.scan_timeout = 3000;
 
 	/* define locale for unicode support */
 	if (!setlocale(LC_CTYPE, "")) {
@@ -896,15 +2106,60 @@ int main(int argc, char **argv)
 		exit(0);
 	}
 
+	if (params.options[OptPrintTmc] &&
+	    !(params.tmc = v4l2_rds_tmc_create(RDS_TMC_MESSAGES))) {
+		fprintf(stderr, "Failed to create the TMC message store: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+
+	/* Subscriber Mode: print the RDS data published by another process,
+	 * disables all other features */
+	if (params.options[OptSubscribe]) {
+		read_rds_from_shm();
+		exit(app_result);
+	}
+
+	/* Multi-Device Mode: decode RDS data of all devices, disables all
+	 * other features */
+	if (params.options[OptReadRdsAll]) {
+		if (params.capture_name) {
+			fprintf(stderr, "--capture is not supported with --read-rds-all\n");
+			exit(1);
+		}
+		if (params.options[OptPublish]) {
+			fprintf(stderr, "--publish is not supported with --read-rds-all\n");
+			exit(1);
+		}
+		read_rds_from_all_devices();
+		exit(app_result);
+	}
+
+	if (params.options[OptPublish] &&
+	    !(params.shm = v4l2_rds_shm_create(params.shm_name, RDS_SHM_GROUPS))) {
+		fprintf(stderr, "Failed to create %s: %s\n", params.shm_name,
+			strerror(errno));
+		exit(1);
+	}
+	if (params.shm)
+		atexit(close_shm);
+
 	/* File Mode: disables all other features, except for RDS decoding */
 	if (params.filemode_active) {
+		struct v4l2_rds_capture *cap = v4l2_rds_capture_open(params.fd_name);
+
+		if (cap) {
+			read_rds_from_capture(cap);
+			v4l2_rds_capture_close(cap);
+			exit(app_result);
+		}
 		if ((fd = open(params.fd_name, O_RDONLY|O_NONBLOCK)) < 0){
 			perror("error opening file");
 			exit(1);
 		}
 		read_rds_from_fd(fd);
 		test_close(fd);
-		exit(0);
+		exit(app_result);
 	}
 
 	/* Device Mode: open the radio device as read-only and non-blocking */
@@ -916,7 +2171,7 @@ int main(int argc, char **argv)
 			exit(1);
 		}
 		strncpy(params.fd_name, devices[0].c_str(), 80);
-		printf("Using device: %s\n", params.fd_name);
+		fprintf(info_file(), "Using device: %s\n", params.fd_name);
 	}
 	if ((fd = test_open(params.fd_name, O_RDONLY | O_NONBLOCK)) < 0) {
 		fprintf(stderr, "Failed to open %s: %s\n", params.fd_name,
@@ -932,6 +2187,9 @@ int main(int argc, char **argv)
 	set_options(fd, vcap.capabilities, &vf, &tuner);
 	/* Get options */
 	get_options(fd, vcap.capabilities, &vf, &tuner);
+	/* Band scan */
+	if (params.options[OptScan])
+		scan_band(fd);
 	/* RDS decoding */
 	if (params.options[OptReadRds])
 		read_rds_from_fd(fd);
@@ -7,6 +7,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -14,124 +17,205 @@
 #include <linux/types.h>
 #include <linux/i2c.h>
 #include <linux/i2c-dev.h>
+#include <linux/videodev2.h>
+
+#include <libv4l2rds.h>
+
+/* the saa6588 always has to be read with at least 6 bytes:
+ * byte 0:	status, bits 7-5 number of the last block (0-3 = A-D, 4 = C',
+ *		5 = E, 6 = invalid E), bit 4 data available, bit 3 overflow,
+ *		bit 2 reset, bits 1-0 error code of the last block
+ * byte 1-2:	last block, MSB and LSB
+ * byte 3-4:	previous block, MSB and LSB
+ * byte 5:	status of the previous block, number and error code at the
+ *		same bits as in byte 0
+ * So one transaction returns two blocks, and the chip only has to be
+ * polled once per two blocks (43.8ms) */
+#define SAA6588_READ_SIZE	6
+#define SAA6588_DATA_AVAIL	0x10
+#define SAA6588_OVERFLOW	0x08
+#define SAA6588_RESET		0x04
+#define SAA6588_ERR_MASK	0x03
+#define SAA6588_ERR_NONE	0x00
+#define SAA6588_ERR_FATAL	0x03
+
+/* default poll interval in ms, somewhat less than two blocks */
+#define POLL_INTERVAL	40
+/* blocks collected before they are decoded at once, ~350ms of RDS */
+#define BATCH_BLOCKS	16
 
 int debug;
 
 /* ----------------------------------------------------------------- */
 
-char rds_psn[9];
-char rds_txt[65];
+/* position of a block in the group, -1 for E blocks */
+static int block_pos(int blkno)
+{
+    static const int pos[8] = { 0, 1, 2, 3, 2, -1, -1, -1 };
+
+    return pos[blkno & 0x07];
+}
 
-static void rds_decode(int blkno,int b1, int b2)
+/* converts a saa6588 block into the v4l2 format, as the saa6588 kernel
+ * driver does */
+static void saa6588_to_v4l2(struct v4l2_rds_data *data, uint8_t status,
+			    uint8_t msb, uint8_t lsb)
 {
-    static int group,spare,c1,c2;
+    int blkno = status >> 5;
 
-    switch (blkno) {
-    case 0:
-	if (debug)
-	    fprintf(stderr,"block A - id=%d\n",
-		    (b1 << 8) | b2);
-	break;
-    case 1:
-	if (debug)
-	    fprintf(stderr,"block B - group=%d%c tp=%d pty=%d spare=%d\n",
-		    (b1 >> 4) & 0x0f,
-		    ((b1 >> 3) & 0x01) + 'A',
-		    (b1 >> 2) & 0x01,
-		    ((b1 << 3) & 0x18) | ((b2 >> 5) & 0x07),
-		    b2 & 0x1f);
-	group = (b1 >> 3) & 0x1f;
-	spare = b2 & 0x1f;
-	break;
-    case 2:
-	if (debug)
-	    fprintf(stderr,"block C - 0x%02x 0x%02x\n",b1,b2);
-	c1 = b1;
-	c2 = b2;
-	break;
-    case 3:
-	if (debug)
-	    fprintf(stderr,"block D - 0x%02x 0x%02x\n",b1,b2);
-	switch (group) {
-	case 0:
-	    rds_psn[2*(spare & 0x03)+0] = b1;
-	    rds_psn[2*(spare & 0x03)+1] = b2;
-	    if ((spare & 0x03) == 0x03)
-		fprintf(stderr,"PSN #>%s<#\n",rds_psn);
-	    break;
-	case 4:
-	    rds_txt[4*(spare & 0x0f)+0] = c1;
-	    rds_txt[4*(spare & 0x0f)+1] = c2;
-	    rds_txt[4*(spare & 0x0f)+2] = b1;
-	    rds_txt[4*(spare & 0x0f)+3] = b2;
-	    if ((spare & 0x0f) == 0x0f)
-		fprintf(stderr,"TXT #>%s<#\n",rds_txt);
-	    break;
-	}
-	break;
-    default:
-	fprintf(stderr,"unknown block [%d]\n",blkno);
+    data->msb = msb;
+    data->lsb = lsb;
+    /* E blocks are only sent by MMBS, which is discontinued */
+    if (block_pos(blkno) < 0) {
+	data->block = V4L2_RDS_BLOCK_INVALID;
+	return;
+    }
+    data->block = blkno | (blkno << 3);
+    if ((status & SAA6588_ERR_MASK) == SAA6588_ERR_FATAL)
+	data->block |= V4L2_RDS_BLOCK_ERROR;
+    else if ((status & SAA6588_ERR_MASK) != SAA6588_ERR_NONE)
+	data->block |= V4L2_RDS_BLOCK_CORRECTED;
+}
+
+static void print_rds(const struct v4l2_rds *handle, uint32_t updated)
+{
+    const uint32_t valid = handle->valid_fields;
+
+    if (updated & valid & V4L2_RDS_PI)
+	fprintf(stderr,"PI %04x\n",handle->pi);
+    if (updated & valid & V4L2_RDS_PS)
+	fprintf(stderr,"PSN #>%s<#\n",handle->ps);
+    if (updated & valid & V4L2_RDS_PTY)
+	fprintf(stderr,"PTY %u (%s)\n",handle->pty,
+		v4l2_rds_get_pty_str(handle));
+    if (updated & valid & V4L2_RDS_RT)
+	fprintf(stderr,"TXT #>%s<#\n",handle->rt);
+    if (updated & valid & V4L2_RDS_TIME)
+	fprintf(stderr,"CT %s",ctime(&handle->time));
+    if (updated & valid & V4L2_RDS_AF) {
+	fprintf(stderr,"AF");
+	for (int i = 0; i < handle->rds_af.size; i++)
+	    fprintf(stderr," %.1f",handle->rds_af.af[i] / 1000000.0);
+	fprintf(stderr,"\n");
     }
 }
 
+/* decodes the collected blocks and prints the updated fields */
+static void rds_decode(struct v4l2_rds *handle, struct v4l2_rds_data *blocks,
+		       unsigned cnt)
+{
+    uint32_t updated[BATCH_BLOCKS];
+    uint32_t fields = 0;
+    unsigned groups;
+
+    groups = v4l2_rds_add_blocks(handle, blocks, cnt, updated);
+    for (unsigned i = 0; i < groups; i++)
+	fields |= updated[i];
+    if (fields)
+	print_rds(handle, fields);
+}
+
 int
 main(int argc, char *argv[])
 {
     int  c,f,rc, no, lastno = -1;
-    unsigned char b[40];
+    unsigned char b[SAA6588_READ_SIZE];
     char *device = "/dev/i2c-0";
+    int interval = POLL_INTERVAL;
+    struct v4l2_rds *handle;
+    struct v4l2_rds_data blocks[BATCH_BLOCKS];
+    unsigned cnt = 0;
+    unsigned long reads = 0, lost = 0;
 
     /* parse options */
-    while (-1 != (c=getopt(argc,argv,"hvd:"))) {
+    while (-1 != (c=getopt(argc,argv,"hvd:i:"))) {
 	switch (c){
 	case 'd':
 	    if (optarg)
 		device = optarg;
 	    break;
+	case 'i':
+	    interval = atoi(optarg);
+	    break;
 	case 'v':
 	    debug = 1;
 	    break;
 	case 'h':
 	default:
 	    printf("poll i2c RDS receiver [saa6588] via chardev\n");
-	    printf("usage: %s [ -d i2c-device ]\n",argv[0]);
+	    printf("usage: %s [ -d i2c-device ] [ -i poll interval in ms ] [ -v ]\n",
+		   argv[0]);
 	    exit(1);
 	}
     }
 
+    if (NULL == (handle = v4l2_rds_create(false))) {
+	fprintf(stderr,"init RDS decoder: %s\n",strerror(errno));
+	exit(1);
+    }
     if (-1 == (f = open(device,O_RDWR))) {
 	fprintf(stderr,"open %s: %s\n",device,strerror(errno));
 	exit(1);
     }
     ioctl(f,I2C_SLAVE,0x20 >> 1);
     for (;;) {
+	int expected;
+
 	memset(b,0,sizeof(b));
-	rc = read(f,b,6);
-	if (6 != rc) {
-	    fprintf(stderr,"oops: read: rc=%d, expected 6 [%s]\n",
-		    rc,strerror(errno));
+	rc = read(f,b,SAA6588_READ_SIZE);
+	if (SAA6588_READ_SIZE != rc) {
+	    fprintf(stderr,"oops: read: rc=%d, expected %d [%s]\n",
+		    rc,SAA6588_READ_SIZE,strerror(errno));
 	    break;
 	}
-	if (0 == (b[0] & 0x10)) {
+	reads++;
+	if (0 == (b[0] & SAA6588_DATA_AVAIL)) {
 	    fprintf(stderr,"no signal\r");
-	    continue;
+	    lastno = -1;
+	    goto next;
 	}
-	if (1 == (b[0] & 0x08)) {
+	if (b[0] & SAA6588_OVERFLOW)
 	    fprintf(stderr,"overflow detected\n");
-	}
-	if (1 == (b[0] & 0x04)) {
+	if (b[0] & SAA6588_RESET) {
 	    fprintf(stderr,"reset detected\n");
+	    lastno = -1;
 	}
 	if (debug)
 	    fprintf(stderr,"raw: 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x\n",
 		    b[0],b[1],b[2],b[3],b[4],b[5]);
 	no = b[0] >> 5;
-	if (lastno != no) {
-		rds_decode(no, b[1], b[2]);
-		lastno = no;
+	if (lastno == no)
+	    goto next;
+
+	/* the previous block is only needed if exactly one block was
+	 * missed since the last read, it is taken if its number proves
+	 * that it is that block */
+	if (lastno >= 0 && block_pos(lastno) >= 0 && block_pos(no) >= 0) {
+	    expected = (block_pos(lastno) + 1) % 4;
+	    if (block_pos(no) != expected) {
+		if (block_pos(b[5] >> 5) == expected &&
+		    (block_pos(no) + 3) % 4 == expected)
+		    saa6588_to_v4l2(&blocks[cnt++],b[5],b[3],b[4]);
+		else
+		    lost += (block_pos(no) - expected + 4) % 4;
+	    }
+	}
+	saa6588_to_v4l2(&blocks[cnt++],b[0],b[1],b[2]);
+	lastno = no;
+
+	if (cnt >= BATCH_BLOCKS - 1) {
+	    rds_decode(handle,blocks,cnt);
+	    cnt = 0;
+	    if (debug)
+		fprintf(stderr,"%lu reads, %u blocks, %lu blocks lost\n",reads,
+			handle->rds_statistics.block_cnt,lost);
 	}
-	usleep(10*1000);
+    next:
+	usleep(interval*1000);
     }
+    if (cnt)
+	rds_decode(handle,blocks,cnt);
     close(f);
+    v4l2_rds_destroy(handle);
     exit(0);
 }